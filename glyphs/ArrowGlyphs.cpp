@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "glyphs/ArrowGlyphs.h"
+#include "glyphs/Timings.h"
 #include <random>
 #include <omp.h>
 #include <owl/common/parallel/parallel_for.h>
@@ -27,7 +28,7 @@ namespace glyphs {
 
   ArrowGlyphs::ArrowGlyphs()
   {
-    module = owlModuleCreate(context, embedded_ArrowGlyphs_programs);
+    module = createModule(embedded_ArrowGlyphs_programs);
 
     // the "links" buffer is where the geometry is stored. we have one
     // "link" per glyph, from that the RTX programs will assemble an
@@ -61,21 +62,59 @@ namespace glyphs {
     return bounds;
   }
 
+  /*! instance transform for given link's arrow */
+  static affine3f arrowXform(const Glyphs::SP &glyphs, const Link &A)
+  {
+    affine3f xfm;
+    if (A.prev < 0) {
+      xfm
+        = affine3f::translate(A.pos);
+      xfm.l.vx *= glyphs->radius;
+      xfm.l.vy *= glyphs->radius;
+      xfm.l.vz *= glyphs->radius;
+      return xfm;
+    }
+        
+    const Link B = glyphs->links[A.prev];
+    const float linkLength = length(A.pos - B.pos)+glyphs->radius;
+    if (linkLength <= 1e-6f) {
+      // too short, ignore this,it'll only get numerically weird...
+      xfm
+        = affine3f::translate(A.pos);
+      xfm.l.vx *= glyphs->radius;
+      xfm.l.vy *= glyphs->radius;
+      xfm.l.vz *= glyphs->radius;
+      return xfm;
+    }
+        
+    xfm
+      = affine3f::translate(B.pos)
+      * affine3f(frame(normalize(A.pos-B.pos)));
+    xfm.l.vx *= glyphs->radius;
+    xfm.l.vy *= glyphs->radius;
+    xfm.l.vz *= linkLength;
+    return xfm;
+  }
+
   /*! this takes a set of glyphs, and builds one instance per glyph -
       the result is stored in the groups/transforms vectors */
   std::vector<std::pair<OWLGroup,affine3f>>
   ArrowGlyphs::buildGlyphs(Glyphs::SP glyphs)
   {
+    ScopedTimer timer("build glyphs");
     const int numLinks = glyphs->size();
     std::vector<std::pair<OWLGroup,affine3f>> result(numLinks);
     
     result.resize(numLinks);
     
-    linkBuffer
-      = owlDeviceBufferCreate(context,
-                              OWL_USER_TYPE(glyphs->links[0]),
-                              glyphs->links.size(),
-                              glyphs->links.data());
+    {
+      ScopedTimer timer("upload links");
+      linkBuffer
+        = createDeviceBuffer(MEM_LINKS,
+                             OWL_USER_TYPE(glyphs->links[0]),
+                             glyphs->links.size(),
+                             glyphs->links.data());
+    }
 
     OWLGeom singleGlyphGeom
       = owlGeomCreate(context, glyphsType);
@@ -87,41 +126,18 @@ namespace glyphs {
     OWLGroup singleTubeGroup
       = owlUserGeomGroupCreate(context, 1, &singleGlyphGeom);
     
-    // compile progs here because we need the bounds prog in accelbuild:
-    owlBuildPrograms(context);
-    owlGroupBuildAccel(singleTubeGroup);
+    // the accel build needs the bounds prog; buildModules() built
+    // it already, so this is a no-op
+    buildPrograms();
+    {
+      ScopedTimer timer("BLAS");
+      buildAccel(MEM_BLAS,singleTubeGroup);
+    }
     
+    ScopedTimer xfmTimer("instance transforms");
     owl::parallel_for(numLinks,[&](int linkID) {
-        result[linkID].first = singleTubeGroup;
-        affine3f &xfm = result[linkID].second;
-        const Link A = glyphs->links[linkID];
-        if (A.prev < 0) {
-          xfm
-            = affine3f::translate(A.pos);
-          xfm.l.vx *= glyphs->radius;
-          xfm.l.vy *= glyphs->radius;
-          xfm.l.vz *= glyphs->radius;
-          return;
-        }
-        
-        const Link B = glyphs->links[A.prev];
-        const float linkLength = length(A.pos - B.pos)+glyphs->radius;
-        if (linkLength <= 1e-6f) {
-          // too short, ignore this,it'll only get numerically weird...
-          xfm
-            = affine3f::translate(A.pos);
-          xfm.l.vx *= glyphs->radius;
-          xfm.l.vy *= glyphs->radius;
-          xfm.l.vz *= glyphs->radius;
-          return;
-        }
-        
-        xfm
-          = affine3f::translate(B.pos)
-          * affine3f(frame(normalize(A.pos-B.pos)));
-        xfm.l.vx *= glyphs->radius;
-        xfm.l.vy *= glyphs->radius;
-        xfm.l.vz *= linkLength;
+        result[linkID].first  = singleTubeGroup;
+        result[linkID].second = arrowXform(glyphs,glyphs->links[linkID]);
       });
     return result;
   }
@@ -144,6 +160,22 @@ namespace glyphs {
       owlInstanceGroupSetTransform(world, i, &(const owl4x3f&)rootGroups[i].second);
     }
 
-    owlGroupBuildAccel(this->world);
+    ScopedTimer timer("TLAS");
+    buildAccel(MEM_TLAS,this->world);
+  }
+
+  void ArrowGlyphs::updateGlyphs(Glyphs::SP glyphs, bool rebuild)
+  {
+    // all instances share the same (unit) glyph group, so only the
+    // links and instance transforms change
+    owlBufferUpload(linkBuffer,glyphs->links.data());
+
+    const int numLinks = glyphs->links.size();
+    std::vector<affine3f> xfms(numLinks);
+    owl::parallel_for(numLinks,[&](int linkID) {
+        xfms[linkID] = arrowXform(glyphs,glyphs->links[linkID]);
+      });
+    for (int i=0; i<numLinks; i++)
+      owlInstanceGroupSetTransform(world, i, &(const owl4x3f&)xfms[i]);
   }
 }
@@ -0,0 +1,139 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace glyphs {
+
+  /*! quoted, with quotes, backslashes and control characters
+      escaped */
+  inline std::string jsonString(const std::string &s)
+  {
+    std::string result = "\"";
+    for (char c : s) {
+      if (c == '"' || c == '\\')
+        result += std::string("\\")+c;
+      else if ((unsigned char)c < 0x20)
+        result += ' ';
+      else
+        result += c;
+    }
+    return result+"\"";
+  }
+
+  /*! what results are filed under: the first input file's name,
+      without its directory, and how many more there are */
+  inline std::string datasetName(const std::vector<std::string> &fileNames)
+  {
+    if (fileNames.empty()) return "";
+    const std::string &first = fileNames[0];
+    std::string name = first.substr(first.find_last_of("/\\")+1);
+    if (fileNames.size() > 1)
+      name += "+"+std::to_string(fileNames.size()-1);
+    return name;
+  }
+
+  /*! the frames of one benchmark run (after warmup): time and rays
+      of each, and the summary statistics we compare across commits
+      and machines */
+  struct BenchRun {
+    typedef std::vector<std::pair<std::string,std::string>> Config;
+
+    void addFrame(double seconds, double rays)
+    {
+      frameSeconds.push_back(seconds);
+      totalRays += rays;
+    }
+
+    size_t numFrames() const { return frameSeconds.size(); }
+
+    /*! nearest-rank percentile of the frame times, p in [0,100] */
+    double percentile(double p) const
+    {
+      if (frameSeconds.empty()) return 0.;
+      std::vector<double> sorted = frameSeconds;
+      std::sort(sorted.begin(),sorted.end());
+      const size_t rank = (size_t)std::ceil(p/100.*sorted.size());
+      return sorted[std::min(std::max(rank,size_t(1)),sorted.size())-1];
+    }
+
+    double totalSeconds() const
+    {
+      double sum = 0.;
+      for (double t : frameSeconds) sum += t;
+      return sum;
+    }
+
+    double mraysPerSecond() const
+    {
+      const double t = totalSeconds();
+      return t > 0. ? totalRays/t*1e-6 : 0.;
+    }
+
+    /*! one JSON object: 'config' (written as strings), warmup, frame
+        and sample counts, the seed, min/median/mean/p95/p99/max
+        frame time in ms, MRays/s, and every frame's time */
+    void printJSON(std::ostream &out, const Config &config,
+                   const std::string &indent = "") const
+    {
+      const double ms = 1000.;
+      const std::ios::fmtflags flags = out.flags();
+      out << indent << "{" << std::endl
+          << indent << "  \"config\": {";
+      for (size_t i=0;i<config.size();i++)
+        out << (i ? ", " : " ") << jsonString(config[i].first)
+            << ": " << jsonString(config[i].second);
+      out << " }," << std::endl;
+      out << std::setprecision(6)
+          << indent << "  \"warmupFrames\": " << warmupFrames << "," << std::endl
+          << indent << "  \"frames\": " << numFrames() << "," << std::endl
+          << indent << "  \"samplesPerPixel\": " << samplesPerPixel << "," << std::endl
+          << indent << "  \"seed\": " << seed << "," << std::endl
+          << indent << "  \"frameTimeMs\": {"
+          << " \"min\": " << ms*percentile(0.)
+          << ", \"median\": " << ms*percentile(50.)
+          << ", \"mean\": " << ms*totalSeconds()/std::max(numFrames(),size_t(1))
+          << ", \"p95\": " << ms*percentile(95.)
+          << ", \"p99\": " << ms*percentile(99.)
+          << ", \"max\": " << ms*percentile(100.) << " }," << std::endl
+          << indent << "  \"rays\": " << totalRays << "," << std::endl
+          << indent << "  \"mraysPerSecond\": " << mraysPerSecond() << "," << std::endl
+          << indent << "  \"frameTimesMs\": [";
+      for (size_t i=0;i<frameSeconds.size();i++)
+        out << (i ? ", " : " ") << ms*frameSeconds[i];
+      out << " ]" << std::endl
+          << indent << "}";
+      out.flags(flags);
+    }
+
+    int      warmupFrames    { 0 };
+    /*! in total, over all measured frames */
+    int      samplesPerPixel { 0 };
+    uint32_t seed            { 0 };
+    std::vector<double> frameSeconds;
+    double   totalRays       { 0. };
+  };
+
+}
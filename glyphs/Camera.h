@@ -0,0 +1,78 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/FrameState.h"
+#include <sstream>
+#include <string>
+
+namespace glyphs {
+
+  /*! a from/at/up pinhole camera, as stored in '--camera' cmdline
+      args; for tools that do not have an OWLViewer to compute the
+      frame state camera for them */
+  struct Camera {
+    vec3f from { 0.f };
+    vec3f at   { 0.f, 0.f, -1.f };
+    vec3f up   { 0.f, 1.f, 0.f };
+    float fovy { 70.f };
+
+    /*! same setup as OWLViewer's SimpleCamera, so rays for a given
+        '--camera' are the same as in the viewer */
+    void setup(device::FrameState &fs, const vec2i &fbSize) const
+    {
+      const vec3f vz = normalize(from - at);
+      const vec3f vx = normalize(cross(up,vz));
+      const vec3f vy = cross(vz,vx);
+      const float aspect = fbSize.x / float(fbSize.y);
+      const float screen_height = 2.f*tanf(fovy/2.f * (float)M_PI/180.f);
+      const vec3f vertical   = screen_height * vy;
+      const vec3f horizontal = screen_height * aspect * vx;
+      fs.camera_screen_00   = - vz - 0.5f * vertical - 0.5f * horizontal;
+      fs.camera_screen_du   = horizontal / float(fbSize.x);
+      fs.camera_screen_dv   = vertical   / float(fbSize.y);
+      fs.camera_lens_center = from;
+      fs.camera_lens_du     = vx;
+      fs.camera_lens_dv     = vy;
+    }
+
+    /*! as '--camera' cmdline args - what the viewer prints (C) and
+        stores in .params files */
+    std::string cmdline() const
+    {
+      std::stringstream str;
+      str.precision(10);
+      str << "--camera "
+          << from.x << " " << from.y << " " << from.z << " "
+          << at.x << " " << at.y << " " << at.z << " "
+          << up.x << " " << up.y << " " << up.z;
+      return str.str();
+    }
+
+    /*! camera looking at given scene bounds from the same default
+        direction the viewer uses */
+    static Camera defaultFor(const box3f &sceneBounds)
+    {
+      Camera camera;
+      camera.from = sceneBounds.center() + vec3f(-.3f,.7f,+1.f)*sceneBounds.span();
+      camera.at   = sceneBounds.center();
+      camera.up   = vec3f(0.f,1.f,0.f);
+      return camera;
+    }
+  };
+
+}
@@ -0,0 +1,76 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "glyphs/CameraPath.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace glyphs {
+
+  CameraPath CameraPath::load(const std::string &fileName)
+  {
+    std::ifstream in(fileName);
+    if (!in)
+      throw std::runtime_error("could not open camera path '"+fileName+"'");
+    CameraPath path;
+    std::string line;
+    for (int lineNo=1;std::getline(in,line);lineNo++) {
+      std::stringstream tokens(line);
+      std::string token;
+      while (tokens >> token && token != "--camera")
+        ;
+      if (token != "--camera")
+        continue;
+      Camera c;
+      if (!(tokens
+            >> c.from.x >> c.from.y >> c.from.z
+            >> c.at.x >> c.at.y >> c.at.z
+            >> c.up.x >> c.up.y >> c.up.z))
+        throw std::runtime_error(fileName+":"+std::to_string(lineNo)
+                                 +": '--camera' needs nine numbers");
+      path.keys.push_back(c);
+    }
+    if (path.keys.empty())
+      throw std::runtime_error("no '--camera' keys in '"+fileName+"'");
+    return path;
+  }
+
+  int CameraPath::numFrames(int framesPerKey) const
+  {
+    if (keys.empty()) return 0;
+    return int(keys.size()-1)*std::max(framesPerKey,1)+1;
+  }
+
+  Camera CameraPath::at(int frame, int framesPerKey) const
+  {
+    framesPerKey = std::max(framesPerKey,1);
+    const int key = std::min(frame/framesPerKey,int(keys.size())-1);
+    if (key+1 >= int(keys.size()))
+      return keys.back();
+    const float t = (frame-key*framesPerKey)/float(framesPerKey);
+    const Camera &a = keys[key];
+    const Camera &b = keys[key+1];
+    Camera c = a;
+    c.from = (1.f-t)*a.from + t*b.from;
+    c.at   = (1.f-t)*a.at   + t*b.at;
+    const vec3f up = (1.f-t)*a.up + t*b.up;
+    // opposite up vectors would cancel out; keep the first
+    c.up   = length(up) > 1e-6f ? normalize(up) : a.up;
+    return c;
+  }
+
+}
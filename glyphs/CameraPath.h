@@ -0,0 +1,49 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/Camera.h"
+#include <vector>
+
+namespace glyphs {
+
+  /*! a recorded camera path: keyframes, stored one per line as the
+      same '--camera ...' args the viewer prints and puts in .params
+      files (so a .params file is a one-key path). Played back with a
+      fixed number of frames per key, the cameras - and thus the
+      frames rendered - are the same on every run */
+  struct CameraPath {
+    /*! lines without '--camera' are ignored; throws if there are no
+        keys at all */
+    static CameraPath load(const std::string &fileName);
+
+    /*! one key's line */
+    static std::string keyLine(const Camera &camera)
+    { return camera.cmdline(); }
+
+    /*! frames a playback renders: framesPerKey from each key to the
+        next, plus one for the last key */
+    int numFrames(int framesPerKey) const;
+
+    /*! camera for playback frame 'frame': from, at and up linearly
+        interpolated between the two keys around it */
+    Camera at(int frame, int framesPerKey) const;
+
+    std::vector<Camera> keys;
+  };
+
+}
@@ -15,10 +15,12 @@
 // ======================================================================== //
 
 #include "Glyphs.h"
+#include "Timings.h"
 #include <cstddef>
 #include <fstream>
 #include <cstring>
 #include <future>
+#include <limits>
 
 namespace glyphs {
   using namespace owl;
@@ -96,11 +98,52 @@ namespace glyphs {
 
     return glyphs;
   }
+
+  static_assert(sizeof(Link) == 36, "'.bglyphs' files store Links as they are");
+
+  /*! See BinaryGlyphsHeader */
+  Glyphs::SP tryBinaryGlyphs(const std::string& fileName)
+  {
+    const std::string ext = getExt(fileName);
+    if (ext != ".bglyphs")
+      return nullptr;
+
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in)
+      throw std::runtime_error("could not open '"+fileName+"'");
+    BinaryGlyphsHeader header;
+    const BinaryGlyphsHeader expected;
+    in.read((char *)&header,sizeof(header));
+    if (!in || memcmp(header.magic,expected.magic,sizeof(header.magic)))
+      throw std::runtime_error("'"+fileName+"' is not a binary glyphs file");
+    if (header.numLinks >= (uint64_t)std::numeric_limits<int>::max())
+      throw std::runtime_error("'"+fileName+"' has more links than 'prev' can index");
+
+    Glyphs::SP glyphs = std::make_shared<Glyphs>();
+    glyphs->radius = header.radius;
+    glyphs->links.resize(header.numLinks);
+    // in pieces, so huge files don't need one huge read
+    const size_t chunk = size_t(1)<<20;
+    for (size_t begin=0;begin<header.numLinks;begin+=chunk) {
+      const size_t count = std::min(chunk,size_t(header.numLinks)-begin);
+      in.read((char *)&glyphs->links[begin],count*sizeof(Link));
+      if (!in)
+        throw std::runtime_error("'"+fileName+"' is truncated");
+    }
+    for (size_t i=0;i<glyphs->links.size();i++)
+      if (glyphs->links[i].prev < -1
+          || glyphs->links[i].prev >= (int)glyphs->links.size())
+        throw std::runtime_error("'"+fileName+"': link "+std::to_string(i)
+                                 +" has an invalid predecessor");
+    return glyphs;
+  }
           
   Glyphs::SP Glyphs::load(const std::string& fileName)
   {
     if (Glyphs::SP glyphs = tryGlyphs(fileName))
       return glyphs;
+    if (Glyphs::SP glyphs = tryBinaryGlyphs(fileName))
+      return glyphs;
 
     throw std::runtime_error("could not load/create input '"+fileName+"'");
   }
@@ -108,17 +151,26 @@ namespace glyphs {
   /*! load several files */
   Glyphs::SP Glyphs::load(const std::vector<std::string>& fileNames)
   {
-    std::vector<std::future<Glyphs::SP>> files;
-    for (std::size_t i=0; i<fileNames.size(); ++i) {
-      const std::string file = fileNames[i];
-      files.emplace_back(std::async(std::launch::async, [file](){
-        return load(file);
-      }));
+    // the files parse in parallel; wait for all of them before
+    // merging, so the timings tell the two apart
+    std::vector<Glyphs::SP> loaded(fileNames.size());
+    {
+      ScopedTimer timer("parse");
+      std::vector<std::future<Glyphs::SP>> files;
+      for (std::size_t i=0; i<fileNames.size(); ++i) {
+        const std::string file = fileNames[i];
+        files.emplace_back(std::async(std::launch::async, [file](){
+          return load(file);
+        }));
+      }
+      for (std::size_t i=0; i<fileNames.size(); ++i)
+        loaded[i] = files[i].get();
     }
 
+    ScopedTimer timer("merge timesteps");
     Glyphs::SP result = nullptr;
     for (std::size_t i=0; i<fileNames.size(); ++i) {
-      Glyphs::SP glyphs = files[i].get();
+      Glyphs::SP glyphs = loaded[i];
       if (glyphs == nullptr) {
         throw std::runtime_error("could not load/create input from file no. '"+std::to_string(i)+"'");
       }
@@ -19,6 +19,7 @@
 #include "device/common.h"
 #include "device/GlyphsGeom.h"
 // std
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <string>
@@ -26,6 +27,16 @@
 namespace glyphs {
 
   using device::Link;
+
+  /*! header of a binary '.bglyphs' file; followed by numLinks
+      device::Links, as they are in memory - so, unlike '.glyphs',
+      these can hold chains of links (see glyphGen.cpp) */
+  struct BinaryGlyphsHeader {
+    char     magic[8] { 'G','L','Y','P','H','S','B','1' };
+    uint64_t numLinks { 0 };
+    float    radius   { .2f };
+    uint32_t reserved { 0 };
+  };
   
   /*! the entire set of glyphs, including all links - everything we
     wnat to render */
@@ -0,0 +1,135 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "glyphs/MemoryTracker.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace glyphs {
+
+  const char *memoryTagName(int tag)
+  {
+    static const char *names[NUM_MEMORY_TAGS] = {
+      "frame state",
+      "accum",
+      "stats",
+      "links",
+      "vertices",
+      "glyph params",
+      "blas",
+      "tlas",
+      "proxy bvh",
+      "frame buffer"
+    };
+    return names[tag];
+  }
+
+  bool memoryTagOnHost(int tag)
+  {
+    return tag == MEM_STATS || tag == MEM_PROXY_BVH || tag == MEM_FRAME_BUFFER;
+  }
+
+  static double MB(size_t bytes)
+  {
+    return bytes/(1024.*1024.);
+  }
+
+  size_t MemoryTracker::currentTotal(bool onHost) const
+  {
+    size_t total = 0;
+    for (int i=0;i<NUM_MEMORY_TAGS;i++)
+      if (memoryTagOnHost(i) == onHost)
+        total += currentBytes[i];
+    return total;
+  }
+
+  void MemoryTracker::checkBudget(MemoryTag tag, size_t bytes,
+                                  const void *handle) const
+  {
+    if (!budget || memoryTagOnHost(tag))
+      return;
+    // what a re-allocation replaces doesn't count
+    auto it = allocations.find(handle);
+    const size_t oldDeviceBytes
+      = (it != allocations.end() && !memoryTagOnHost(it->second.tag))
+      ? it->second.bytes : 0;
+    if (currentTotal(false)-oldDeviceBytes+bytes <= budget)
+      return;
+
+    std::stringstream msg;
+    msg << "#glyphs.memory: allocating " << std::fixed << std::setprecision(2)
+        << MB(bytes) << " MB of '" << memoryTagName(tag)
+        << "' would exceed the device memory budget of "
+        << MB(budget) << " MB" << std::endl;
+    printReport(msg);
+    throw std::runtime_error(msg.str());
+  }
+
+  void MemoryTracker::allocate(const void *handle, MemoryTag tag, size_t bytes)
+  {
+    checkBudget(tag,bytes,handle);
+    release(handle);
+    allocations[handle] = { tag, bytes };
+    currentBytes[tag] += bytes;
+    numAllocations[tag]++;
+    peakBytes[tag] = std::max(peakBytes[tag],currentBytes[tag]);
+    const bool onHost = memoryTagOnHost(tag);
+    peakTotalBytes[onHost] = std::max(peakTotalBytes[onHost],currentTotal(onHost));
+  }
+
+  void MemoryTracker::release(const void *handle)
+  {
+    auto it = allocations.find(handle);
+    if (it == allocations.end())
+      return;
+    currentBytes[it->second.tag] -= it->second.bytes;
+    numAllocations[it->second.tag]--;
+    allocations.erase(it);
+  }
+
+  size_t MemoryTracker::bytesOf(const void *handle) const
+  {
+    auto it = allocations.find(handle);
+    return it == allocations.end() ? 0 : it->second.bytes;
+  }
+
+  void MemoryTracker::printReport(std::ostream &out) const
+  {
+    out << std::left << std::setw(16) << "memory" << std::right
+        << std::setw(8)  << "where"
+        << std::setw(12) << "current MB"
+        << std::setw(12) << "peak MB"
+        << std::setw(10) << "allocs" << std::endl;
+    out << std::fixed << std::setprecision(2);
+    for (int i=0;i<NUM_MEMORY_TAGS;i++)
+      out << std::left << std::setw(16) << memoryTagName(i) << std::right
+          << std::setw(8)  << (memoryTagOnHost(i) ? "host" : "device")
+          << std::setw(12) << MB(currentBytes[i])
+          << std::setw(12) << MB(peakBytes[i])
+          << std::setw(10) << numAllocations[i] << std::endl;
+    for (int onHost=0;onHost<2;onHost++)
+      out << std::left << std::setw(16) << "total" << std::right
+          << std::setw(8)  << (onHost ? "host" : "device")
+          << std::setw(12) << MB(currentTotal(onHost))
+          << std::setw(12) << MB(peakTotalBytes[onHost])
+          << std::setw(10) << "" << std::endl;
+    if (budget)
+      out << "device budget " << MB(budget) << " MB" << std::endl;
+  }
+
+}
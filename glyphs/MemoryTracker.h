@@ -0,0 +1,103 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+
+namespace glyphs {
+
+  /*! what an allocation is for; see memoryTagName() */
+  enum MemoryTag {
+    /*! FrameState */
+    MEM_FRAME_STATE=0,
+    /*! accum, half accum, variance and surface buffers - all per
+        pixel */
+    MEM_ACCUM,
+    /*! host-pinned error, ray and pixel stats read back per frame */
+    MEM_STATS,
+    /*! the glyphs' Links */
+    MEM_LINKS,
+    /*! vertex, color and index buffers of triangle meshes and
+        tessellated glyphs */
+    MEM_VERTICES,
+    /*! per super-glyph rst and ABC parameters */
+    MEM_GLYPH_PARAMS,
+    /*! bottom-level acceleration structures */
+    MEM_BLAS,
+    /*! the world's instance acceleration structure */
+    MEM_TLAS,
+    /*! host-side proxy BVH, see OWLGlyphs::setTimestep() */
+    MEM_PROXY_BVH,
+    /*! host-pinned color buffer, for rendering without a window */
+    MEM_FRAME_BUFFER,
+    NUM_MEMORY_TAGS
+  };
+
+  const char *memoryTagName(int tag);
+
+  /*! whether a tag's allocations live on the device or the host */
+  bool memoryTagOnHost(int tag);
+
+  /*! current and peak bytes by MemoryTag. Allocations are identified
+      by an opaque handle (an OWLBuffer or OWLGroup, say), so a
+      re-allocation (resize, rebuild) replaces the old size */
+  struct MemoryTracker {
+    /*! throws (with the current breakdown in the message) if
+        allocating 'bytes' more for 'tag' - or re-allocating 'handle'
+        with that many - would take the device total over the
+        budget */
+    void checkBudget(MemoryTag tag, size_t bytes,
+                     const void *handle=nullptr) const;
+    /*! records that 'handle' now holds 'bytes'; checks the budget
+        first, and records nothing if that throws */
+    void allocate(const void *handle, MemoryTag tag, size_t bytes);
+    /*! forgets about 'handle'; no-op for unknown handles */
+    void release(const void *handle);
+
+    /*! what 'handle' holds now; 0 if unknown */
+    size_t bytesOf(const void *handle) const;
+
+    size_t current(int tag) const { return currentBytes[tag]; }
+    size_t peak(int tag) const { return peakBytes[tag]; }
+    /*! over all device (or all host) tags */
+    size_t currentTotal(bool onHost) const;
+    size_t peakTotal(bool onHost) const { return peakTotalBytes[onHost]; }
+
+    /*! one line per tag: where, current and peak MB, number of
+        allocations; plus device and host totals */
+    void printReport(std::ostream &out) const;
+
+    /*! if non-zero, allocations that would take the device total over
+        this many bytes throw */
+    size_t budget { 0 };
+
+  private:
+    struct Allocation {
+      MemoryTag tag;
+      size_t    bytes;
+    };
+    std::map<const void *,Allocation> allocations;
+    size_t currentBytes[NUM_MEMORY_TAGS] {};
+    size_t peakBytes[NUM_MEMORY_TAGS] {};
+    size_t numAllocations[NUM_MEMORY_TAGS] {};
+    /*! indexed by memoryTagOnHost() */
+    size_t peakTotalBytes[2] {};
+  };
+
+}
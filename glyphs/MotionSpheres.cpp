@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "glyphs/MotionSpheres.h"
+#include "glyphs/Timings.h"
 
 namespace glyphs {
   
@@ -24,7 +25,7 @@ namespace glyphs {
 
   MotionSpheres::MotionSpheres()
   {
-    module = owlModuleCreate(context, embedded_MotionSpheres_programs);
+    module = createModule(embedded_MotionSpheres_programs);
 
     OWLVarDecl glyphsVars[] = {
       { "links",  OWL_BUFPTR, OWL_OFFSETOF(GlyphsGeom,links)},
@@ -50,22 +51,29 @@ namespace glyphs {
 
   OWLGroup MotionSpheres::buildGlyphs(Glyphs::SP glyphs)
   {
-    linkBuffer
-      = owlDeviceBufferCreate(context,
-                              OWL_USER_TYPE(glyphs->links[0]),
-                              glyphs->links.size(),
-                              glyphs->links.data());
+    ScopedTimer timer("build glyphs");
+    {
+      ScopedTimer timer("upload links");
+      linkBuffer
+        = createDeviceBuffer(MEM_LINKS,
+                             OWL_USER_TYPE(glyphs->links[0]),
+                             glyphs->links.size(),
+                             glyphs->links.data());
+    }
 
     OWLGeom geom = owlGeomCreate(context, glyphsType);
     owlGeomSetPrimCount(geom, glyphs->links.size());
 
     owlGeomSetBuffer(geom, "links", linkBuffer);
     owlGeomSet1f(geom, "radius", glyphs->radius);
-    owlBuildPrograms(context);
+    // the accel build needs the bounds prog; buildModules() built
+    // it already, so this is a no-op
+    buildPrograms();
     
-    OWLGroup glyphsGroup = owlUserGeomGroupCreate(context, 1, &geom);
-    owlGroupBuildAccel(glyphsGroup);
-    return glyphsGroup;
+    OWLGroup group = owlUserGeomGroupCreate(context, 1, &geom);
+    ScopedTimer blasTimer("BLAS");
+    buildAccel(MEM_BLAS,group);
+    return group;
   }
   
   void MotionSpheres::build(Glyphs::SP glyphs,
@@ -75,7 +83,7 @@ namespace glyphs {
     
     std::vector<OWLGroup> rootGroups;
 
-    OWLGroup glyphsGroup = buildGlyphs(glyphs);
+    glyphsGroup = buildGlyphs(glyphs);
     if (glyphsGroup)
       rootGroups.push_back(glyphsGroup);
 
@@ -89,7 +97,19 @@ namespace glyphs {
     for (int i=0;i<rootGroups.size();i++)
       owlInstanceGroupSetChild(this->world, i, rootGroups[i]);
 		
-    owlGroupBuildAccel(this->world);
+    ScopedTimer timer("TLAS");
+    buildAccel(MEM_TLAS,this->world);
+  }
+
+  void MotionSpheres::updateGlyphs(Glyphs::SP glyphs, bool rebuild)
+  {
+    // all glyphs live in one user geom, whose bounds program reads
+    // the links - so it's this group that needs the refit
+    owlBufferUpload(linkBuffer,glyphs->links.data());
+    if (rebuild)
+      buildAccel(MEM_BLAS,glyphsGroup);
+    else
+      owlGroupRefitAccel(glyphsGroup);
   }
 
 }
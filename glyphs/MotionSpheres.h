@@ -33,8 +33,13 @@ namespace glyphs {
     void build(Glyphs::SP glyphs,
                Triangles::SP triangles) override;
 
+  protected:
+    void updateGlyphs(Glyphs::SP glyphs, bool rebuild) override;
+
   private:
     OWLGroup buildGlyphs(Glyphs::SP glyphs);
+
+    OWLGroup glyphsGroup = 0;
   };
   
 }
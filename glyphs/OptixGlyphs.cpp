@@ -17,6 +17,12 @@
 #include "glyphs/OptixGlyphs.h"
 #include "glyphs/device/GlyphsGeom.h"
 #include "glyphs/device/RayGenData.h"
+#include "glyphs/Timings.h"
+#include <owl/common/parallel/parallel_for.h>
+#include <cuda_runtime.h>
+#include <optix.h>
+#include <optix_stubs.h>
+#include <sstream>
 
 namespace glyphs {
 
@@ -26,14 +32,42 @@ namespace glyphs {
   using device::TrianglesGeomData;
   
   extern "C" const char embedded_common_programs[];
+
+  std::string OWLGlyphs::programCacheDir = ProgramCache::defaultDir();
+
+  /*! unless the user set it already */
+  static void setEnvDefault(const char *name, const std::string &value)
+  {
+    if (getenv(name)) return;
+#if _WIN32
+    _putenv_s(name,value.c_str());
+#else
+    setenv(name,value.c_str(),0);
+#endif
+  }
   
   OWLGlyphs::OWLGlyphs()
   {
-    context = owlContextCreate();//optix::ContextObj::create();
-    module  = owlModuleCreate(context, embedded_common_programs);
-    frameStateBuffer = owlDeviceBufferCreate(context,
-                                             OWL_USER_TYPE(device::FrameState),
-                                             1,nullptr);
+    {
+      ScopedTimer timer("create context");
+      // the CUDA JIT (bounds programs) reads these when the driver
+      // initializes, so they have to be set before the context
+      const std::string cudaCacheDir = programCache.artifactDir("cuda");
+      if (!cudaCacheDir.empty()) {
+        setEnvDefault("CUDA_CACHE_PATH",cudaCacheDir);
+        setEnvDefault("CUDA_CACHE_MAXSIZE",
+                      std::to_string(std::min(programCache.maxBytes/2,size_t(4u<<30)-1)));
+      }
+      context = owlContextCreate();//optix::ContextObj::create();
+      setupDriverCaches();
+    }
+    {
+      ScopedTimer timer("create module");
+      module  = createModule(embedded_common_programs);
+    }
+    frameStateBuffer = createDeviceBuffer(MEM_FRAME_STATE,
+                                          OWL_USER_TYPE(device::FrameState),
+                                          1,nullptr);
 
     // -------------------------------------------------------
     // triangle mesh
@@ -74,6 +108,12 @@ namespace glyphs {
       { "deviceCount",     OWL_INT,    OWL_OFFSETOF(RayGenData,deviceCount)},
       { "colorBuffer",     OWL_RAW_POINTER, OWL_OFFSETOF(RayGenData,colorBufferPtr)},
       { "accumBuffer",     OWL_BUFPTR, OWL_OFFSETOF(RayGenData,accumBufferPtr)},
+      { "halfAccumBuffer", OWL_BUFPTR, OWL_OFFSETOF(RayGenData,halfAccumBufferPtr)},
+      { "varianceBuffer",  OWL_BUFPTR, OWL_OFFSETOF(RayGenData,varianceBufferPtr)},
+      { "surfaceBuffer",   OWL_BUFPTR, OWL_OFFSETOF(RayGenData,surfaceBufferPtr)},
+      { "errorStats",      OWL_BUFPTR, OWL_OFFSETOF(RayGenData,errorStatsPtr)},
+      { "rayStats",        OWL_BUFPTR, OWL_OFFSETOF(RayGenData,rayStatsPtr)},
+      { "pixelStats",      OWL_BUFPTR, OWL_OFFSETOF(RayGenData,pixelStatsPtr)},
       { "linkBuffer",  OWL_BUFPTR, OWL_OFFSETOF(RayGenData,linkBuffer)},
       { "frameStateBuffer",OWL_BUFPTR, OWL_OFFSETOF(RayGenData,frameStateBuffer)},
       { "fbSize",          OWL_INT2,   OWL_OFFSETOF(RayGenData,fbSize)},
@@ -81,28 +121,183 @@ namespace glyphs {
       { /* sentinel to mark end of list */ }
     };
 
-    // ........... create object  ............................
-    this->rayGen
-      = owlRayGenCreate(context,module,"raygen_program",
+    // ........... create objects ............................
+    for (int variant=0;variant<device::NUM_RENDER_VARIANTS;variant++)
+      rayGens[variant]
+        = owlRayGenCreate(context,module,device::raygenProgramName(variant),
+                          sizeof(RayGenData),
+                          rayGenVars,-1);
+    displayRayGen
+      = owlRayGenCreate(context,module,"display_program",
                         sizeof(RayGenData),
                         rayGenVars,-1);
 
-    owlRayGenSetBuffer(rayGen,"frameStateBuffer",frameStateBuffer);    
+    errorStatsBuffer
+      = createHostPinnedBuffer(MEM_STATS,OWL_FLOAT,2*owlGetDeviceCount(context));
+
+    const int rayStatsCounters
+      = sizeof(device::RayStats)/sizeof(device::RayStats::Counter);
+    rayStatsBuffer
+      = createHostPinnedBuffer(MEM_STATS,OWL_ULONG,
+                               rayStatsCounters*owlGetDeviceCount(context));
+
+    for (OWLRayGen rayGen : allRayGens()) {
+      owlRayGenSetBuffer(rayGen,"frameStateBuffer",frameStateBuffer);
+      owlRayGenSetBuffer(rayGen,"errorStats",errorStatsBuffer);
+      owlRayGenSetBuffer(rayGen,"rayStats",rayStatsBuffer);
+    }
+  }
+
+  OWLGlyphs::~OWLGlyphs()
+  {
+    owlContextDestroy(context);
+  }
+
+  std::vector<OWLRayGen> OWLGlyphs::allRayGens() const
+  {
+    std::vector<OWLRayGen> result(rayGens,rayGens+device::NUM_RENDER_VARIANTS);
+    result.push_back(displayRayGen);
+    return result;
+  }
+
+  /*! bounds of each link segment, irrespective of glyph type; good
+      enough to track how glyphs move relative to each other */
+  static void computeProxyBounds(Glyphs::SP glyphs,
+                                 std::vector<box3f> &bounds)
+  {
+    const std::vector<Link> &links = glyphs->links;
+    bounds.resize(links.size());
+    owl::parallel_for(links.size(),[&](size_t linkID) {
+        const Link &l = links[linkID];
+        box3f box(l.pos-l.rad,l.pos+l.rad);
+        if (l.prev >= 0) {
+          const Link &prev = links[l.prev];
+          box.extend(prev.pos-prev.rad).extend(prev.pos+prev.rad);
+        }
+        bounds[linkID] = box;
+      });
   }
 
   void OWLGlyphs::setModel(Glyphs::SP glyphs, Triangles::SP triangles)
   {
-    build(glyphs,triangles);
+    double t0 = getCurrentTime();
+    {
+      ScopedTimer timer("build");
+      build(glyphs,triangles);
+    }
+    lastBuildTime = getCurrentTime()-t0;
     
-    owlRayGenSetGroup(rayGen,"world",world);
-    owlRayGenSetBuffer(rayGen,"linkBuffer",linkBuffer);
+    for (OWLRayGen rayGen : allRayGens()) {
+      owlRayGenSetGroup(rayGen,"world",world);
+      owlRayGenSetBuffer(rayGen,"linkBuffer",linkBuffer);
+    }
     
-    owlBuildSBT(context);
+    {
+      ScopedTimer timer("build SBT");
+      owlBuildSBT(context);
+    }
+
+    ScopedTimer timer("proxy BVH");
+    numLinks = glyphs->links.size();
+    computeProxyBounds(glyphs,proxyBounds);
+    proxyBVH.build(proxyBounds);
+    proxySAH = proxyBVH.sahCost();
+    memory.allocate(&proxyBVH,MEM_PROXY_BVH,
+                    proxyBVH.nodes.capacity()*sizeof(cpu::BVH::Node)
+                    + proxyBVH.primIDs.capacity()*sizeof(int)
+                    + proxyBounds.capacity()*sizeof(box3f));
+  }
+
+  void OWLGlyphs::setTimestep(Glyphs::SP glyphs)
+  {
+    if (glyphs->links.size() != numLinks)
+      throw std::runtime_error("#glyphs: timestep has different number of links"
+                               " than the one passed to setModel() - can't refit");
+
+    computeProxyBounds(glyphs,proxyBounds);
+    proxyBVH.refit(proxyBounds);
+    const float sahGrowth = proxyBVH.sahCost() / max(proxySAH,1e-20f);
+    const bool  rebuild   = sahGrowth > rebuildThreshold;
+
+    double t0 = getCurrentTime();
+    {
+      ScopedTimer timer(rebuild ? "rebuild timestep" : "refit timestep");
+      updateGlyphs(glyphs,rebuild);
+      ScopedTimer tlasTimer("TLAS");
+      if (rebuild)
+        buildAccel(MEM_TLAS,world);
+      else
+        owlGroupRefitAccel(world);
+    }
+    const double t = getCurrentTime()-t0;
+
+    if (rebuild) {
+      std::cout << "#glyphs: SAH cost grew by " << sahGrowth << "x (> "
+                << rebuildThreshold << "x), full rebuild took "
+                << prettyDouble(t) << "s" << std::endl;
+      lastBuildTime = t;
+      proxyBVH.build(proxyBounds);
+      proxySAH = proxyBVH.sahCost();
+    } else {
+      std::cout << "#glyphs: refit took " << prettyDouble(t)
+                << "s (est. SAH cost growth " << sahGrowth << "x),"
+                << " last full rebuild took " << prettyDouble(lastBuildTime)
+                << "s" << std::endl;
+    }
   }
 
   void OWLGlyphs::render()
   {
-    owlRayGenLaunch2D(rayGen,fbSize.x,fbSize.y);
+    float *stats = (float*)owlBufferGetPointer(errorStatsBuffer,0);
+    std::fill(stats,stats+2*owlGetDeviceCount(context),0.f);
+    device::RayStats *rayStats
+      = (device::RayStats*)owlBufferGetPointer(rayStatsBuffer,0);
+    std::fill(rayStats,rayStats+owlGetDeviceCount(context),device::RayStats());
+    const vec2i launchDims = device::motionLaunchDims(fbSize,motionScale);
+    owlRayGenLaunch2D(rayGens[renderVariant],launchDims.x,launchDims.y);
+  }
+
+  void OWLGlyphs::display()
+  {
+    owlRayGenLaunch2D(displayRayGen,fbSize.x,fbSize.y);
+  }
+
+  device::ErrorStats OWLGlyphs::getErrorStats() const
+  {
+    const float *stats = (const float*)owlBufferGetPointer(errorStatsBuffer,0);
+    float sumError = 0.f, numSamples = 0.f;
+    for (int i=0;i<owlGetDeviceCount(context);i++) {
+      sumError   += stats[2*i+0];
+      numSamples += stats[2*i+1];
+    }
+    const float numPixels = max(1.f,float(fbSize.x)*fbSize.y);
+    device::ErrorStats result;
+    result.meanRelativeError = sumError / numPixels;
+    result.samplesPerPixel   = numSamples / numPixels;
+    return result;
+  }
+
+  device::RayStats OWLGlyphs::getRayStats() const
+  {
+    const device::RayStats *stats
+      = (const device::RayStats*)owlBufferGetPointer(rayStatsBuffer,0);
+    device::RayStats result;
+    for (int i=0;i<owlGetDeviceCount(context);i++)
+      result += stats[i];
+    return result;
+  }
+
+  device::PixelStatsSummary OWLGlyphs::getPixelStats() const
+  {
+    device::PixelStatsSummary result;
+#if GLYPHS_STATS
+    const device::PixelStats *stats
+      = (const device::PixelStats*)owlBufferGetPointer(pixelStatsBuffer,0);
+    const size_t numPixels = size_t(fbSize.x)*fbSize.y;
+    for (size_t i=0;i<numPixels;i++)
+      result.add(stats[i]);
+#endif
+    return result;
   }
 
   OWLGroup OWLGlyphs::buildTriangles(Triangles::SP triangles)
@@ -110,6 +305,8 @@ namespace glyphs {
     if (triangles == 0) // ...
       return 0;
 
+    ScopedTimer timer("build triangles");
+
     std::vector<vec3f> vertices;
     std::vector<vec3f> colors;
     std::vector<vec3i> indices;
@@ -133,11 +330,11 @@ namespace glyphs {
     // triangle mesh
     // ------------------------------------------------------------------
     OWLBuffer vertexBuffer
-      = owlDeviceBufferCreate(context, OWL_FLOAT3, vertices.size(), vertices.data());
+      = createDeviceBuffer(MEM_VERTICES, OWL_FLOAT3, vertices.size(), vertices.data());
     OWLBuffer colorBuffer
-      = owlDeviceBufferCreate(context, OWL_FLOAT3, colors.size(), colors.data());
+      = createDeviceBuffer(MEM_VERTICES, OWL_FLOAT3, colors.size(), colors.data());
     OWLBuffer indexBuffer
-      = owlDeviceBufferCreate(context, OWL_INT3, indices.size(), indices.data());
+      = createDeviceBuffer(MEM_VERTICES, OWL_INT3, indices.size(), indices.data());
 
     OWLGeom trianglesGeom
       = owlGeomCreate(context, trianglesGeomType);
@@ -157,7 +354,10 @@ namespace glyphs {
     // ------------------------------------------------------------------
     OWLGroup triGroup
       = owlTrianglesGeomGroupCreate(context, 1, &trianglesGeom);
-    owlGroupBuildAccel(triGroup);
+    {
+      ScopedTimer timer("BLAS");
+      buildAccel(MEM_BLAS,triGroup);
+    }
     PRINT(triGroup);
     return triGroup;
   }
@@ -165,20 +365,51 @@ namespace glyphs {
   void OWLGlyphs::resizeFrameBuffer(void *fbPointer, const vec2i &newSize)
   {
     fbSize = newSize;
+    const size_t numPixels = size_t(fbSize.x)*fbSize.y;
+    // current and previous view, see FrameState::historyIndex
+    const size_t numHistories = temporalReprojection ? 2 : 1;
+    // only the accum buffer in use gets allocated
+    const size_t numAccum     = halfAccum ? 1 : numHistories*numPixels;
+    const size_t numHalfAccum = halfAccum ? numHistories*numPixels : 1;
     if (!accumBuffer)
-      accumBuffer = owlDeviceBufferCreate(context,OWL_FLOAT4,fbSize.x*fbSize.y,nullptr);
-    owlBufferResize(accumBuffer,fbSize.x*fbSize.y);
-    owlRayGenSetBuffer(rayGen,"accumBuffer",accumBuffer);
-    owlRayGenSet1i(rayGen,"deviceCount",owlGetDeviceCount(context));
+      accumBuffer = createDeviceBuffer(MEM_ACCUM,OWL_FLOAT4,numAccum,nullptr);
+    resizeBuffer(accumBuffer,numAccum);
+    if (!halfAccumBuffer)
+      halfAccumBuffer = createDeviceBuffer(MEM_ACCUM,OWL_USER_TYPE(device::HalfAccum),
+                                           numHalfAccum,nullptr);
+    resizeBuffer(halfAccumBuffer,numHalfAccum);
+    if (!varianceBuffer)
+      varianceBuffer = createDeviceBuffer(MEM_ACCUM,OWL_FLOAT,numHistories*numPixels,nullptr);
+    resizeBuffer(varianceBuffer,numHistories*numPixels);
+    const size_t numSurfaces = temporalReprojection ? numHistories*numPixels : 1;
+    if (!surfaceBuffer)
+      surfaceBuffer = createDeviceBuffer(MEM_ACCUM,OWL_USER_TYPE(device::Surface),
+                                         numSurfaces,nullptr);
+    resizeBuffer(surfaceBuffer,numSurfaces);
+    const size_t numPixelStats = GLYPHS_STATS ? numPixels : 1;
+    if (!pixelStatsBuffer)
+      pixelStatsBuffer = createHostPinnedBuffer(MEM_STATS,OWL_USER_TYPE(device::PixelStats),
+                                                numPixelStats);
+    resizeBuffer(pixelStatsBuffer,numPixelStats);
+    for (OWLRayGen rayGen : allRayGens()) {
+      owlRayGenSetBuffer(rayGen,"accumBuffer",accumBuffer);
+      owlRayGenSetBuffer(rayGen,"halfAccumBuffer",halfAccumBuffer);
+      owlRayGenSetBuffer(rayGen,"varianceBuffer",varianceBuffer);
+      owlRayGenSetBuffer(rayGen,"surfaceBuffer",surfaceBuffer);
+      owlRayGenSetBuffer(rayGen,"pixelStats",pixelStatsBuffer);
+      owlRayGenSet1i(rayGen,"deviceCount",owlGetDeviceCount(context));
       
-    owlRayGenSet1ul(rayGen,"colorBuffer",(uint64_t)fbPointer);
+      owlRayGenSet1ul(rayGen,"colorBuffer",(uint64_t)fbPointer);
 
-    owlRayGenSet2i(rayGen,"fbSize",fbSize.x,fbSize.y);
+      owlRayGenSet2i(rayGen,"fbSize",fbSize.x,fbSize.y);
+    }
   }
   
   void OWLGlyphs::updateFrameState(device::FrameState &fs)
   {
     owlBufferUpload(frameStateBuffer,&fs);
+    renderVariant = device::renderVariantOf(fs.shadeMode,fs.pathDepth,fs.shading);
+    motionScale   = fs.motionScale;
   }
 
   uint32_t *OWLGlyphs::mapColorBuffer()
@@ -192,11 +423,150 @@ namespace glyphs {
     assert(colorBuffer);
   }
 
-  void OWLGlyphs::buildModules()
+  /*! bytes per element; OWL_USER_TYPE(T) is OWL_USER_TYPE_BEGIN
+      plus sizeof(T) */
+  static size_t sizeOf(OWLDataType type)
+  {
+    if (type >= OWL_USER_TYPE_BEGIN)
+      return size_t(type - OWL_USER_TYPE_BEGIN);
+    switch (type) {
+    case OWL_INT:
+    case OWL_UINT:
+    case OWL_FLOAT:
+      return 4;
+    case OWL_INT2:
+    case OWL_UINT2:
+    case OWL_FLOAT2:
+    case OWL_ULONG:
+      return 8;
+    case OWL_INT3:
+    case OWL_FLOAT3:
+      return 12;
+    case OWL_FLOAT4:
+      return 16;
+    default:
+      throw std::runtime_error("#glyphs.memory: don't know the size of buffer type "
+                               +std::to_string((int)type));
+    }
+  }
+
+  OWLBuffer OWLGlyphs::createDeviceBuffer(MemoryTag tag, OWLDataType type,
+                                          size_t count, const void *init)
+  {
+    memory.checkBudget(tag,count*sizeOf(type));
+    OWLBuffer buffer = owlDeviceBufferCreate(context,type,count,init);
+    memory.allocate(buffer,tag,count*sizeOf(type));
+    bufferTypes[buffer] = { tag, sizeOf(type) };
+    return buffer;
+  }
+
+  OWLBuffer OWLGlyphs::createHostPinnedBuffer(MemoryTag tag, OWLDataType type,
+                                              size_t count)
+  {
+    OWLBuffer buffer = owlHostPinnedBufferCreate(context,type,count);
+    memory.allocate(buffer,tag,count*sizeOf(type));
+    bufferTypes[buffer] = { tag, sizeOf(type) };
+    return buffer;
+  }
+
+  void OWLGlyphs::resizeBuffer(OWLBuffer buffer, size_t count)
+  {
+    const std::pair<MemoryTag,size_t> type = bufferTypes.at(buffer);
+    memory.checkBudget(type.first,count*type.second,buffer);
+    owlBufferResize(buffer,count);
+    memory.allocate(buffer,type.first,count*type.second);
+  }
+
+  void OWLGlyphs::releaseBuffer(OWLBuffer buffer)
+  {
+    memory.release(buffer);
+    bufferTypes.erase(buffer);
+    owlBufferRelease(buffer);
+  }
+
+  /*! free memory on the current device */
+  static size_t freeDeviceMemory()
+  {
+    size_t free = 0, total = 0;
+    cudaMemGetInfo(&free,&total);
+    return free;
+  }
+
+  void OWLGlyphs::buildAccel(MemoryTag tag, OWLGroup group)
+  {
+    const size_t free0 = freeDeviceMemory();
+    owlGroupBuildAccel(group);
+    const size_t free1 = freeDeviceMemory();
+    // a rebuild frees what the group held before
+    const long long bytes
+      = (long long)memory.bytesOf(group) + (long long)free0 - (long long)free1;
+    memory.allocate(group,tag,(size_t)std::max(bytes,0ll));
+  }
+
+  void OWLGlyphs::releaseGroup(OWLGroup group)
+  {
+    memory.release(group);
+    owlGroupRelease(group);
+  }
+
+  void OWLGlyphs::setupDriverCaches()
+  {
+    const std::string optixCacheDir = programCache.artifactDir("optix");
+    if (optixCacheDir.empty()) return;
+    for (int deviceID=0;deviceID<owlGetDeviceCount(context);deviceID++) {
+      OptixDeviceContext optixContext
+        = owlContextGetOptixContext(context,deviceID);
+      // OPTIX_CACHE_PATH and OPTIX_CACHE_MAXSIZE, if set, win over
+      // these; that is the driver's business, not an error
+      if (optixDeviceContextSetCacheLocation(optixContext,optixCacheDir.c_str())
+          != OPTIX_SUCCESS
+          || optixDeviceContextSetCacheDatabaseSizes(optixContext,
+                                                     programCache.maxBytes/4,
+                                                     programCache.maxBytes/2)
+          != OPTIX_SUCCESS
+          || optixDeviceContextSetCacheEnabled(optixContext,1) != OPTIX_SUCCESS)
+        std::cerr << "#glyphs.cache: could not use '" << optixCacheDir
+                  << "' for device " << deviceID
+                  << "; OptiX uses its default cache" << std::endl;
+    }
+  }
+
+  std::string OWLGlyphs::programConfig() const
   {
+    std::stringstream config;
+    int driverVersion = 0;
+    cudaDriverGetVersion(&driverVersion);
+    config << "optix " << OPTIX_VERSION << ", driver " << driverVersion;
+    for (int deviceID=0;deviceID<owlGetDeviceCount(context);deviceID++) {
+      cudaDeviceProp prop;
+      cudaGetDeviceProperties(&prop,deviceID);
+      config << ", " << prop.name << " sm" << prop.major << prop.minor;
+    }
+    return config.str();
+  }
+
+  OWLModule OWLGlyphs::createModule(const char *ptx)
+  {
+    programSources.push_back(ptx);
+    return owlModuleCreate(context,ptx);
+  }
+
+  void OWLGlyphs::buildPrograms()
+  {
+    if (programsBuilt) return;
+    ScopedTimer timer("build programs");
     std::cout << "building programs" << std::endl;
-    owlBuildPrograms(context);
+    programCache.build("programs",
+                       ProgramCache::key(programSources,programConfig()),
+                       [&]() { owlBuildPrograms(context); });
+    programsBuilt = true;
+  }
+
+  void OWLGlyphs::buildModules()
+  {
+    buildPrograms();
 
+    ScopedTimer timer("build pipeline");
     std::cout << "building pipeline" << std::endl;
     owlBuildPipeline(context);
   }
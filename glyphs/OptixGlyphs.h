@@ -18,7 +18,13 @@
 
 #include "Triangles.h"
 #include "glyphs/device/FrameState.h"
+#include "glyphs/device/Adaptive.h"
+#include "glyphs/device/RayStats.h"
+#include "glyphs/device/PixelStats.h"
 #include "Glyphs.h"
+#include "glyphs/cpu/BVH.h"
+#include "MemoryTracker.h"
+#include "ProgramCache.h"
 #include "owl/owl.h"
 
 namespace glyphs {
@@ -27,6 +33,8 @@ namespace glyphs {
     wnat to render */
   struct OWLGlyphs {
     OWLGlyphs();
+    /*! releases the context, and everything in it */
+    virtual ~OWLGlyphs();
     /*! build owl-model (OWLGeoms, OWLGroup, etc) that we can ray
         trace against */
     virtual void build(/*! the glyphs to build over, using either
@@ -40,6 +48,35 @@ namespace glyphs {
         virtual buildModel(), and then set up the SBT, raygen, etc */
     void setModel(Glyphs::SP glyphs, Triangles::SP triModel);
 
+    /*! switch to another timestep of the glyphs passed to
+        setModel(). Timesteps share the same topology (same links,
+        same 'prev' pointers), only positions move, so this only
+        refits the existing acceleration structures - unless the
+        refitted BVH got so bad that a full rebuild is cheaper in the
+        long run. Prints refit vs rebuild times */
+    void setTimestep(Glyphs::SP glyphs);
+
+    /*! rebuild rather than refit once the (estimated) SAH cost of
+        the refitted BVH grew by more than this factor relative to
+        the last full build */
+    float rebuildThreshold { 1.5f };
+
+    /*! double-buffer accum and variance buffers, and keep a surface
+        buffer, for FrameState::historyEnabled (see
+        device/Reprojection.h); must be set before the first
+        resizeFrameBuffer() */
+    bool temporalReprojection { false };
+
+    /*! where compiled programs are cached across runs (see
+        ProgramCache.h); empty for none. Must be set before the
+        renderer is created */
+    static std::string programCacheDir;
+
+    /*! allocate the half precision accum buffer instead of the float4
+        one, for FrameState::halfAccum (see device/HalfAccum.h); must
+        be set before the first resizeFrameBuffer() */
+    bool halfAccum { false };
+
     void resizeFrameBuffer(void *fbPointer, const vec2i &newSize);
     void updateFrameState(device::FrameState &fs);
 
@@ -48,9 +85,48 @@ namespace glyphs {
 
     void render();
 
+    /*! the display pass: writes the current accumulation into the
+        color buffer; for frames rendered with
+        FrameState::deferDisplay */
+    void display();
+
+    /*! error estimate after the last render(); only meaningful if
+        that frame had errorStatsEnabled set */
+    device::ErrorStats getErrorStats() const;
+
+    /*! rays traced in the last render(), summed over all devices;
+        only meaningful if that frame had rayStatsEnabled set */
+    device::RayStats getRayStats() const;
+
+    /*! the per-pixel counters of the last regular (non-motion)
+        frame, reduced over all pixels; empty unless built with
+        GLYPHS_STATS (see device/PixelStats.h) */
+    device::PixelStatsSummary getPixelStats() const;
+
     // helper function that turns a triangle model into a owl geometry
     OWLGroup buildTriangles(Triangles::SP triModel);
 
+    /*! owlDeviceBufferCreate() etc, accounted to 'tag' in 'memory';
+        all buffers and acceleration structures should be created
+        through these */
+    OWLBuffer createDeviceBuffer(MemoryTag tag, OWLDataType type,
+                                 size_t count, const void *init);
+    OWLBuffer createHostPinnedBuffer(MemoryTag tag, OWLDataType type,
+                                     size_t count);
+    void resizeBuffer(OWLBuffer buffer, size_t count);
+    void releaseBuffer(OWLBuffer buffer);
+    /*! OWL doesn't report acceleration structure sizes, so this
+        accounts the drop in free device memory across the build
+        (temporaries are freed again by then). That is only as fine
+        grained as the CUDA allocator - small BLASes may show up as
+        nothing, or as a whole page */
+    void buildAccel(MemoryTag tag, OWLGroup group);
+    void releaseGroup(OWLGroup group);
+
+    /*! bytes per subsystem, per device (buffers get replicated
+        across devices); see MemoryTracker.h */
+    MemoryTracker memory;
+
     
     /*! size of current frame buffer */
     vec2i fbSize { -1,-1 };
@@ -59,19 +135,80 @@ namespace glyphs {
     OWLBuffer frameStateBuffer = 0;
     OWLBuffer colorBuffer = 0;
     OWLBuffer accumBuffer = 0;
+    /*! device::HalfAccum per pixel, only with halfAccum */
+    OWLBuffer halfAccumBuffer = 0;
+    OWLBuffer varianceBuffer = 0;
+    /*! device::Surface per pixel, only with temporalReprojection */
+    OWLBuffer surfaceBuffer = 0;
+    /*! host-pinned, two floats per device; see RayGenData */
+    OWLBuffer errorStatsBuffer = 0;
+    /*! host-pinned, one device::RayStats per device */
+    OWLBuffer rayStatsBuffer = 0;
+    /*! host-pinned, one device::PixelStats per pixel (only with
+        GLYPHS_STATS) */
+    OWLBuffer pixelStatsBuffer = 0;
     OWLGroup  world = 0;
-    OWLRayGen rayGen = 0;
+    /*! one per device::RenderVariant; all share the same variables */
+    OWLRayGen rayGens[device::NUM_RENDER_VARIANTS] = { 0 };
+    /*! the display pass, see display() */
+    OWLRayGen displayRayGen = 0;
+    /*! the one render() launches; set by updateFrameState() */
+    int       renderVariant = device::RENDER_LOCAL;
+    /*! FrameState::motionScale of the frame render() launches; set
+        by updateFrameState() */
+    int       motionScale = 0;
     OWLBuffer linkBuffer = 0;
     OWLGeomType glyphsType = 0;
     OWLGeomType trianglesGeomType = 0;
     OWLGroup triangleGroup = 0;
 
   protected:
+    /*! owlModuleCreate(), and remembers the PTX for the program
+        cache key */
+    OWLModule createModule(const char *ptx);
+
     /*! *must* be called by derived classes when all modules are
         set up appropriately; will build optix programs and build
         the owl pipeline */
     void buildModules();
 
+    /*! owlBuildPrograms(), through the program cache; only the first
+        call builds, so acceleration structure builds that need the
+        bounds programs can call it too */
+    void buildPrograms();
+
+    /*! upload new glyph positions for setTimestep(), and update
+        instance transforms and/or bottom-level groups; if 'rebuild'
+        is false, groups should be refit rather than rebuilt. The
+        world group gets refit/rebuilt by setTimestep() */
+    virtual void updateGlyphs(Glyphs::SP glyphs, bool rebuild) = 0;
+
+  private:
+    /*! all of the above raygens, which share all variables */
+    std::vector<OWLRayGen> allRayGens() const;
+
+    /*! points the drivers' compile caches into programCache */
+    void setupDriverCaches();
+    /*! what else, besides the PTX, the compiled programs depend
+        on: OptiX and driver versions, and the devices */
+    std::string programConfig() const;
+
+    ProgramCache             programCache { programCacheDir };
+    /*! PTX of every module, in creation order */
+    std::vector<std::string> programSources;
+    bool                     programsBuilt  { false };
+
+    /*! host-side BVH over the glyphs' link segments; this is not
+        what we trace against, it is only used to estimate how much
+        refitting degrades the device BVH */
+    cpu::BVH           proxyBVH;
+    std::vector<box3f> proxyBounds;
+    float              proxySAH       { 0.f };
+    /*! element type of each buffer created through
+        createDeviceBuffer() etc, for resizeBuffer() */
+    std::map<OWLBuffer,std::pair<MemoryTag,size_t>> bufferTypes;
+    size_t             numLinks       { 0 };
+    double             lastBuildTime  { 0. };
   };
   
 }
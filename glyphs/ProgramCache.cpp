@@ -0,0 +1,201 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "ProgramCache.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#if _WIN32
+# include <direct.h>
+#else
+# include <sys/stat.h>
+#endif
+
+namespace glyphs {
+
+  /*! creates 'path' and its parents; true if it exists afterwards */
+  static bool makeDirs(const std::string &path)
+  {
+    for (size_t pos = path.find_first_of("/\\",1);
+         ;pos = path.find_first_of("/\\",pos+1)) {
+      const std::string prefix = path.substr(0,pos);
+#if _WIN32
+      // drive letters
+      const int rc = prefix.back() == ':' ? 0 : _mkdir(prefix.c_str());
+#else
+      const int rc = mkdir(prefix.c_str(),0755);
+#endif
+      if (rc != 0 && errno != EEXIST)
+        return false;
+      if (pos == std::string::npos)
+        return true;
+    }
+  }
+
+  ProgramCache::ProgramCache(const std::string &dir, size_t maxBytes)
+    : dir(dir), maxBytes(maxBytes)
+  {}
+
+  std::string ProgramCache::defaultDir()
+  {
+    if (const char *env = getenv("GLYPHS_PROGRAM_CACHE"))
+      return std::string(env) == "off" ? "" : env;
+#if _WIN32
+    if (const char *local = getenv("LOCALAPPDATA"))
+      return std::string(local)+"\\owlGlyphs";
+#else
+    if (const char *xdg = getenv("XDG_CACHE_HOME"))
+      if (*xdg) return std::string(xdg)+"/owlGlyphs";
+    if (const char *home = getenv("HOME"))
+      if (*home) return std::string(home)+"/.cache/owlGlyphs";
+#endif
+    return "";
+  }
+
+  uint64_t ProgramCache::key(const std::vector<std::string> &sources,
+                             const std::string &config)
+  {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto add = [&](const std::string &s) {
+      for (unsigned char c : s) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+      }
+      // so that moving text from one source to the next is a change
+      hash ^= 0xff;
+      hash *= 0x100000001b3ull;
+    };
+    for (auto &source : sources) add(source);
+    add(config);
+    return hash;
+  }
+
+  std::string ProgramCache::artifactDir(const std::string &kind) const
+  {
+    if (!enabled()) return "";
+    const std::string path = dir+"/"+kind;
+    if (!makeDirs(path)) {
+      std::cerr << "#glyphs.cache: could not create '" << path
+                << "', compiling without a cache" << std::endl;
+      return "";
+    }
+    return path;
+  }
+
+  bool ProgramCache::lookup(uint64_t key, Entry &entry) const
+  {
+    for (auto &e : readManifest())
+      if (e.key == key) {
+        entry = e;
+        return true;
+      }
+    return false;
+  }
+
+  /*! one entry per line: key (hex), builds, cold and last build
+      seconds, name. Lines that don't parse are dropped - the worst a
+      damaged manifest can do is make one build look cold */
+  std::vector<ProgramCache::Entry> ProgramCache::readManifest() const
+  {
+    std::vector<Entry> entries;
+    if (!enabled()) return entries;
+    std::ifstream in(manifestFileName());
+    std::string line;
+    while (std::getline(in,line)) {
+      std::stringstream ss(line);
+      Entry e;
+      if (!(ss >> std::hex >> e.key >> std::dec
+            >> e.numBuilds >> e.coldSeconds >> e.lastSeconds))
+        continue;
+      std::getline(ss >> std::ws,e.name);
+      entries.push_back(e);
+    }
+    return entries;
+  }
+
+  /*! writes a temporary file and renames it over the manifest, so
+      that concurrent runs see either version, never half of one */
+  void ProgramCache::writeManifest(const std::vector<Entry> &entries) const
+  {
+    if (!makeDirs(dir)) return;
+    // clock for other processes, counter for other threads
+    static std::atomic<unsigned> numWrites { 0 };
+    std::stringstream tmpName;
+    tmpName << manifestFileName() << ".tmp"
+            << std::chrono::steady_clock::now().time_since_epoch().count()
+            << "." << numWrites++;
+    {
+      std::ofstream out(tmpName.str());
+      if (!out.good()) return;
+      for (auto &e : entries)
+        out << std::hex << std::setw(16) << std::setfill('0') << e.key
+            << std::dec << std::setfill(' ')
+            << " " << e.numBuilds
+            << " " << e.coldSeconds
+            << " " << e.lastSeconds
+            << " " << e.name << std::endl;
+    }
+#if _WIN32
+    // rename() doesn't replace existing files there
+    remove(manifestFileName().c_str());
+#endif
+    if (rename(tmpName.str().c_str(),manifestFileName().c_str()) != 0)
+      remove(tmpName.str().c_str());
+  }
+
+  void ProgramCache::build(const std::string &name, uint64_t key,
+                           const std::function<void()> &build)
+  {
+    Entry entry;
+    const bool cached = lookup(key,entry);
+    const auto begin = std::chrono::steady_clock::now();
+    build();
+    const double seconds
+      = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+    if (!enabled()) return;
+
+    (cached ? numHits : numMisses)++;
+    entry.name = name;
+    entry.key  = key;
+    entry.numBuilds++;
+    entry.lastSeconds = seconds;
+    if (!cached) entry.coldSeconds = seconds;
+
+    std::vector<Entry> entries = { entry };
+    for (auto &e : readManifest())
+      if (e.key != key && entries.size() < (size_t)maxEntries)
+        entries.push_back(e);
+    writeManifest(entries);
+
+    std::stringstream msg;
+    msg << "#glyphs.cache: " << name << " (key "
+        << std::hex << std::setw(16) << std::setfill('0') << key
+        << std::dec << ") " << std::fixed << std::setprecision(3);
+    if (cached)
+      msg << "cached, built in " << seconds << "s ("
+          << entry.coldSeconds << "s without the cache)";
+    else
+      msg << "not cached, built in " << seconds << "s";
+    std::cout << msg.str() << "; cache is '" << dir << "'" << std::endl;
+  }
+
+}
@@ -0,0 +1,97 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace glyphs {
+
+  /*! persistent cache of compiled programs, shared by all runs on a
+      machine. owlBuildPrograms() compiles every module's PTX twice:
+      into OptiX modules, and through the CUDA JIT for the bounds
+      programs. Neither OWL nor OptiX can hand out the results or take
+      them back, but both drivers keep disk caches keyed by the code
+      they compile; OWLGlyphs points those at artifactDir("optix") and
+      artifactDir("cuda"), so they persist and share one size limit.
+
+      On top of that this keeps a manifest with one entry per build,
+      keyed by a hash of all the PTX and the configuration it was
+      compiled for (driver version, devices). That tells whether a
+      build should have been served from the cache, and what it costs
+      when it isn't. Nothing in here calls CUDA, OptiX or OWL - builds
+      are passed in as functions - so host tools can exercise the
+      cache with a stand-in build */
+  struct ProgramCache {
+    /*! one build in the manifest */
+    struct Entry {
+      std::string name;
+      uint64_t    key         { 0 };
+      int         numBuilds   { 0 };
+      /*! the build that filled the cache */
+      double      coldSeconds { 0. };
+      double      lastSeconds { 0. };
+    };
+
+    /*! empty 'dir' disables the cache: builds just run */
+    ProgramCache(const std::string &dir,
+                 size_t maxBytes = defaultMaxBytes);
+
+    /*! $GLYPHS_PROGRAM_CACHE if set ('off' for none), else
+        owlGlyphs in the user's cache directory ($XDG_CACHE_HOME or
+        ~/.cache; %LOCALAPPDATA% on windows); empty if there is none */
+    static std::string defaultDir();
+
+    bool enabled() const { return !dir.empty(); }
+
+    /*! FNV-1a over the sources and the config; any change to either
+        is a different key */
+    static uint64_t key(const std::vector<std::string> &sources,
+                        const std::string &config);
+
+    /*! where the driver of that 'kind' of artifact keeps them,
+        created if need be; empty if the cache is disabled, or the
+        directory can't be created */
+    std::string artifactDir(const std::string &kind) const;
+
+    /*! false if 'key' has not been built with this cache before */
+    bool lookup(uint64_t key, Entry &entry) const;
+
+    /*! runs 'build', times it, and records it in the manifest; prints
+        whether it was cached, and what the cold build took */
+    void build(const std::string &name, uint64_t key,
+               const std::function<void()> &build);
+
+    static const size_t defaultMaxBytes = size_t(1) << 30;
+    /*! the manifest keeps this many keys, most recently built first */
+    static const int    maxEntries      = 64;
+
+    const std::string dir;
+    /*! for the drivers' caches together */
+    const size_t      maxBytes;
+    int numHits   = 0;
+    int numMisses = 0;
+
+  private:
+    std::string manifestFileName() const { return dir+"/manifest.txt"; }
+    std::vector<Entry> readManifest() const;
+    void writeManifest(const std::vector<Entry> &entries) const;
+  };
+
+}
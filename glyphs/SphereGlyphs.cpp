@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "glyphs/SphereGlyphs.h"
+#include "glyphs/Timings.h"
 #include <random>
 #include <omp.h>
 #include <owl/common/parallel/parallel_for.h>
@@ -27,7 +28,7 @@ namespace glyphs {
 
   SphereGlyphs::SphereGlyphs()
   {
-    module = owlModuleCreate(context, embedded_SphereGlyphs_programs);
+    module = createModule(embedded_SphereGlyphs_programs);
 
     OWLVarDecl glyphsVars[] = {
       { "links",  OWL_BUFPTR, OWL_OFFSETOF(GlyphsGeom,links)},
@@ -56,17 +57,21 @@ namespace glyphs {
   std::vector<std::pair<OWLGroup,affine3f>>
   SphereGlyphs::buildGlyphs(Glyphs::SP glyphs)
   {
+    ScopedTimer timer("build glyphs");
     const int numLinks = glyphs->links.size();
     std::vector<std::pair<OWLGroup,affine3f>> result(glyphs->links.size());
     
     /* start with one group and transform per link */
     result.resize(numLinks);
   
-    linkBuffer
-      = owlDeviceBufferCreate(context,
-                              OWL_USER_TYPE(glyphs->links[0]),
-                              glyphs->links.size(),
-                              glyphs->links.data());
+    {
+      ScopedTimer timer("upload links");
+      linkBuffer
+        = createDeviceBuffer(MEM_LINKS,
+                             OWL_USER_TYPE(glyphs->links[0]),
+                             glyphs->links.size(),
+                             glyphs->links.data());
+    }
 
     OWLGeom singleGlyphGeom
       = owlGeomCreate(context, glyphsType);
@@ -78,10 +83,15 @@ namespace glyphs {
     OWLGroup singleGlyphGroup
       = owlUserGeomGroupCreate(context, 1, &singleGlyphGeom);
     
-    // compile progs here because we need the bounds prog in accelbuild:
-    owlBuildPrograms(context);
-    owlGroupBuildAccel(singleGlyphGroup);
+    // the accel build needs the bounds prog; buildModules() built
+    // it already, so this is a no-op
+    buildPrograms();
+    {
+      ScopedTimer timer("BLAS");
+      buildAccel(MEM_BLAS,singleGlyphGroup);
+    }
     
+    ScopedTimer xfmTimer("instance transforms");
     owl::parallel_for(numLinks,[&](int linkID) {
         result[linkID].first = singleGlyphGroup;
         affine3f &xfm = result[linkID].second;
@@ -109,6 +119,20 @@ namespace glyphs {
       owlInstanceGroupSetTransform(world, i, &(const owl4x3f&)rootGroups[i].second);
     }
 
-    owlGroupBuildAccel(this->world);
+    ScopedTimer timer("TLAS");
+    buildAccel(MEM_TLAS,this->world);
+  }
+
+  void SphereGlyphs::updateGlyphs(Glyphs::SP glyphs, bool rebuild)
+  {
+    owlBufferUpload(linkBuffer,glyphs->links.data());
+
+    const int numLinks = glyphs->links.size();
+    std::vector<affine3f> xfms(numLinks);
+    owl::parallel_for(numLinks,[&](int linkID) {
+        xfms[linkID] = Glyphs::getXform(glyphs,glyphs->links[linkID]);
+      });
+    for (int i=0; i<numLinks; i++)
+      owlInstanceGroupSetTransform(world, i, &(const owl4x3f&)xfms[i]);
   }
 }
@@ -31,6 +31,9 @@ namespace glyphs {
     void build(Glyphs::SP glyphs,
                Triangles::SP triangles) override;
 
+  protected:
+    void updateGlyphs(Glyphs::SP glyphs, bool rebuild) override;
+
   private:
     std::vector<std::pair<OWLGroup,affine3f>> buildGlyphs(Glyphs::SP glyphs);
   };
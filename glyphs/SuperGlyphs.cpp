@@ -16,6 +16,8 @@
 
 #include "glyphs/device/Super.h"
 #include "glyphs/SuperGlyphs.h"
+#include "glyphs/SuperProxy.h"
+#include "glyphs/Timings.h"
 
 
 namespace glyphs {
@@ -25,60 +27,6 @@ namespace glyphs {
 
   extern "C" const char embedded_SuperGlyphs_programs[];
 
-  static box3f tessellate(super::Quadric sq, float u1, float u2, float du, float v1, float v2, float dv,
-                          std::vector<vec3f>& vertices, std::vector<vec3i>& indices, std::vector<vec3f>& colors,
-                          const affine3f& xfm, float slack=.4f)
-  {
-
-      sq.A += slack;
-      sq.B += slack;
-      sq.C += slack;
-
-      int U = (u2-u1)/du;
-      int V = (v2-v1)/du;
-  
-      int f = (int)indices.size();
- 
-      box3f bounds;
-      for (int u = 0; u <= U; ++u)
-      {
-          for (int v = 0; v <= V; ++v)
-          {
-              float umin = u1 + u * du;
-              float umax = fminf(u1 + (u+1) * du, u2);
-              float vmin = v1 + v * dv;
-              float vmax = fminf(v1 + (v+1) * dv, v2);
-  
-              vec3f v1 = super::eval(sq,umax,vmin);
-              vec3f v2 = super::eval(sq,umin,vmin);
-              vec3f v3 = super::eval(sq,umin,vmax);
-              vec3f v4 = super::eval(sq,umax,vmax);
-
-              vertices.push_back(v1);
-              vertices.push_back(v2);
-              vertices.push_back(v3);
-              vertices.push_back(v4);
-
-              indices.push_back({f,f+1,f+2});
-              indices.push_back({f,f+2,f+3});
-
-              f+=4;
-
-              colors.push_back({1,1,1});
-              colors.push_back({1,1,1});
-              colors.push_back({1,1,1});
-              colors.push_back({1,1,1});
-              
-              bounds.extend(xfmPoint(xfm,v1));
-              bounds.extend(xfmPoint(xfm,v2));
-              bounds.extend(xfmPoint(xfm,v3));
-              bounds.extend(xfmPoint(xfm,v4));
-          }
-      }
-
-      return bounds;
-  }
-
   static super::Quadric mapToSuperQuadric(const Link& link)
   {
       vec3f rst;
@@ -92,33 +40,52 @@ namespace glyphs {
       return {rst.x,rst.y,rst.z, ABC.x,ABC.y,ABC.z};
   }
 
-  SuperGlyphs::SuperGlyphs()
+  const char *SuperGlyphs::modeName(int mode)
+  {
+    static const char *names[super::NUM_MODES] = { "proxy", "tessellate", "usergeom" };
+    return names[mode];
+  }
+
+  int SuperGlyphs::modeFromName(const std::string &name)
   {
-    module = owlModuleCreate(context, embedded_SuperGlyphs_programs);
+    for (int mode=0;mode<super::NUM_MODES;mode++)
+      if (name == modeName(mode))
+        return mode;
+    throw std::runtime_error("#glyphs: unknown super glyph mode '"+name+"'");
+  }
 
-#if USER_GEOM_SUPER_GLYPHS
+  SuperGlyphs::SuperGlyphs(int mode)
+    : mode(mode)
+  {
+    module = createModule(embedded_SuperGlyphs_programs);
 
-    OWLVarDecl trianglesGeomVars[] = {
+    // -------------------------------------------------------
+    // user geometry, solver starts at the bounding box
+    // -------------------------------------------------------
+    OWLVarDecl userGeomVars[] = {
       { "rst",    OWL_BUFPTR, OWL_OFFSETOF(SuperGeomData,rst)},
       { "ABC",    OWL_BUFPTR, OWL_OFFSETOF(SuperGeomData,ABC)},
       { nullptr /* sentinel to mark end of list */ }
     };
 
-    glyphsType
+    OWLGeomType userGeomType
       = owlGeomTypeCreate(context,
                           OWL_GEOMETRY_USER,
                           sizeof(device::SuperGeomData),
-                          trianglesGeomVars, 2);
-
-    owlGeomTypeSetBoundsProg(glyphsType, module,
-                             "SuperGlyphs");
-    owlGeomTypeSetIntersectProg(glyphsType, 0, module,
-                                "SuperGlyphs");
-    owlGeomTypeSetClosestHit(glyphsType, 0, module,
-                             "SuperGlyphs"); // nothing happened here
-
-#else
-
+                          userGeomVars, 2);
+
+    owlGeomTypeSetBoundsProg(userGeomType, module,
+                             "SuperGlyphsUserGeom");
+    owlGeomTypeSetIntersectProg(userGeomType, 0, module,
+                                "SuperGlyphsUserGeom");
+    owlGeomTypeSetClosestHit(userGeomType, 0, module,
+                             "SuperGlyphsUserGeom"); // nothing happened here
+    modeTypes[super::MODE_USER_GEOM] = userGeomType;
+
+    // -------------------------------------------------------
+    // triangle proxy (any-hit runs the solver), and plain
+    // tessellation (closest-hit, no solver)
+    // -------------------------------------------------------
     OWLVarDecl trianglesGeomVars[] = {
       { "index",  OWL_BUFPTR, OWL_OFFSETOF(SuperGeomData,index)},
       { "vertex", OWL_BUFPTR, OWL_OFFSETOF(SuperGeomData,vertex)},
@@ -127,25 +94,36 @@ namespace glyphs {
       { "ABC",    OWL_BUFPTR, OWL_OFFSETOF(SuperGeomData,ABC)},
       { nullptr /* sentinel to mark end of list */ }
     };
-      
-    glyphsType
+
+    OWLGeomType proxyType
       = owlGeomTypeCreate(context,
                           OWL_TRIANGLES,
                           sizeof(device::SuperGeomData),
                           trianglesGeomVars, 5);
+    owlGeomTypeSetAnyHit(proxyType, 0,
+                         module, "SuperGlyphsProxy");
+    modeTypes[super::MODE_PROXY] = proxyType;
 
-#if TESSELLATE_SUPER_GLYPHS
-    owlGeomTypeSetClosestHit(glyphsType, 0,
-                             module, "SuperGlyphs");
-#else
-    owlGeomTypeSetAnyHit(glyphsType, 0,
-                             module, "SuperGlyphs");
-#endif
+    OWLGeomType tessellatedType
+      = owlGeomTypeCreate(context,
+                          OWL_TRIANGLES,
+                          sizeof(device::SuperGeomData),
+                          trianglesGeomVars, 5);
+    owlGeomTypeSetClosestHit(tessellatedType, 0,
+                             module, "SuperGlyphsTessellate");
+    modeTypes[super::MODE_TESSELLATE] = tessellatedType;
 
-#endif
+    glyphsType = modeTypes[mode];
     buildModules();
   }
 
+  void SuperGlyphs::setMode(int mode, Glyphs::SP glyphs, Triangles::SP triangles)
+  {
+    this->mode = mode;
+    glyphsType = modeTypes[mode];
+    setModel(glyphs,triangles);
+  }
+
   void SuperGlyphs::addUserGeom(std::vector<std::pair<OWLGroup,affine3f>>& groups,
                                 const super::Quadric& sq,
                                 const affine3f& xfm)
@@ -155,15 +133,23 @@ namespace glyphs {
 
     OWLGeom geom = owlGeomCreate(context, glyphsType);
     owlGeomSetPrimCount(geom, 1);
-    OWLBuffer rstBuffer
-      = owlDeviceBufferCreate(context, OWL_FLOAT3, 1, &rst);
-    OWLBuffer ABCBuffer
-      = owlDeviceBufferCreate(context, OWL_FLOAT3, 1, &ABC);
-    owlGeomSetBuffer(geom, "rst", rstBuffer);
-    owlGeomSetBuffer(geom, "ABC", ABCBuffer);
+    {
+      ScopedTimer timer("upload");
+      OWLBuffer rstBuffer
+        = createDeviceBuffer(MEM_GLYPH_PARAMS, OWL_FLOAT3, 1, &rst);
+      OWLBuffer ABCBuffer
+        = createDeviceBuffer(MEM_GLYPH_PARAMS, OWL_FLOAT3, 1, &ABC);
+      owlGeomSetBuffer(geom, "rst", rstBuffer);
+      owlGeomSetBuffer(geom, "ABC", ABCBuffer);
+      glyphBuffers.push_back(rstBuffer);
+      glyphBuffers.push_back(ABCBuffer);
+    }
 
     OWLGroup grp = owlUserGeomGroupCreate(context, 1, &geom);
-    owlGroupBuildAccel(grp);
+    {
+      ScopedTimer timer("BLAS");
+      buildAccel(MEM_BLAS,grp);
+    }
     groups.push_back({grp,xfm});
   }
 
@@ -179,9 +165,14 @@ namespace glyphs {
     std::vector<vec3f> colors;
     std::vector<vec3i> indices;
 
-    box3f bounds = tessellate(sq,-M_PI,M_PI,du,-M_PI/2.f,M_PI/2.f,dv,
-                              vertices,indices,colors,xfm);
-    worldBounds.extend(bounds);
+    {
+      ScopedTimer timer("tessellate");
+      box3f bounds = tessellate(sq,-M_PI,M_PI,du,-M_PI/2.f,M_PI/2.f,dv,
+                                vertices,indices,colors,xfm);
+      worldBounds.extend(bounds);
+    }
+
+    ScopedTimer uploadTimer("upload");
 
     vec3f rst(sq.r,sq.s,sq.t);
     vec3f ABC(sq.A,sq.B,sq.C);
@@ -189,15 +180,17 @@ namespace glyphs {
     OWLGeom trianglesGeom = owlGeomCreate(context, glyphsType);
 
     OWLBuffer vertexBuffer
-      = owlDeviceBufferCreate(context, OWL_FLOAT3, vertices.size(), vertices.data());
+      = createDeviceBuffer(MEM_VERTICES, OWL_FLOAT3, vertices.size(), vertices.data());
     OWLBuffer colorBuffer
-      = owlDeviceBufferCreate(context, OWL_FLOAT3, colors.size(), colors.data());
+      = createDeviceBuffer(MEM_VERTICES, OWL_FLOAT3, colors.size(), colors.data());
     OWLBuffer indexBuffer
-      = owlDeviceBufferCreate(context, OWL_INT3, indices.size(), indices.data());
+      = createDeviceBuffer(MEM_VERTICES, OWL_INT3, indices.size(), indices.data());
     OWLBuffer rstBuffer
-      = owlDeviceBufferCreate(context, OWL_FLOAT3, 1, &rst);
+      = createDeviceBuffer(MEM_GLYPH_PARAMS, OWL_FLOAT3, 1, &rst);
     OWLBuffer ABCBuffer
-      = owlDeviceBufferCreate(context, OWL_FLOAT3, 1, &ABC);
+      = createDeviceBuffer(MEM_GLYPH_PARAMS, OWL_FLOAT3, 1, &ABC);
+    glyphBuffers.insert(glyphBuffers.end(),
+                        { vertexBuffer, colorBuffer, indexBuffer, rstBuffer, ABCBuffer });
     numTris += vertices.size()/3;
 
     owlTrianglesSetVertices(trianglesGeom, vertexBuffer,
@@ -212,16 +205,31 @@ namespace glyphs {
     owlGeomSetBuffer(trianglesGeom, "ABC", ABCBuffer);
 
     OWLGroup grp = owlTrianglesGeomGroupCreate(context, 1, &trianglesGeom);
-    owlGroupBuildAccel(grp);
+    ScopedTimer blasTimer("BLAS");
+    buildAccel(MEM_BLAS,grp);
     groups.push_back({grp,xfm});
   }
 
   std::vector<std::pair<OWLGroup,affine3f>> SuperGlyphs::buildGlyphs(Glyphs::SP glyphs)
   {
-#if USER_GEOM_SUPER_GLYPHS
-    // compile progs here because we need the bounds prog in accelbuild:
-    owlBuildPrograms(context);
-#endif
+    ScopedTimer timer("build glyphs");
+    if (mode == super::MODE_USER_GEOM)
+      // the accel build needs the bounds prog; buildModules() built
+      // it already, so this is a no-op
+      buildPrograms();
+
+    // same quadric shapes for every build, so modes can be compared
+    srand48(0);
+
+    for (OWLGroup group : glyphGroups)
+      releaseGroup(group);
+    glyphGroups.clear();
+    for (OWLBuffer buffer : glyphBuffers)
+      releaseBuffer(buffer);
+    glyphBuffers.clear();
+    instanceLinks.clear();
+    if (linkBuffer)
+      releaseBuffer(linkBuffer);
 
     std::vector<std::pair<OWLGroup,affine3f>> groups;
     box3f worldBounds;
@@ -230,21 +238,25 @@ namespace glyphs {
       const Link& l = glyphs->links[i];
       super::Quadric sq = mapToSuperQuadric(l);
       affine3f xfm = Glyphs::getXform(glyphs,l);
-      if (std::isfinite(xfm.l.vx.x)) // rofl
-#if USER_GEOM_SUPER_GLYPHS
+      if (!std::isfinite(xfm.l.vx.x)) // rofl
+        continue;
+      if (mode == super::MODE_USER_GEOM)
         addUserGeom(groups,sq,xfm);
-#else
+      else
         addTessellation(groups,worldBounds,numTris,sq,xfm,.8f,.8f);
-#endif
+      instanceLinks.push_back((int)i);
+      glyphGroups.push_back(groups.back().first);
     }
-    std::cout << "numTris: " << numTris << ", numGlyphs: " << groups.size()
+    std::cout << "mode: " << modeName(mode)
+              << ", numTris: " << numTris << ", numGlyphs: " << groups.size()
               << ", avg: " << numTris/(double)groups.size() << '\n';
     //std::cout << worldBounds << '\n';
+    ScopedTimer uploadTimer("upload links");
     linkBuffer
-      = owlDeviceBufferCreate(context,
-                              OWL_USER_TYPE(glyphs->links[0]),
-                              glyphs->links.size(),
-                              glyphs->links.data());
+      = createDeviceBuffer(MEM_LINKS,
+                           OWL_USER_TYPE(glyphs->links[0]),
+                           glyphs->links.size(),
+                           glyphs->links.data());
 
     return groups;
   }
@@ -255,12 +267,15 @@ namespace glyphs {
     std::vector<std::pair<OWLGroup,affine3f>> rootGroups
       = buildGlyphs(glyphs);
 
-    if (triangles)
+    // on a rebuild (setMode()) the triangles stay
+    if (triangles && !triangleGroup)
       triangleGroup = buildTriangles(triangles);
 
     if (triangleGroup)
       rootGroups.push_back({triangleGroup,affine3f()});
 
+    if (world)
+      releaseGroup(world);
     world
       = owlInstanceGroupCreate(context, rootGroups.size());
     for (int i=0; i<rootGroups.size(); i++) {
@@ -268,7 +283,28 @@ namespace glyphs {
       owlInstanceGroupSetTransform(world, i, &(const owl4x3f&)rootGroups[i].second);
     }
 
-    owlGroupBuildAccel(this->world);
+    ScopedTimer timer("TLAS");
+    buildAccel(MEM_TLAS,this->world);
+  }
+
+  void SuperGlyphs::updateGlyphs(Glyphs::SP glyphs, bool rebuild)
+  {
+    // the quadrics' shapes stay, only their transforms change
+    owlBufferUpload(linkBuffer,glyphs->links.data());
+
+    for (size_t i=0; i<instanceLinks.size(); i++) {
+      const Link &l = glyphs->links[instanceLinks[i]];
+      affine3f xfm = Glyphs::getXform(glyphs,l);
+      if (!std::isfinite(xfm.l.vx.x)) {
+        // glyph degenerated in this timestep; shrink its instance
+        // rather than changing the topology. Not to zero: OptiX
+        // inverts instance transforms, and a singular one would give
+        // inf/NaN object-space rays
+        xfm = affine3f::translate(l.pos)
+          * affine3f::scale(vec3f(1e-6f*glyphs->radius));
+      }
+      owlInstanceGroupSetTransform(world, i, &(const owl4x3f&)xfm);
+    }
   }
 
 }
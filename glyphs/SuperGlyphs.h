@@ -19,11 +19,9 @@
 #include <utility>
 #include <vector>
 #include "glyphs/OptixGlyphs.h"
+#include "glyphs/device/Super.h"
 
 namespace glyphs {
-  namespace super {
-    struct Quadric;
-  }
 
   /*! Super quadric glyphs;
     This is a more involved glyph that uses a Newton/Rhaphson
@@ -32,14 +30,32 @@ namespace glyphs {
     box or bounding sphere as an initial root estimate, but rather a
     coarse tessellation. The intersection with that tessellation is
     computed using hardware-accelerated ray/triangle intersections.
+
+    For comparison, the tessellation alone or a user geometry that
+    starts the solver at the bounding box can be used instead (see
+    super::Mode); all three geometry types are created up front, so
+    setMode() can switch between them without a new context.
   */
   struct SuperGlyphs : public OWLGlyphs
   {
-    SuperGlyphs();
+    SuperGlyphs(int mode = super::MODE_PROXY);
     
     void build(Glyphs::SP glyphs,
                Triangles::SP triangles) override;
 
+    /*! rebuild the model with another super::Mode */
+    void setMode(int mode, Glyphs::SP glyphs, Triangles::SP triangles);
+
+    int mode;
+
+    /*! "proxy", "tessellate" or "usergeom" */
+    static const char *modeName(int mode);
+    /*! inverse of modeName(); throws on unknown names */
+    static int modeFromName(const std::string &name);
+
+  protected:
+    void updateGlyphs(Glyphs::SP glyphs, bool rebuild) override;
+
   private:
     void addUserGeom(std::vector<std::pair<OWLGroup,affine3f>>& groups,
                      const super::Quadric& sq,
@@ -54,6 +70,15 @@ namespace glyphs {
                          float dv);
 
     std::vector<std::pair<OWLGroup,affine3f>> buildGlyphs(Glyphs::SP glyphs);
+
+    /*! link that each glyph instance was built from */
+    std::vector<int> instanceLinks;
+    /*! one per super::Mode */
+    OWLGeomType modeTypes[super::NUM_MODES];
+    /*! per-glyph groups of the current build, released on rebuild */
+    std::vector<OWLGroup> glyphGroups;
+    /*! ... and their vertex, color, index, rst and ABC buffers */
+    std::vector<OWLBuffer> glyphBuffers;
   };
   
 }
@@ -0,0 +1,115 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/Super.h"
+#include <vector>
+
+/*! host-side pieces of the super quadric proxy: the tessellation
+    SuperGlyphs traces, and a double-precision reference for the
+    solver that refines it (kernelBench, owlGlyphsRegress) */
+
+namespace glyphs {
+
+  /*! the triangle proxy: quads over the (u,v) parameter domain of the
+      quadric, inflated by 'slack' so that it encloses the surface;
+      returns the bounds of the vertices under 'xfm' */
+  inline box3f tessellate(super::Quadric sq, float u1, float u2, float du, float v1, float v2, float dv,
+                          std::vector<vec3f>& vertices, std::vector<vec3i>& indices, std::vector<vec3f>& colors,
+                          const affine3f& xfm, float slack=.4f)
+  {
+
+      sq.A += slack;
+      sq.B += slack;
+      sq.C += slack;
+
+      int U = (u2-u1)/du;
+      int V = (v2-v1)/du;
+  
+      int f = (int)indices.size();
+ 
+      box3f bounds;
+      for (int u = 0; u <= U; ++u)
+      {
+          for (int v = 0; v <= V; ++v)
+          {
+              float umin = u1 + u * du;
+              float umax = fminf(u1 + (u+1) * du, u2);
+              float vmin = v1 + v * dv;
+              float vmax = fminf(v1 + (v+1) * dv, v2);
+  
+              vec3f v1 = super::eval(sq,umax,vmin);
+              vec3f v2 = super::eval(sq,umin,vmin);
+              vec3f v3 = super::eval(sq,umin,vmax);
+              vec3f v4 = super::eval(sq,umax,vmax);
+
+              vertices.push_back(v1);
+              vertices.push_back(v2);
+              vertices.push_back(v3);
+              vertices.push_back(v4);
+
+              indices.push_back({f,f+1,f+2});
+              indices.push_back({f,f+2,f+3});
+
+              f+=4;
+
+              colors.push_back({1,1,1});
+              colors.push_back({1,1,1});
+              colors.push_back({1,1,1});
+              colors.push_back({1,1,1});
+              
+              bounds.extend(xfmPoint(xfm,v1));
+              bounds.extend(xfmPoint(xfm,v2));
+              bounds.extend(xfmPoint(xfm,v3));
+              bounds.extend(xfmPoint(xfm,v4));
+          }
+      }
+
+      return bounds;
+  }
+
+  /*! double-precision reference; f is convex along the ray, so
+      golden-section search for its minimum tells hit/miss, and
+      bisection between entry and minimum gives the root */
+  inline bool referenceSuper(const super::Quadric &q,
+                             const vec3f &ori, const vec3f &dir,
+                             double t0, double t1, double &t)
+  {
+    auto g = [&](double t) {
+      const vec3d p = vec3d(ori)+t*vec3d(dir);
+      return pow(fabs(p.x/q.A),(double)q.r)
+        + pow(fabs(p.y/q.B),(double)q.s)
+        + pow(fabs(p.z/q.C),(double)q.t) - 1.;
+    };
+    if (g(t0) <= 0.) { t = t0; return true; }
+    const double phi = .5*(sqrt(5.)-1.);
+    double a = t0, b = t1;
+    for (int i=0;i<200 && b-a > 1e-15;i++) {
+      const double c = b-phi*(b-a), d = a+phi*(b-a);
+      if (g(c) < g(d)) b = d; else a = c;
+    }
+    double lo = t0, hi = .5*(a+b);
+    if (g(hi) > 0.) return false;
+    for (int i=0;i<200 && hi-lo > 1e-15;i++) {
+      const double m = .5*(lo+hi);
+      if (g(m) > 0.) lo = m; else hi = m;
+    }
+    t = .5*(lo+hi);
+    return true;
+  }
+
+}
@@ -0,0 +1,200 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "glyphs/Timings.h"
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <mutex>
+#include <new>
+
+// ------------------------------------------------------------------
+// counts what the process allocates through operator new, so phases
+// can report it; replacing the global operators is the only way to
+// also see what OWL and the standard library allocate
+// ------------------------------------------------------------------
+
+static std::atomic<size_t> g_bytesAllocated { 0 };
+
+void *operator new(size_t size)
+{
+  g_bytesAllocated += size;
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace glyphs {
+
+  static std::mutex &phaseMutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static Phase &rootPhase()
+  {
+    static Phase root;
+    return root;
+  }
+
+  /*! innermost ScopedTimer's phase on this thread */
+  static thread_local Phase *currentPhase = nullptr;
+
+  /*! process cpu time (on windows, clock() is wall time, so the
+      thread counts there are always 1) */
+  static double cpuTime()
+  {
+    return std::clock() / double(CLOCKS_PER_SEC);
+  }
+
+  /*! average number of busy threads; phases shorter than the clock()
+      resolution get none */
+  static double threads(const Phase &phase)
+  {
+    return phase.seconds >= 1e-3 ? phase.cpuSeconds/phase.seconds : 0.;
+  }
+
+  size_t Timings::bytesAllocated()
+  {
+    return g_bytesAllocated;
+  }
+
+  ScopedTimer::ScopedTimer(const char *name)
+  {
+    parent = currentPhase ? currentPhase : &rootPhase();
+    {
+      std::lock_guard<std::mutex> lock(phaseMutex());
+      phase = nullptr;
+      for (auto &child : parent->children)
+        if (child->name == name)
+          phase = child.get();
+      if (!phase) {
+        parent->children.emplace_back(new Phase);
+        phase = parent->children.back().get();
+        phase->name = name;
+      }
+    }
+    currentPhase = phase;
+    bytes0 = g_bytesAllocated;
+    cpu0   = cpuTime();
+    t0     = getCurrentTime();
+  }
+
+  ScopedTimer::~ScopedTimer()
+  {
+    const double t   = getCurrentTime()-t0;
+    const double cpu = cpuTime()-cpu0;
+    const size_t bytes = g_bytesAllocated-bytes0;
+    currentPhase = (parent == &rootPhase()) ? nullptr : parent;
+
+    std::lock_guard<std::mutex> lock(phaseMutex());
+    phase->calls++;
+    phase->seconds    += t;
+    phase->cpuSeconds += cpu;
+    phase->bytes      += bytes;
+  }
+
+  static void printPhaseText(std::ostream &out, const Phase &phase,
+                             int depth, double totalSeconds)
+  {
+    out << std::left << std::setw(36) << (std::string(2*depth,' ')+phase.name)
+        << std::right
+        << std::setw(8)  << phase.calls
+        << std::setw(12) << std::fixed << std::setprecision(3) << phase.seconds
+        << std::setw(8)  << std::setprecision(1)
+        << (100.*phase.seconds/std::max(totalSeconds,1e-20))
+        << std::setw(10) << std::setprecision(2) << threads(phase)
+        << std::setw(12) << std::setprecision(2) << (phase.bytes/(1024.*1024.))
+        << std::endl;
+    for (auto &child : phase.children)
+      printPhaseText(out,*child,depth+1,totalSeconds);
+  }
+
+  void Timings::printText(std::ostream &out)
+  {
+    std::lock_guard<std::mutex> lock(phaseMutex());
+    double totalSeconds = 0.;
+    for (auto &child : rootPhase().children)
+      totalSeconds += child->seconds;
+    out << std::left << std::setw(36) << "phase" << std::right
+        << std::setw(8)  << "calls"
+        << std::setw(12) << "seconds"
+        << std::setw(8)  << "%"
+        << std::setw(10) << "threads"
+        << std::setw(12) << "MB alloc" << std::endl;
+    for (auto &child : rootPhase().children)
+      printPhaseText(out,*child,0,totalSeconds);
+  }
+
+  static void printPhaseJSON(std::ostream &out, const Phase &phase, int depth)
+  {
+    const std::string indent(2*depth,' ');
+    out << indent << "{ \"name\": \"" << phase.name << "\""
+        << ", \"calls\": " << phase.calls
+        << ", \"seconds\": " << std::setprecision(6) << phase.seconds
+        << ", \"cpuSeconds\": " << phase.cpuSeconds
+        << ", \"threads\": " << threads(phase)
+        << ", \"bytesAllocated\": " << phase.bytes
+        << ", \"children\": [";
+    for (size_t i=0;i<phase.children.size();i++) {
+      out << (i ? ",\n" : "\n");
+      printPhaseJSON(out,*phase.children[i],depth+1);
+    }
+    if (!phase.children.empty())
+      out << "\n" << indent;
+    out << "] }";
+  }
+
+  void Timings::printJSON(std::ostream &out)
+  {
+    std::lock_guard<std::mutex> lock(phaseMutex());
+    const std::vector<std::unique_ptr<Phase>> &phases = rootPhase().children;
+    out << "{ \"phases\": [";
+    for (size_t i=0;i<phases.size();i++) {
+      out << (i ? ",\n" : "\n");
+      printPhaseJSON(out,*phases[i],1);
+    }
+    out << "\n] }" << std::endl;
+  }
+
+}
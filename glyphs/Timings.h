@@ -0,0 +1,73 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "owl/common/owl-common.h"
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace glyphs {
+  using namespace owl::common;
+
+  /*! one node of the phase tree that ScopedTimer builds; timers with
+      the same name under the same parent share a node, which then
+      sums up all of them */
+  struct Phase {
+    std::string name;
+    /*! how many ScopedTimers ended in this node */
+    int         calls      { 0 };
+    /*! wall clock time */
+    double      seconds    { 0. };
+    /*! process cpu time; cpuSeconds/seconds is how many threads were
+        busy on average */
+    double      cpuSeconds { 0. };
+    /*! bytes the process allocated (operator new) meanwhile; not
+        net of deallocations */
+    size_t      bytes      { 0 };
+    std::vector<std::unique_ptr<Phase>> children;
+  };
+
+  /*! the phase tree of all ScopedTimers so far, as an indented
+      table and as JSON */
+  struct Timings {
+    static void printText(std::ostream &out);
+    static void printJSON(std::ostream &out);
+    /*! bytes allocated with operator new since startup */
+    static size_t bytesAllocated();
+  };
+
+  /*! times the scope it lives in: wall and cpu time and bytes
+      allocated go to the node for 'name' under the innermost
+      ScopedTimer alive on the same thread (or under the root, for
+      the first one on a thread). Meant for startup phases - loading,
+      tessellation, program, pipeline, SBT and acceleration structure
+      builds - not for anything per frame */
+  struct ScopedTimer {
+    ScopedTimer(const char *name);
+    ~ScopedTimer();
+
+  private:
+    Phase *phase;
+    Phase *parent;
+    double t0;
+    double cpu0;
+    size_t bytes0;
+  };
+
+}
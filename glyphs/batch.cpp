@@ -0,0 +1,504 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+// renders the viewer command lines stored in '.params' files (see
+// GlyphsViewer::screenShot()) without opening a window
+
+#include "Glyphs.h"
+#include "OptixGlyphs.h"
+#include "ArrowGlyphs.h"
+#include "MotionSpheres.h"
+#include "SphereGlyphs.h"
+#include "SuperGlyphs.h"
+#include "BenchStats.h"
+#include "CameraPath.h"
+#include "Timings.h"
+#include <cuda_runtime.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+#define STB_IMAGE_IMPLEMENTATION 1
+#include "samples/common/3rdParty/stb/stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION 1
+#include "samples/common/3rdParty/stb/stb_image_write.h"
+
+namespace glyphs {
+
+  struct {
+    std::string outDir = ".";
+    /*! total samples per pixel for each job; 0: one frame at the
+        job's -spp (unless there's a targetError) */
+    int spp = 0;
+    /*! render until the mean per-pixel relative error estimate drops
+        below this */
+    float targetError = 0.f;
+    int maxFrames = 4096;
+    /*! instead of one image per job, time a playback of this camera
+        path (see CameraPath.h) with each job's settings */
+    std::string playPath;
+    int framesPerKey = 8;
+    /*! untimed frames at the path's first key */
+    int warmupFrames = 4;
+  } cmdline;
+
+  void usage(const std::string &msg)
+  {
+    if (msg != "") std::cerr << "Error: " << msg << std::endl << std::endl;
+    std::cout << "Usage: ./owlGlyphsBatch <file.params>+ [--out-dir <dir>]"
+              << " [--spp <n> | --target-error <e>] [--max-frames <n>]"
+              << " [--play-path <file> [--frames-per-key <n>] [--warmup <n>]]"
+              << " [--program-cache <dir>|off]"
+              << std::endl;
+    exit(msg != "");
+  }
+
+  /*! one .params file: the viewer cmdline that made it, as far as it
+      matters for the image */
+  struct Job {
+    std::string paramsFileName;
+    /*! the .params file's name minus '.params', in --out-dir */
+    std::string outFileName;
+    std::vector<std::string> glyphFileNames;
+    std::vector<std::string> objFileNames;
+    std::string method = "arrows";
+    int superMode = super::MODE_PROXY;
+    bool halfAccum = false;
+    Camera camera;
+    bool haveCamera = false;
+    vec2i fbSize = vec2i(800,800);
+    /*! 0: 5% of the scene diagonal */
+    float aoRadius = 0.f;
+    /*! everything but the camera, as the viewer would set it up */
+    device::FrameState fs;
+
+    /*! jobs with the same inputs share the loaded data ... */
+    std::string dataKey() const
+    {
+      std::string key;
+      for (auto &f : glyphFileNames) key += f+";";
+      key += "|";
+      for (auto &f : objFileNames) key += f+";";
+      return key;
+    }
+
+    /*! ... and, if they also use the same glyph type, the renderer
+        and its acceleration structures (super glyph modes only
+        rebuild the glyphs) */
+    std::string rendererKey() const
+    {
+      return dataKey()+"|"+method+(halfAccum ? "|half" : "");
+    }
+  };
+
+  /*! file names in .params are relative to where the viewer ran;
+      if that isn't here, try relative to the .params file */
+  std::string resolve(const std::string &fileName, const std::string &paramsFileName)
+  {
+    if (fileName.empty() || fileName[0] == '/' || std::ifstream(fileName))
+      return fileName;
+    const size_t slash = paramsFileName.find_last_of("/\\");
+    if (slash == std::string::npos)
+      return fileName;
+    const std::string relative = paramsFileName.substr(0,slash+1)+fileName;
+    return std::ifstream(relative) ? relative : fileName;
+  }
+
+  Job parseJob(const std::string &paramsFileName)
+  {
+    std::ifstream in(paramsFileName);
+    if (!in)
+      throw std::runtime_error("could not open '"+paramsFileName+"'");
+    std::string line;
+    std::vector<std::string> args;
+    while (std::getline(in,line))
+      if (line.compare(0,8,"cmdline:") == 0) {
+        std::stringstream tokens(line.substr(8));
+        std::string token;
+        // first one is the executable
+        tokens >> token;
+        while (tokens >> token)
+          args.push_back(token);
+      }
+    if (args.empty())
+      throw std::runtime_error("no 'cmdline:' in '"+paramsFileName+"'");
+
+    Job job;
+    job.paramsFileName = paramsFileName;
+    std::string baseName = paramsFileName.substr(paramsFileName.find_last_of("/\\")+1);
+    baseName = baseName.substr(0,baseName.rfind(".params"));
+    job.outFileName = cmdline.outDir+"/"+baseName;
+    // viewer defaults
+    job.fs.samplesPerPixel = 4;
+    job.fs.dbgPixel = vec2i(-1);
+
+    device::FrameState &fs = job.fs;
+    auto next = [&](size_t &i) -> const std::string & {
+      if (++i >= args.size())
+        throw std::runtime_error(paramsFileName+": missing value for '"+args[i-1]+"'");
+      return args[i];
+    };
+    for (size_t i=0;i<args.size();i++) {
+      const std::string arg = args[i];
+      if (arg[0] != '-')
+        job.glyphFileNames.push_back(resolve(arg,paramsFileName));
+      else if (arg == "--camera") {
+        Camera &c = job.camera;
+        c.from.x = std::stof(next(i));
+        c.from.y = std::stof(next(i));
+        c.from.z = std::stof(next(i));
+        c.at.x = std::stof(next(i));
+        c.at.y = std::stof(next(i));
+        c.at.z = std::stof(next(i));
+        c.up.x = std::stof(next(i));
+        c.up.y = std::stof(next(i));
+        c.up.z = std::stof(next(i));
+        job.haveCamera = true;
+      }
+      else if (arg == "-win" || arg == "--size") {
+        job.fbSize.x = std::stoi(next(i));
+        job.fbSize.y = std::stoi(next(i));
+      }
+      else if (arg == "-spp")
+        fs.samplesPerPixel = std::stoi(next(i));
+      else if (arg == "--arrows" || arg == "-arr")
+        job.method = "arrows";
+      else if (arg == "--spheres" || arg == "-sph")
+        job.method = "spheres";
+      else if (arg == "--super" || arg == "-spr")
+        job.method = "super";
+      else if (arg == "--super-mode") {
+        const std::string mode = next(i);
+        job.method = "super";
+        // 'all' is for --measure; render the first one
+        job.superMode = mode == "all" ? 0 : SuperGlyphs::modeFromName(mode);
+      }
+      else if (arg == "--motionblur" || arg == "-mb")
+        job.method = "motionblur";
+      else if (arg == "-sm" || arg == "--shade-mode")
+        fs.shadeMode = std::stoi(next(i));
+      else if (arg == "--ao-samples")
+        fs.aoSamples = std::stoi(next(i));
+      else if (arg == "--ao-radius")
+        job.aoRadius = std::stof(next(i));
+      else if (arg == "--rec-depth" || arg == "-rd")
+        fs.pathDepth = std::stoi(next(i));
+      else if (arg == "--adaptive")
+        fs.adaptiveThreshold = std::stof(next(i));
+      else if (arg == "--adaptive-min-spp")
+        fs.adaptiveMinSamples = std::stoi(next(i));
+      else if (arg == "--sun-sampling") {
+        const std::string strategy = next(i);
+        if (strategy == "bsdf")
+          fs.sunSampling = device::SUN_SAMPLING_BSDF;
+        else if (strategy == "nee")
+          fs.sunSampling = device::SUN_SAMPLING_NEE;
+        else if (strategy == "mis")
+          fs.sunSampling = device::SUN_SAMPLING_MIS;
+        else
+          throw std::runtime_error(paramsFileName+": unknown sun sampling strategy '"+strategy+"'");
+      }
+      else if (arg == "--sampler") {
+        const std::string sampler = next(i);
+        if (sampler == "random")
+          fs.samplerType = device::SAMPLER_RANDOM;
+        else if (sampler == "sobol")
+          fs.samplerType = device::SAMPLER_SOBOL;
+        else
+          throw std::runtime_error(paramsFileName+": unknown sampler '"+sampler+"'");
+      }
+      else if (arg == "--roulette-depth")
+        fs.rouletteDepth = std::stoi(next(i));
+      else if (arg == "--fast-shading")
+        fs.shading = device::SHADING_FAST;
+      else if (arg == "--half-accum")
+        job.halfAccum = true;
+      else if (arg == "--seed")
+        fs.seed = uint32_t(std::stoul(next(i)));
+      else if (arg == "-triobj" || arg == "-obj" || arg == "-quadobj")
+        job.objFileNames.push_back(resolve(next(i),paramsFileName));
+      // interactive only, nothing to do with the image
+      else if (arg == "--lines" || arg == "-measure" || arg == "--measure"
+               || arg == "--ray-stats" || arg == "--pixel-stats"
+               || arg == "--reproject" || arg == "--timings" || arg == "--memory"
+               || arg == "--bench")
+        ;
+      else if (arg == "-o" || arg == "--target-error" || arg == "--heat-map-counter"
+               || arg == "--motion-target-ms" || arg == "--reproject-max-spp"
+               || arg == "--display-interval" || arg == "--timings-json"
+               || arg == "--memory-budget" || arg == "--rebuild-threshold"
+               || arg == "--warmup" || arg == "--bench-frames" || arg == "--bench-spp"
+               || arg == "--bench-json" || arg == "--record-path" || arg == "--record-interval"
+               || arg == "--play-path" || arg == "--frames-per-key"
+               || arg == "--program-cache")
+        next(i);
+      else
+        throw std::runtime_error(paramsFileName+": unknown viewer arg '"+arg+"'");
+    }
+    if (job.glyphFileNames.empty())
+      throw std::runtime_error(paramsFileName+": no glyph file");
+    fs.halfAccum    = job.halfAccum;
+    fs.deferDisplay = job.halfAccum;
+    return job;
+  }
+
+  void savePNG(const std::string &fileName,
+               const vec2i &fbSize,
+               const uint32_t *fb)
+  {
+    std::vector<uint32_t> pixels;
+    for (int y=0;y<fbSize.y;y++) {
+      const uint32_t *line = fb + (fbSize.y-1-y)*fbSize.x;
+      for (int x=0;x<fbSize.x;x++)
+        pixels.push_back(line[x] | (0xff << 24));
+    }
+    if (!stbi_write_png(fileName.c_str(),fbSize.x,fbSize.y,4,
+                        pixels.data(),fbSize.x*sizeof(uint32_t)))
+      throw std::runtime_error("could not write '"+fileName+"'");
+  }
+
+  OWLGlyphs *createRenderer(const Job &job)
+  {
+    ScopedTimer timer("create renderer");
+    OWLGlyphs *renderer = nullptr;
+    if (job.method == "arrows")
+      renderer = new ArrowGlyphs;
+    else if (job.method == "spheres")
+      renderer = new SphereGlyphs;
+    else if (job.method == "super")
+      renderer = new SuperGlyphs(job.superMode);
+    else if (job.method == "motionblur")
+      renderer = new MotionSpheres;
+    else
+      throw std::runtime_error("unknown glyphs method '"+job.method+"'");
+    renderer->halfAccum = job.halfAccum;
+    return renderer;
+  }
+
+  extern "C" int main(int argc, char **argv)
+  {
+    std::vector<std::string> paramsFileNames;
+    for (int i=1;i<argc;i++) {
+      const std::string arg = argv[i];
+      if (arg[0] != '-')
+        paramsFileNames.push_back(arg);
+      else if (arg == "--out-dir")
+        cmdline.outDir = argv[++i];
+      else if (arg == "--spp")
+        cmdline.spp = std::atoi(argv[++i]);
+      else if (arg == "--target-error")
+        cmdline.targetError = std::atof(argv[++i]);
+      else if (arg == "--max-frames")
+        cmdline.maxFrames = std::atoi(argv[++i]);
+      else if (arg == "--play-path")
+        cmdline.playPath = argv[++i];
+      else if (arg == "--frames-per-key")
+        cmdline.framesPerKey = std::atoi(argv[++i]);
+      else if (arg == "--warmup")
+        cmdline.warmupFrames = std::atoi(argv[++i]);
+      else if (arg == "--program-cache") {
+        const std::string dir = argv[++i];
+        OWLGlyphs::programCacheDir = dir == "off" ? "" : dir;
+      }
+      else
+        usage("unknown cmdline arg '"+arg+"'");
+    }
+    if (paramsFileNames.empty())
+      usage("no .params files given");
+    if (cmdline.spp > 0 && cmdline.targetError > 0.f)
+      usage("--spp and --target-error are mutually exclusive");
+    CameraPath cameraPath;
+    if (!cmdline.playPath.empty()) {
+      if (cmdline.spp > 0 || cmdline.targetError > 0.f)
+        usage("--play-path renders each frame at the job's -spp;"
+              " --spp and --target-error don't apply");
+      if (cmdline.framesPerKey < 1)
+        usage("--frames-per-key needs at least one frame");
+      cameraPath = CameraPath::load(cmdline.playPath);
+    }
+
+    std::vector<Job> jobs;
+    for (auto &fileName : paramsFileNames)
+      jobs.push_back(parseJob(fileName));
+    // group jobs by inputs and renderer, so each gets loaded and
+    // built once
+    std::stable_sort(jobs.begin(),jobs.end(),[](const Job &a, const Job &b) {
+        if (a.rendererKey() != b.rendererKey())
+          return a.rendererKey() < b.rendererKey();
+        return a.method == "super" && a.superMode < b.superMode;
+      });
+
+    std::string             dataKey, rendererKey;
+    Glyphs::SP              glyphs;
+    Triangles::SP           triangles;
+    std::unique_ptr<OWLGlyphs> renderer;
+    for (const Job &job : jobs) {
+      if (job.dataKey() != dataKey) {
+        renderer.reset();
+        rendererKey = "";
+        ScopedTimer timer("load");
+        glyphs = Glyphs::load(job.glyphFileNames);
+        triangles
+          = job.objFileNames.empty()
+          ? nullptr
+          : Triangles::load(job.objFileNames,vec3f(.8f));
+        dataKey = job.dataKey();
+      }
+
+      SuperGlyphs *superGlyphs = dynamic_cast<SuperGlyphs *>(renderer.get());
+      if (job.rendererKey() != rendererKey) {
+        renderer.reset(createRenderer(job));
+        ScopedTimer timer("set model");
+        renderer->setModel(glyphs,triangles);
+        rendererKey = job.rendererKey();
+      }
+      else if (superGlyphs && superGlyphs->mode != job.superMode) {
+        // same data, other super glyph mode: only the glyphs get rebuilt
+        ScopedTimer timer("set model");
+        superGlyphs->setMode(job.superMode,glyphs,triangles);
+      }
+
+      if (renderer->fbSize != job.fbSize) {
+        const size_t numPixels = size_t(job.fbSize.x)*job.fbSize.y;
+        if (!renderer->colorBuffer)
+          renderer->colorBuffer
+            = renderer->createHostPinnedBuffer(MEM_FRAME_BUFFER,OWL_INT,numPixels);
+        renderer->resizeBuffer(renderer->colorBuffer,numPixels);
+        renderer->resizeFrameBuffer(renderer->mapColorBuffer(),job.fbSize);
+        owlBuildSBT(renderer->context);
+      }
+
+      // same camera and scene-dependent defaults as the viewer
+      box3f sceneBounds = glyphs->getBounds();
+      if (triangles)
+        sceneBounds.extend(triangles->bounds);
+      device::FrameState fs = job.fs;
+      auto setCamera = [&](const Camera &camera) {
+        camera.setup(fs,job.fbSize);
+        fs.depthScale
+          = length(camera.from - sceneBounds.center())
+          + .5f*length(sceneBounds.span());
+      };
+      setCamera(job.haveCamera
+                ? job.camera
+                : Camera::defaultFor(sceneBounds));
+      fs.aoRadius
+        = job.aoRadius > 0.f
+        ? job.aoRadius
+        : .05f*length(sceneBounds.span());
+      fs.errorStatsEnabled = cmdline.targetError > 0.f;
+
+      if (!cameraPath.keys.empty()) {
+        // every frame a fresh accumulation at the next camera on the
+        // path, as the viewer's --play-path renders them
+        fs.rayStatsEnabled = true;
+        const int numFrames = cameraPath.numFrames(cmdline.framesPerKey);
+        BenchRun run;
+        run.warmupFrames    = cmdline.warmupFrames;
+        run.samplesPerPixel = numFrames*fs.samplesPerPixel;
+        run.seed            = fs.seed;
+        {
+          ScopedTimer timer("play path");
+          for (int frame=-cmdline.warmupFrames;frame<numFrames;frame++) {
+            setCamera(cameraPath.at(std::max(frame,0),cmdline.framesPerKey));
+            fs.accumID = 0;
+            const double t0 = getCurrentTime();
+            renderer->updateFrameState(fs);
+            renderer->render();
+            if (fs.deferDisplay)
+              renderer->display();
+            // launches are asynchronous; time the frame, not the launch
+            cudaDeviceSynchronize();
+            if (frame >= 0)
+              run.addFrame(getCurrentTime()-t0,renderer->getRayStats().total());
+          }
+        }
+        savePNG(job.outFileName,job.fbSize,renderer->mapColorBuffer());
+        const std::string jsonFileName = job.outFileName+".path.json";
+        std::ofstream json(jsonFileName);
+        if (!json)
+          throw std::runtime_error("could not open '"+jsonFileName+"'");
+        std::string method = job.method;
+        if (job.method == "super")
+          method += std::string("_")+SuperGlyphs::modeName(job.superMode);
+        run.printJSON(json,{
+            { "tool",         "owlGlyphsBatch" },
+            { "params",       job.paramsFileName },
+            { "method",       method },
+            { "dataset",      datasetName(job.glyphFileNames) },
+            { "size",         std::to_string(job.fbSize.x)+"x"+std::to_string(job.fbSize.y) },
+            { "spp",          std::to_string(fs.samplesPerPixel) },
+            { "depth",        std::to_string(fs.pathDepth) },
+            { "path",         cmdline.playPath },
+            { "framesPerKey", std::to_string(cmdline.framesPerKey) } });
+        json << std::endl;
+        std::cout << "#glyphs.batch: " << jsonFileName
+                  << " (" << method << ") " << numFrames << " path frames,"
+                  << " median " << prettyDouble(run.percentile(50.)) << "s,"
+                  << " p95 " << prettyDouble(run.percentile(95.)) << "s" << std::endl;
+        continue;
+      }
+
+      const int totalSpp = cmdline.spp > 0 ? cmdline.spp : fs.samplesPerPixel;
+      const int numFrames
+        = cmdline.targetError > 0.f
+        ? cmdline.maxFrames
+        : std::max(1,(totalSpp+fs.samplesPerPixel-1)/fs.samplesPerPixel);
+
+      const double t0 = getCurrentTime();
+      int frame = 0;
+      float error = 0.f;
+      {
+        ScopedTimer timer("render");
+        while (frame < numFrames) {
+          fs.accumID = frame;
+          renderer->updateFrameState(fs);
+          renderer->render();
+          frame++;
+          if (cmdline.targetError > 0.f) {
+            error = renderer->getErrorStats().meanRelativeError;
+            if (error <= cmdline.targetError)
+              break;
+          }
+        }
+        if (fs.deferDisplay)
+          renderer->display();
+      }
+      const double t = getCurrentTime()-t0;
+
+      savePNG(job.outFileName,job.fbSize,renderer->mapColorBuffer());
+      std::cout << "#glyphs.batch: " << job.outFileName
+                << " (" << job.method;
+      if (job.method == "super")
+        std::cout << "/" << SuperGlyphs::modeName(job.superMode);
+      std::cout << ") " << frame << " frames, "
+                << frame*fs.samplesPerPixel << " spp, "
+                << prettyDouble(t) << "s";
+      if (cmdline.targetError > 0.f) {
+        std::cout << ", error " << error;
+        if (error > cmdline.targetError)
+          std::cout << " (target not reached)";
+      }
+      std::cout << std::endl;
+    }
+
+    Timings::printText(std::cout);
+    return 0;
+  }
+
+}
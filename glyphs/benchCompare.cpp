@@ -0,0 +1,616 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! keeps the frame times of benchmark runs (the JSON that --bench-json
+    writes, see BenchStats.h) in a store file, filed under a commit id
+    and the run's configuration, and compares the runs of two commits
+    config by config: the change in median frame time, with a
+    bootstrap confidence interval, and whether that is a regression,
+    an improvement, or within the noise */
+
+#include "glyphs/BenchStats.h"
+// std
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace glyphs {
+
+  struct {
+    std::string command;
+    std::string store = "bench-results.txt";
+    /*! for 'add' */
+    std::string commit;
+    /*! for 'add': replaces the runs' own dataset name, if any */
+    std::string dataset;
+    std::vector<std::string> inputs;
+    /*! changes smaller than this fraction are never flagged, however
+        certain they are */
+    double threshold  = .05;
+    double confidence = .95;
+    int    resamples  = 2000;
+  } cmdline;
+
+  void usage(const std::string &msg)
+  {
+    if (msg != "") std::cerr << "Error: " << msg << std::endl << std::endl;
+    std::cout << "Usage:" << std::endl
+              << "  ./owlGlyphsBenchCompare add --commit <id> [--dataset <name>]"
+              << " <result.json>+" << std::endl
+              << "  ./owlGlyphsBenchCompare compare <baseline> <candidate>"
+              << " [--threshold <f>] [--confidence <f>] [--resamples <n>]" << std::endl
+              << "  ./owlGlyphsBenchCompare list" << std::endl
+              << "all take [--store <file>] (default bench-results.txt);"
+              << " compare takes commit ids or result files" << std::endl;
+    exit(msg != "");
+  }
+
+  // ------------------------------------------------------------------
+  // just enough JSON to read back what BenchRun::printJSON writes
+  // ------------------------------------------------------------------
+
+  struct JSON {
+    enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+    /*! null if there is no such member */
+    const JSON *get(const std::string &key) const
+    {
+      for (auto &member : object)
+        if (member.first == key) return &member.second;
+      return nullptr;
+    }
+
+    Type   type   { NUL };
+    double number { 0. };
+    std::string string;
+    std::vector<JSON> array;
+    std::vector<std::pair<std::string,JSON>> object;
+  };
+
+  struct JSONParser {
+    JSONParser(const std::string &text, const std::string &fileName)
+      : text(text), fileName(fileName)
+    {}
+
+    JSON parseDocument()
+    {
+      JSON value = parseValue();
+      skipSpace();
+      if (pos != text.size()) fail("trailing characters");
+      return value;
+    }
+
+  private:
+    void fail(const std::string &what)
+    {
+      throw std::runtime_error("'"+fileName+"', offset "+std::to_string(pos)
+                               +": "+what);
+    }
+
+    void skipSpace()
+    {
+      while (pos < text.size() && isspace((unsigned char)text[pos])) pos++;
+    }
+
+    void expect(char c)
+    {
+      skipSpace();
+      if (pos >= text.size() || text[pos] != c)
+        fail(std::string("expected '")+c+"'");
+      pos++;
+    }
+
+    bool accept(char c)
+    {
+      skipSpace();
+      if (pos < text.size() && text[pos] == c) { pos++; return true; }
+      return false;
+    }
+
+    std::string parseString()
+    {
+      expect('"');
+      std::string result;
+      while (pos < text.size() && text[pos] != '"') {
+        char c = text[pos++];
+        if (c == '\\') {
+          if (pos >= text.size()) break;
+          c = text[pos++];
+          switch (c) {
+          case 'n': c = '\n'; break;
+          case 't': c = '\t'; break;
+          case 'r': c = '\r'; break;
+          case 'b': c = '\b'; break;
+          case 'f': c = '\f'; break;
+          case 'u': c = '?'; pos = std::min(pos+4,text.size()); break;
+          default: break;
+          }
+        }
+        result += c;
+      }
+      expect('"');
+      return result;
+    }
+
+    JSON parseValue()
+    {
+      skipSpace();
+      if (pos >= text.size()) fail("unexpected end of file");
+      JSON value;
+      const char c = text[pos];
+      if (c == '{') {
+        value.type = JSON::OBJECT;
+        pos++;
+        if (accept('}')) return value;
+        do {
+          skipSpace();
+          const std::string key = parseString();
+          expect(':');
+          value.object.push_back({key,parseValue()});
+        } while (accept(','));
+        expect('}');
+      } else if (c == '[') {
+        value.type = JSON::ARRAY;
+        pos++;
+        if (accept(']')) return value;
+        do {
+          value.array.push_back(parseValue());
+        } while (accept(','));
+        expect(']');
+      } else if (c == '"') {
+        value.type   = JSON::STRING;
+        value.string = parseString();
+      } else if (text.compare(pos,4,"true") == 0) {
+        value.type = JSON::BOOL; value.number = 1.; pos += 4;
+      } else if (text.compare(pos,5,"false") == 0) {
+        value.type = JSON::BOOL; pos += 5;
+      } else if (text.compare(pos,4,"null") == 0) {
+        pos += 4;
+      } else {
+        const char *begin = text.c_str()+pos;
+        char *end = nullptr;
+        value.type   = JSON::NUMBER;
+        value.number = strtod(begin,&end);
+        if (end == begin) fail("unexpected character");
+        pos += end-begin;
+      }
+      return value;
+    }
+
+    const std::string &text;
+    const std::string  fileName;
+    size_t pos = 0;
+  };
+
+  // ------------------------------------------------------------------
+  // the store
+  // ------------------------------------------------------------------
+
+  /*! the frame times of one run, and what it ran: the run's config
+      members as 'key=value' pairs, sorted by key and separated by ';' */
+  struct StoredRun {
+    std::string commit;
+    std::string config;
+    std::vector<double> frameMs;
+  };
+
+  /*! the viewer's command line (its 'args'), without the options
+      that only say where results go or come from: what's left are
+      settings like the shade mode that have no config member of
+      their own */
+  std::string withoutOutputArgs(const std::string &args)
+  {
+    static const std::set<std::string> outputArgs
+      = { "--bench-json", "-o", "--record-path", "--program-cache" };
+    std::stringstream ss(args);
+    std::string result, arg;
+    while (ss >> arg) {
+      if (outputArgs.count(arg)) {
+        ss >> arg;
+        continue;
+      }
+      result += (result.empty() ? "" : " ")+arg;
+    }
+    return result;
+  }
+
+  std::string sanitized(std::string s)
+  {
+    for (char &c : s)
+      if (c == ';' || c == '=' || c == '\t' || c == '\n' || c == '\r') c = '_';
+    return s;
+  }
+
+  std::map<std::string,std::string> parseConfig(const std::string &config)
+  {
+    std::map<std::string,std::string> members;
+    std::stringstream ss(config);
+    std::string pair;
+    while (std::getline(ss,pair,';')) {
+      const size_t eq = pair.find('=');
+      if (eq != std::string::npos)
+        members[pair.substr(0,eq)] = pair.substr(eq+1);
+    }
+    return members;
+  }
+
+  /*! every run in a --bench-json file: one run object (viewer, batch
+      --play-path) or { "runs": [ ... ] } (owlGlyphsCPUBench) */
+  std::vector<StoredRun> readResultFile(const std::string &fileName)
+  {
+    std::ifstream in(fileName);
+    if (!in.good())
+      throw std::runtime_error("could not open '"+fileName+"'");
+    std::stringstream text;
+    text << in.rdbuf();
+    const JSON doc = JSONParser(text.str(),fileName).parseDocument();
+
+    std::vector<const JSON *> runObjects;
+    if (const JSON *runs = doc.get("runs")) {
+      for (auto &run : runs->array) runObjects.push_back(&run);
+    } else
+      runObjects.push_back(&doc);
+
+    std::vector<StoredRun> result;
+    for (const JSON *run : runObjects) {
+      const JSON *config  = run->get("config");
+      const JSON *frameMs = run->get("frameTimesMs");
+      if (!config || config->type != JSON::OBJECT
+          || !frameMs || frameMs->type != JSON::ARRAY)
+        throw std::runtime_error("'"+fileName+"' is not a benchmark result"
+                                 " (see --bench-json)");
+      std::map<std::string,std::string> members;
+      for (auto &member : config->object)
+        members[sanitized(member.first)]
+          = sanitized(member.first == "args"
+                      ? withoutOutputArgs(member.second.string)
+                      : member.second.string);
+      if (cmdline.dataset != "")
+        members["dataset"] = sanitized(cmdline.dataset);
+
+      StoredRun stored;
+      for (auto &member : members)
+        stored.config += (stored.config.empty() ? "" : ";")
+          + member.first + "=" + member.second;
+      for (auto &t : frameMs->array)
+        stored.frameMs.push_back(t.number);
+      if (stored.frameMs.empty())
+        throw std::runtime_error("'"+fileName+"' has a run without frames");
+      result.push_back(stored);
+    }
+    return result;
+  }
+
+  /*! one run per line: commit, config, frame times in ms; tab
+      separated. Lines starting with '#' are comments */
+  std::vector<StoredRun> readStore(const std::string &fileName)
+  {
+    std::vector<StoredRun> runs;
+    std::ifstream in(fileName);
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in,line)) {
+      lineNo++;
+      if (line.empty() || line[0] == '#') continue;
+      std::stringstream ss(line);
+      StoredRun run;
+      std::string times;
+      if (!std::getline(ss,run.commit,'\t') || !std::getline(ss,run.config,'\t')
+          || !std::getline(ss,times))
+        throw std::runtime_error("'"+fileName+"', line "+std::to_string(lineNo)
+                                 +": expected commit, config and frame times");
+      std::stringstream ts(times);
+      double t;
+      while (ts >> t) run.frameMs.push_back(t);
+      runs.push_back(run);
+    }
+    return runs;
+  }
+
+  void appendToStore(const std::string &fileName,
+                     const std::vector<StoredRun> &runs)
+  {
+    std::ofstream out(fileName,std::ios::app);
+    if (!out.good())
+      throw std::runtime_error("could not open '"+fileName+"' for writing");
+    out << std::setprecision(6);
+    for (auto &run : runs) {
+      out << run.commit << "\t" << run.config << "\t";
+      for (size_t i=0;i<run.frameMs.size();i++)
+        out << (i ? " " : "") << run.frameMs[i];
+      out << std::endl;
+    }
+  }
+
+  // ------------------------------------------------------------------
+  // comparing
+  // ------------------------------------------------------------------
+
+  double median(std::vector<double> values)
+  {
+    if (values.empty()) return 0.;
+    const size_t mid = values.size()/2;
+    std::nth_element(values.begin(),values.begin()+mid,values.end());
+    double result = values[mid];
+    if (values.size() % 2 == 0)
+      result = .5*(result+*std::max_element(values.begin(),values.begin()+mid));
+    return result;
+  }
+
+  std::vector<double> pooled(const std::vector<const StoredRun *> &runs)
+  {
+    std::vector<double> frames;
+    for (auto run : runs)
+      frames.insert(frames.end(),run->frameMs.begin(),run->frameMs.end());
+    return frames;
+  }
+
+  /*! the pooled frame times of a resample: runs drawn with
+      replacement, then frames within each drawn run, so that run to
+      run differences (clocks, other processes) widen the interval as
+      much as frame to frame ones */
+  std::vector<double> resample(const std::vector<const StoredRun *> &runs,
+                               std::mt19937 &rng)
+  {
+    std::vector<double> frames;
+    std::uniform_int_distribution<size_t> pickRun(0,runs.size()-1);
+    for (size_t r=0;r<runs.size();r++) {
+      const StoredRun *run = runs[pickRun(rng)];
+      std::uniform_int_distribution<size_t> pickFrame(0,run->frameMs.size()-1);
+      for (size_t f=0;f<run->frameMs.size();f++)
+        frames.push_back(run->frameMs[pickFrame(rng)]);
+    }
+    return frames;
+  }
+
+  struct Comparison {
+    double baseMs  { 0. };
+    double newMs   { 0. };
+    /*! ratio of medians, candidate over baseline, and its interval */
+    double ratio   { 1. };
+    double ciLower { 1. };
+    double ciUpper { 1. };
+  };
+
+  Comparison compare(const std::vector<const StoredRun *> &base,
+                     const std::vector<const StoredRun *> &cand)
+  {
+    Comparison c;
+    c.baseMs = median(pooled(base));
+    c.newMs  = median(pooled(cand));
+    c.ratio  = c.baseMs > 0. ? c.newMs/c.baseMs : 1.;
+
+    // fixed seed: the same store gives the same verdicts
+    std::mt19937 rng(0x5eed);
+    std::vector<double> ratios;
+    for (int i=0;i<cmdline.resamples;i++) {
+      const double b = median(resample(base,rng));
+      const double n = median(resample(cand,rng));
+      if (b > 0.) ratios.push_back(n/b);
+    }
+    if (ratios.empty()) return c;
+    std::sort(ratios.begin(),ratios.end());
+    const double alpha = .5*(1.-cmdline.confidence);
+    c.ciLower = ratios[size_t(alpha*(ratios.size()-1))];
+    c.ciUpper = ratios[size_t((1.-alpha)*(ratios.size()-1))];
+    return c;
+  }
+
+  std::string percent(double ratio)
+  {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << std::showpos
+       << 100.*(ratio-1.) << "%";
+    return ss.str();
+  }
+
+  typedef std::map<std::string,std::vector<const StoredRun *>> RunsByConfig;
+
+  /*! a result file's runs, or the stored runs of a commit */
+  RunsByConfig select(const std::string &what,
+                      const std::vector<StoredRun> &store,
+                      std::vector<StoredRun> &fromFile)
+  {
+    RunsByConfig result;
+    if (std::ifstream(what).good()) {
+      fromFile = readResultFile(what);
+      for (auto &run : fromFile)
+        result[run.config].push_back(&run);
+    } else {
+      for (auto &run : store)
+        if (run.commit == what)
+          result[run.config].push_back(&run);
+      if (result.empty())
+        throw std::runtime_error("no runs of '"+what+"' in '"+cmdline.store
+                                 +"', and no such file");
+    }
+    return result;
+  }
+
+  /*! prints the table, grouped by method and dataset; returns the
+      number of regressions */
+  int compareCommits(const std::string &baseName, const std::string &candName)
+  {
+    const std::vector<StoredRun> store = readStore(cmdline.store);
+    std::vector<StoredRun> baseFile, candFile;
+    const RunsByConfig base = select(baseName,store,baseFile);
+    const RunsByConfig cand = select(candName,store,candFile);
+
+    struct Row {
+      std::string method, dataset, rest;
+      const std::vector<const StoredRun *> *base, *cand;
+    };
+    std::vector<Row> rows;
+    std::set<std::string> configs;
+    for (auto &it : base) configs.insert(it.first);
+    for (auto &it : cand) configs.insert(it.first);
+    for (auto &config : configs) {
+      std::map<std::string,std::string> members = parseConfig(config);
+      Row row;
+      row.method  = members["method"];
+      row.dataset = members["dataset"];
+      members.erase("method");
+      members.erase("dataset");
+      for (auto &m : members)
+        row.rest += (row.rest.empty() ? "" : " ") + m.first + "=" + m.second;
+      row.base = base.count(config) ? &base.at(config) : nullptr;
+      row.cand = cand.count(config) ? &cand.at(config) : nullptr;
+      rows.push_back(row);
+    }
+    std::sort(rows.begin(),rows.end(),[](const Row &a, const Row &b) {
+        return std::tie(a.method,a.dataset,a.rest) < std::tie(b.method,b.dataset,b.rest);
+      });
+
+    std::cout << "#glyphs.bench: " << candName << " vs. " << baseName
+              << "; median frame time, " << int(100.*cmdline.confidence+.5)
+              << "% confidence interval, changes under "
+              << 100.*cmdline.threshold << "% are not flagged" << std::endl;
+    std::cout << std::left
+              << std::setw(12) << "method"
+              << std::setw(24) << "dataset" << std::right
+              << std::setw(11) << "base ms"
+              << std::setw(11) << "new ms"
+              << std::setw(9)  << "change"
+              << std::setw(21) << "interval"
+              << "  " << std::left << std::setw(12) << "verdict"
+              << "config" << std::endl;
+    int numRegressions = 0, numImprovements = 0;
+    for (auto &row : rows) {
+      std::cout << std::left
+                << std::setw(12) << row.method
+                << std::setw(24) << row.dataset << std::right;
+      if (!row.base || !row.cand) {
+        std::stringstream ms;
+        ms << std::fixed << std::setprecision(3)
+           << median(pooled(row.base ? *row.base : *row.cand));
+        std::cout << std::setw(11) << (row.base ? ms.str() : "-")
+                  << std::setw(11) << (row.cand ? ms.str() : "-")
+                  << std::setw(30) << ""
+                  << "  " << std::left << std::setw(12)
+                  << (row.base ? "only base" : "only new")
+                  << row.rest << std::endl;
+        continue;
+      }
+      const Comparison c = compare(*row.base,*row.cand);
+      std::string verdict = "same";
+      if (c.ciLower > 1.+cmdline.threshold) {
+        verdict = "REGRESSION";
+        numRegressions++;
+      } else if (c.ciUpper < 1.-cmdline.threshold) {
+        verdict = "improvement";
+        numImprovements++;
+      } else if (c.ciLower > 1. || c.ciUpper < 1.)
+        // real, but too small to care
+        verdict = "~"+verdict;
+      std::cout << std::fixed << std::setprecision(3)
+                << std::setw(11) << c.baseMs
+                << std::setw(11) << c.newMs
+                << std::setw(9)  << percent(c.ratio)
+                << std::setw(21) << ("["+percent(c.ciLower)+", "+percent(c.ciUpper)+"]")
+                << "  " << std::left << std::setw(12) << verdict
+                << row.rest << std::endl;
+    }
+    std::cout << "#glyphs.bench: " << numRegressions << " regression(s), "
+              << numImprovements << " improvement(s)" << std::endl;
+    return numRegressions;
+  }
+
+  void listStore()
+  {
+    const std::vector<StoredRun> store = readStore(cmdline.store);
+    // in the order they were first added
+    std::vector<std::string> commits;
+    std::map<std::string,std::set<std::string>> configs;
+    std::map<std::string,int> numRuns;
+    for (auto &run : store) {
+      if (!numRuns.count(run.commit)) commits.push_back(run.commit);
+      numRuns[run.commit]++;
+      configs[run.commit].insert(run.config);
+    }
+    for (auto &commit : commits)
+      std::cout << commit << ": " << numRuns[commit] << " run(s) of "
+                << configs[commit].size() << " config(s)" << std::endl;
+  }
+
+  extern "C" int main(int argc, char **argv)
+  {
+    for (int i=1;i<argc;i++) {
+      const std::string arg = argv[i];
+      if (arg == "--store")
+        cmdline.store = argv[++i];
+      else if (arg == "--commit")
+        cmdline.commit = argv[++i];
+      else if (arg == "--dataset")
+        cmdline.dataset = argv[++i];
+      else if (arg == "--threshold")
+        cmdline.threshold = std::atof(argv[++i]);
+      else if (arg == "--confidence")
+        cmdline.confidence = std::atof(argv[++i]);
+      else if (arg == "--resamples")
+        cmdline.resamples = std::atoi(argv[++i]);
+      else if (arg == "-h" || arg == "--help")
+        usage("");
+      else if (arg[0] == '-')
+        usage("unknown cmdline arg '"+arg+"'");
+      else if (cmdline.command.empty())
+        cmdline.command = arg;
+      else
+        cmdline.inputs.push_back(arg);
+    }
+    if (cmdline.confidence <= 0. || cmdline.confidence >= 1.)
+      usage("--confidence has to be between 0 and 1");
+
+    try {
+      if (cmdline.command == "add") {
+        if (cmdline.commit.empty())
+          usage("'add' needs a --commit <id>");
+        if (cmdline.commit.find_first_of("\t\n") != std::string::npos)
+          usage("invalid commit id");
+        if (cmdline.inputs.empty())
+          usage("no result files to add");
+        std::vector<StoredRun> runs;
+        for (auto &fileName : cmdline.inputs)
+          for (auto &run : readResultFile(fileName)) {
+            run.commit = cmdline.commit;
+            runs.push_back(run);
+          }
+        appendToStore(cmdline.store,runs);
+        std::cout << "#glyphs.bench: added " << runs.size() << " run(s) of '"
+                  << cmdline.commit << "' to '" << cmdline.store << "'" << std::endl;
+        return 0;
+      } else if (cmdline.command == "compare") {
+        if (cmdline.inputs.size() != 2)
+          usage("'compare' takes a baseline and a candidate");
+        return compareCommits(cmdline.inputs[0],cmdline.inputs[1]);
+      } else if (cmdline.command == "list") {
+        listStore();
+        return 0;
+      } else
+        usage(cmdline.command.empty()
+              ? "no command" : "unknown command '"+cmdline.command+"'");
+    } catch (const std::exception &e) {
+      std::cerr << "#glyphs.bench: " << e.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+}
@@ -0,0 +1,175 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "glyphs/cpu/BVH.h"
+
+namespace glyphs {
+  namespace cpu {
+
+    inline float area(const box3f &box)
+    {
+      const vec3f d = box.upper - box.lower;
+      return 2.f*(d.x*d.y+d.y*d.z+d.z*d.x);
+    }
+
+    enum { NUM_BINS = 16 };
+
+    struct Builder {
+      Builder(BVH &bvh,
+              const std::vector<box3f> &primBounds,
+              int maxLeafSize)
+        : bvh(bvh), primBounds(primBounds), maxLeafSize(maxLeafSize)
+      {}
+
+      void makeLeaf(int nodeID, int begin, int end)
+      {
+        bvh.nodes[nodeID].offset = begin;
+        bvh.nodes[nodeID].count  = end-begin;
+      }
+
+      void build(int nodeID, int begin, int end, int depth)
+      {
+        int *prims = bvh.primIDs.data();
+
+        box3f bounds, centBounds;
+        for (int i=begin;i<end;i++) {
+          bounds.extend(primBounds[prims[i]]);
+          centBounds.extend(primBounds[prims[i]].center());
+        }
+        bvh.nodes[nodeID].bounds = bounds;
+
+        const int numPrims = end-begin;
+        // a leaf at depth d leaves at most d nodes on the traversal
+        // stack; coincident glyphs can otherwise split on forever
+        if (numPrims <= maxLeafSize || depth >= BVH::maxDepth-1)
+          return makeLeaf(nodeID,begin,end);
+
+        const vec3f span = centBounds.span();
+        const int dim
+          = (span.x >= span.y && span.x >= span.z) ? 0
+          : (span.y >= span.z ? 1 : 2);
+        const float lo = centBounds.lower[dim];
+        const float width = span[dim];
+        if (width <= 0.f)
+          // all centroids on top of each other - just split in the middle
+          return split(nodeID,begin,begin+numPrims/2,end,depth);
+
+        auto binOf = [&](int primID) {
+          const float c = primBounds[primID].center()[dim];
+          return min(NUM_BINS-1,int(NUM_BINS*(c-lo)/width));
+        };
+
+        box3f binBounds[NUM_BINS];
+        int   binCount[NUM_BINS] = { 0 };
+        for (int i=begin;i<end;i++) {
+          const int bin = binOf(prims[i]);
+          binBounds[bin].extend(primBounds[prims[i]]);
+          binCount[bin]++;
+        }
+
+        // sweep from the right, then evaluate SAH from the left
+        float rightArea[NUM_BINS];
+        box3f rightBox; int rightCount = 0;
+        for (int i=NUM_BINS-1;i>0;--i) {
+          rightBox.extend(binBounds[i]);
+          rightCount += binCount[i];
+          rightArea[i] = rightCount ? area(rightBox)*rightCount : 0.f;
+        }
+        float bestCost = std::numeric_limits<float>::infinity();
+        int   bestSplit = -1;
+        box3f leftBox; int leftCount = 0;
+        for (int i=1;i<NUM_BINS;i++) {
+          leftBox.extend(binBounds[i-1]);
+          leftCount += binCount[i-1];
+          if (leftCount == 0 || leftCount == numPrims) continue;
+          const float cost = area(leftBox)*leftCount + rightArea[i];
+          if (cost < bestCost) { bestCost = cost; bestSplit = i; }
+        }
+
+        if (bestSplit < 0)
+          return split(nodeID,begin,begin+numPrims/2,end,depth);
+
+        const int *mid = std::partition(prims+begin,prims+end,
+                                        [&](int primID) { return binOf(primID) < bestSplit; });
+        split(nodeID,begin,int(mid-prims),end,depth);
+      }
+
+      void split(int nodeID, int begin, int mid, int end, int depth)
+      {
+        const int childID = (int)bvh.nodes.size();
+        bvh.nodes.push_back(BVH::Node());
+        bvh.nodes.push_back(BVH::Node());
+        bvh.nodes[nodeID].offset = childID;
+        bvh.nodes[nodeID].count  = 0;
+        build(childID+0,begin,mid,depth+1);
+        build(childID+1,mid,end,depth+1);
+      }
+
+      BVH &bvh;
+      const std::vector<box3f> &primBounds;
+      const int maxLeafSize;
+    };
+
+    void BVH::build(const std::vector<box3f> &primBounds,
+                    int maxLeafSize)
+    {
+      nodes.clear();
+      primIDs.resize(primBounds.size());
+      for (size_t i=0;i<primBounds.size();i++)
+        primIDs[i] = (int)i;
+      if (primBounds.empty())
+        return;
+
+      nodes.reserve(2*primBounds.size());
+      nodes.push_back(Node());
+      Builder(*this,primBounds,maxLeafSize).build(0,0,(int)primIDs.size(),0);
+    }
+
+    void BVH::refit(const std::vector<box3f> &primBounds)
+    {
+      assert(primBounds.size() == primIDs.size());
+      // children always get allocated after their parents, so a
+      // reverse sweep visits children before parents
+      for (int nodeID=(int)nodes.size()-1;nodeID>=0;--nodeID) {
+        Node &node = nodes[nodeID];
+        box3f bounds;
+        if (node.count == 0) {
+          bounds.extend(nodes[node.offset+0].bounds);
+          bounds.extend(nodes[node.offset+1].bounds);
+        } else {
+          for (int i=0;i<node.count;i++)
+            bounds.extend(primBounds[primIDs[node.offset+i]]);
+        }
+        node.bounds = bounds;
+      }
+    }
+
+    float BVH::sahCost() const
+    {
+      if (nodes.empty()) return 0.f;
+
+      const float C_trav = 1.f, C_isec = 1.f;
+      const float rootArea = max(area(nodes[0].bounds),1e-20f);
+      float cost = 0.f;
+      for (auto &node : nodes)
+        cost
+          += area(node.bounds) / rootArea
+          * (node.count == 0 ? C_trav : C_isec*node.count);
+      return cost;
+    }
+
+  }
+}
@@ -0,0 +1,160 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/common.h"
+#include "glyphs/device/PixelStats.h"
+// std
+#include <vector>
+
+namespace glyphs {
+  namespace cpu {
+
+    /*! host-side ray; has the same members the intersectors in
+        device/roundedCone.h expect from an owl::Ray */
+    struct Ray {
+      Ray() = default;
+      Ray(const vec3f &origin, const vec3f &direction, float tmin, float tmax)
+        : origin(origin), direction(direction), tmin(tmin), tmax(tmax)
+      {}
+
+      vec3f origin;
+      vec3f direction;
+      float tmin { 0.f };
+      float tmax { 1e8f };
+    };
+
+    /*! simple binned-SAH BVH over a list of primitive bounding boxes;
+        the BVH only knows about boxes, intersecting the actual
+        primitives is done by the lambda passed to traverse() */
+    struct BVH {
+      struct Node {
+        box3f bounds;
+        /*! for inner nodes: index of the first of the two (adjacent)
+            children; for leaves: offset into primIDs */
+        int   offset;
+        /*! num prims in this leaf; 0 means 'inner node' */
+        int   count;
+      };
+
+      /*! build over given prim bounds; previous content gets discarded */
+      void build(const std::vector<box3f> &primBounds,
+                 int maxLeafSize = 4);
+
+      /*! recompute all node bounds bottom-up for moved prims, keeping
+          the topology; primBounds must have the same size as in
+          build() */
+      void refit(const std::vector<box3f> &primBounds);
+
+      /*! SAH cost of the current tree, relative to its root's
+          surface area; comparing this after refit() against the
+          value right after build() tells how much the tree degraded */
+      float sahCost() const;
+
+      /*! traverse the BVH front-to-back, calling
+          'intersectPrim(primID,ray)' for every leaf primitive whose
+          leaf the ray overlaps. The lambda may shorten ray.tmax to
+          cull subsequent nodes, and returns true if traversal should
+          terminate (eg, for occlusion rays). With GLYPHS_STATS, adds
+          the number of nodes visited to 'numNodes', if given */
+      template<typename IntersectPrim>
+      inline void traverse(Ray &ray, const IntersectPrim &intersectPrim,
+                           uint32_t *numNodes = nullptr) const;
+
+      /*! build() makes leaves at this depth whatever their size, so
+          that traverse()'s stack of this many entries can't overflow */
+      static const int maxDepth = 64;
+
+      std::vector<Node> nodes;
+      std::vector<int>  primIDs;
+    };
+
+    /*! slab test; returns entry distance, or infinity if missed */
+    inline float intersectBox(const box3f &box,
+                              const vec3f &org,
+                              const vec3f &rcpDir,
+                              float tmin, float tmax)
+    {
+      const vec3f t_lo = (box.lower - org) * rcpDir;
+      const vec3f t_hi = (box.upper - org) * rcpDir;
+      const vec3f t_nr = min(t_lo,t_hi);
+      const vec3f t_fr = max(t_lo,t_hi);
+      const float t0 = max(tmin,max(t_nr.x,max(t_nr.y,t_nr.z)));
+      const float t1 = min(tmax,min(t_fr.x,min(t_fr.y,t_fr.z)));
+      return t0 <= t1 ? t0 : std::numeric_limits<float>::infinity();
+    }
+
+    inline vec3f safeRcp(const vec3f &dir)
+    {
+      return vec3f(dir.x == 0.f ? 1e20f : 1.f/dir.x,
+                   dir.y == 0.f ? 1e20f : 1.f/dir.y,
+                   dir.z == 0.f ? 1e20f : 1.f/dir.z);
+    }
+
+    template<typename IntersectPrim>
+    inline void BVH::traverse(Ray &ray, const IntersectPrim &intersectPrim,
+                              uint32_t *numNodes) const
+    {
+      // only counted with GLYPHS_STATS; [[maybe_unused]] is C++17
+      (void)numNodes;
+      if (nodes.empty()) return;
+
+      const vec3f rcpDir = safeRcp(ray.direction);
+      const float inf = std::numeric_limits<float>::infinity();
+
+      struct StackEntry { int nodeID; float t; };
+      StackEntry stack[maxDepth];
+      int stackPtr = 0;
+
+      if (intersectBox(nodes[0].bounds,ray.origin,rcpDir,ray.tmin,ray.tmax) == inf)
+        return;
+      stack[stackPtr++] = { 0, ray.tmin };
+
+      while (stackPtr > 0) {
+        const StackEntry entry = stack[--stackPtr];
+        if (entry.t > ray.tmax) continue;
+
+        int nodeID = entry.nodeID;
+        while (nodes[nodeID].count == 0) {
+          GLYPHS_STAT(if (numNodes) ++*numNodes);
+          const int c0 = nodes[nodeID].offset;
+          const int c1 = c0+1;
+          const float t0 = intersectBox(nodes[c0].bounds,ray.origin,rcpDir,ray.tmin,ray.tmax);
+          const float t1 = intersectBox(nodes[c1].bounds,ray.origin,rcpDir,ray.tmin,ray.tmax);
+          if (t0 == inf && t1 == inf) { nodeID = -1; break; }
+          if (t0 == inf) { nodeID = c1; continue; }
+          if (t1 == inf) { nodeID = c0; continue; }
+          if (t0 < t1) {
+            stack[stackPtr++] = { c1, t1 };
+            nodeID = c0;
+          } else {
+            stack[stackPtr++] = { c0, t0 };
+            nodeID = c1;
+          }
+        }
+        if (nodeID < 0) continue;
+
+        const Node &leaf = nodes[nodeID];
+        GLYPHS_STAT(if (numNodes) ++*numNodes);
+        for (int i=0;i<leaf.count;i++)
+          if (intersectPrim(primIDs[leaf.offset+i],ray))
+            return;
+      }
+    }
+
+  }
+}
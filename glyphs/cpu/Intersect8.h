@@ -0,0 +1,212 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/cpu/BVH.h"
+#include "glyphs/cpu/SIMD.h"
+
+namespace glyphs {
+  namespace cpu {
+
+    /*! one ray against 8 primitives at a time, with the prims stored
+        SoA. These follow the scalar intersectors in
+        device/roundedCone.h operation by operation (so they agree up
+        to rounding), except that they all report hits only in
+        (ray.tmin,ray.tmax). Each returns the mask of lanes that got
+        hit, and writes the hit distance into those lanes of 't';
+        normals are left to the caller, who only needs it for the
+        closest lane - see closestLane() */
+
+    // note: the packs are not alignas(32) since std::vector doesn't
+    // honor that before c++17; vfloat8::load() is unaligned
+
+    /*! SoA pack of 8 spheres; unused lanes should get radius 0 */
+    struct Spheres8 {
+      void set(int lane, const vec3f &c, float r)
+      { cx[lane] = c.x; cy[lane] = c.y; cz[lane] = c.z; this->r[lane] = r; }
+
+      float cx[8], cy[8], cz[8], r[8];
+    };
+
+    /*! SoA pack of 8 capped cylinders; unused lanes should get
+        radius 0 */
+    struct Cylinders8 {
+      void set(int lane, const vec3f &a, const vec3f &b, float r)
+      {
+        ax[lane] = a.x; ay[lane] = a.y; az[lane] = a.z;
+        bx[lane] = b.x; by[lane] = b.y; bz[lane] = b.z;
+        this->r[lane] = r;
+      }
+
+      float ax[8], ay[8], az[8], bx[8], by[8], bz[8], r[8];
+    };
+
+    /*! SoA pack of 8 rounded cones; unused lanes should get radius 0 */
+    struct RoundedCones8 {
+      void set(int lane, const vec3f &a, const vec3f &b, float ra, float rb)
+      {
+        ax[lane] = a.x; ay[lane] = a.y; az[lane] = a.z;
+        bx[lane] = b.x; by[lane] = b.y; bz[lane] = b.z;
+        this->ra[lane] = ra; this->rb[lane] = rb;
+      }
+
+      float ax[8], ay[8], az[8], bx[8], by[8], bz[8], ra[8], rb[8];
+    };
+
+    /*! 8-wide intersectSphere2() */
+    inline vbool8 intersectSpheres8(const Spheres8 &prims,
+                                    const Ray &ray,
+                                    vfloat8 &t)
+    {
+      const vec3f8  pa(vfloat8::load(prims.cx),vfloat8::load(prims.cy),vfloat8::load(prims.cz));
+      const vfloat8 ra = vfloat8::load(prims.r);
+      const vec3f8  dir(ray.direction);
+      const vfloat8 tmin(ray.tmin), tmax(ray.tmax);
+
+      // start close to the sphere, for precision
+      const vfloat8 minDist = max(vfloat8(0.f),length(pa-vec3f8(ray.origin))-ra);
+      const vec3f8  org = vec3f8(ray.origin) + minDist*dir;
+
+      const vec3f8  oc = org - pa;
+      const vfloat8 a  = dot(dir,dir);
+      const vfloat8 b  = dot(oc,dir);
+      const vfloat8 c  = dot(oc,oc) - ra*ra;
+      const vfloat8 discriminant = b*b - a*c;
+      const vbool8  valid = discriminant >= vfloat8(0.f);
+      const vfloat8 sq = sqrt(max(discriminant,vfloat8(0.f)));
+
+      const vfloat8 t0 = (-b - sq) / a + minDist;
+      const vfloat8 t1 = (-b + sq) / a + minDist;
+      const vbool8  hit0 = valid & (t0 < tmax) & (t0 > tmin);
+      const vbool8  hit1 = valid & (!hit0) & (t1 < tmax) & (t1 > tmin);
+      const vbool8  hit  = hit0 | hit1;
+      t = select(hit, select(hit0,t0,t1), t);
+      return hit;
+    }
+
+    /*! 8-wide intersectCylinder() */
+    inline vbool8 intersectCylinders8(const Cylinders8 &prims,
+                                      const Ray &ray,
+                                      vfloat8 &t)
+    {
+      const vec3f8  pa(vfloat8::load(prims.ax),vfloat8::load(prims.ay),vfloat8::load(prims.az));
+      const vec3f8  pb(vfloat8::load(prims.bx),vfloat8::load(prims.by),vfloat8::load(prims.bz));
+      const vfloat8 ra = vfloat8::load(prims.r);
+      const vec3f8  dir(ray.direction);
+      const vfloat8 tmin(ray.tmin), tmax(ray.tmax);
+
+      const vec3f8  ba = pb - pa;
+      const vec3f8  oc = vec3f8(ray.origin) - pa;
+
+      const vfloat8 baba = dot(ba,ba);
+      const vfloat8 bard = dot(ba,dir);
+      const vfloat8 baoc = dot(ba,oc);
+
+      const vfloat8 k2 = baba               - bard*bard;
+      const vfloat8 k1 = baba*dot(oc,dir)   - baoc*bard;
+      const vfloat8 k0 = baba*dot(oc,oc)    - baoc*baoc - ra*ra*baba;
+
+      const vfloat8 h2 = k1*k1 - k2*k0;
+      const vbool8  valid = h2 >= vfloat8(0.f);
+      const vfloat8 h = sqrt(max(h2,vfloat8(0.f)));
+
+      // body
+      const vfloat8 tBody = (-k1-h)/k2;
+      const vfloat8 y = baoc + tBody*bard;
+      const vbool8  body
+        = valid & (y > vfloat8(0.f)) & (baba > y) & (tBody > tmin) & (tmax > tBody);
+
+      // caps
+      const vfloat8 tCap = (select(vfloat8(0.f) > y,vfloat8(0.f),baba) - baoc)/bard;
+      const vbool8  cap
+        = valid & (!body) & (h > abs(k1+k2*tCap)) & (tCap > tmin) & (tmax > tCap);
+
+      const vbool8 hit = body | cap;
+      t = select(hit, select(body,tBody,tCap), t);
+      return hit;
+    }
+
+    /*! 8-wide intersectRoundedCone() */
+    inline vbool8 intersectRoundedCones8(const RoundedCones8 &prims,
+                                         const Ray &ray,
+                                         vfloat8 &t)
+    {
+      const vec3f8  pa(vfloat8::load(prims.ax),vfloat8::load(prims.ay),vfloat8::load(prims.az));
+      const vec3f8  pb(vfloat8::load(prims.bx),vfloat8::load(prims.by),vfloat8::load(prims.bz));
+      const vfloat8 ra = vfloat8::load(prims.ra);
+      const vfloat8 rb = vfloat8::load(prims.rb);
+      const vec3f8  ro(ray.origin);
+      const vec3f8  rd(ray.direction);
+      const vfloat8 tmin(ray.tmin), tmax(ray.tmax);
+      const vfloat8 zero(0.f);
+
+      const vec3f8  ba = pb - pa;
+      const vec3f8  oa = ro - pa;
+      const vec3f8  ob = ro - pb;
+      const vfloat8 rr = ra - rb;
+      const vfloat8 m0 = dot(ba, ba);
+      const vfloat8 m1 = dot(ba, oa);
+      const vfloat8 m2 = dot(ba, rd);
+      const vfloat8 m3 = dot(rd, oa);
+      const vfloat8 m5 = dot(oa, oa);
+      const vfloat8 m6 = dot(ob, rd);
+      const vfloat8 m7 = dot(ob, ob);
+
+      const vfloat8 d2 = m0 - rr * rr;
+
+      const vfloat8 k2 = d2 - m2 * m2;
+      const vfloat8 k1 = d2 * m3 - m1 * m2 + m2 * rr * ra;
+      const vfloat8 k0 = d2 * m5 - m1 * m1 + m1 * rr * ra * vfloat8(2.f) - m0 * ra * ra;
+
+      // body
+      const vfloat8 h = k1 * k1 - k0 * k2;
+      const vfloat8 tBody = (-sqrt(max(h,zero)) - k1) / k2;
+      const vfloat8 y = m1 - ra * rr + tBody * m2;
+      const vbool8  body
+        = (h >= zero) & (y > zero) & (d2 > y) & (tBody > tmin) & (tmax > tBody);
+
+      // caps; the closer of the two
+      const vfloat8 h1 = m3 * m3 - m5 + ra * ra;
+      const vfloat8 tA = -m3 - sqrt(max(h1,zero));
+      const vbool8  capA = (h1 > zero) & (tA > tmin);
+      const vfloat8 h2 = m6 * m6 - m7 + rb * rb;
+      const vfloat8 tB = -m6 - sqrt(max(h2,zero));
+      const vbool8  capB = (h2 > zero) & (tB > tmin) & ((!capA) | (tA > tB));
+      const vfloat8 tCap = select(capB,tB,tA);
+      const vbool8  cap  = (!body) & (capA | capB) & (tmax > tCap);
+
+      const vbool8 hit = body | cap;
+      t = select(hit, select(body,tBody,tCap), t);
+      return hit;
+    }
+
+    /*! lane with the smallest t among those set in 'hit', or -1 */
+    inline int closestLane(vbool8 hit, const vfloat8 &t)
+    {
+      int mask = movemask(hit);
+      if (!mask) return -1;
+      alignas(32) float tt[8];
+      t.store(tt);
+      int best = -1;
+      for (int lane=0;lane<8;lane++)
+        if (((mask >> lane) & 1) && (best < 0 || tt[lane] < tt[best]))
+          best = lane;
+      return best;
+    }
+
+  }
+}
@@ -0,0 +1,731 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "glyphs/cpu/PathTracer.h"
+#include <owl/common/parallel/parallel_for.h>
+#include <atomic>
+#include <mutex>
+
+#ifndef M_PIF
+#define M_PIF 3.14159265358979323846f
+#endif
+
+namespace glyphs {
+  namespace cpu {
+
+    // ------------------------------------------------------------------
+    // helpers shared by both variants; these mirror the respective
+    // code in device/common.cu and device/Camera.h
+    // ------------------------------------------------------------------
+
+    inline uint32_t make_8bit(const float f)
+    {
+      return min(255,max(0,int(f*256.f)));
+    }
+
+    inline uint32_t make_rgba8(const vec4f color)
+    {
+      return
+        (make_8bit(color.x) << 0) +
+        (make_8bit(color.y) << 8) +
+        (make_8bit(color.z) << 16);
+    }
+
+    inline Ray generateRay(const FrameState &fs, const vec2f &pixelSample)
+    {
+      const vec3f direction
+        = fs.camera_screen_00
+        + pixelSample.x * fs.camera_screen_du
+        + pixelSample.y * fs.camera_screen_dv;
+      return Ray(fs.camera_lens_center,normalize(direction),1e-6f,1e8f);
+    }
+
+    /*! background for primary rays */
+    inline vec3f missColor(int pixelY, int fbHeight)
+    {
+      const float t = pixelY / (float)fbHeight;
+      return (1.0f - t)*vec3f(1.0f, 1.0f, 1.0f) + t * vec3f(0.5f, 0.7f, 1.0f);
+    }
+
+    inline vec3f linkColor(const Glyphs &glyphs, int linkID)
+    {
+      unsigned rgba = glyphs.links[linkID].col; // ignore alpha for now
+      return vec3f((rgba & 0xff) / 255.f,
+                   ((rgba >> 8) & 0xff) / 255.f,
+                   ((rgba >> 16) & 0xff) / 255.f);
+    }
+
+    /*! shading for pathDepth <= 1 */
+    inline vec3f localShading(const Glyphs &glyphs, const Hit &hit, const vec3f &dir)
+    {
+      vec3f N = normalize(hit.Ng);
+      const vec3f albedo
+        = (hit.meshID == 0)
+        ? vec3f(.8f)
+        : linkColor(glyphs,hit.primID);
+      return albedo * (.2f+.6f*fabsf(dot(N,dir)));
+    }
+
+    /*! the preview shade modes, for a primary ray that hit; mirrors
+        previewShade() in device/common.cu */
+    inline vec3f previewShade(const Scene &scene,
+                              const FrameState &fs,
+                              const Hit &hit,
+                              const vec3f &org,
+                              const vec3f &dir,
+                              Random &rnd,
+                              device::RayStats &rayStats,
+                              device::PixelStats *stats)
+    {
+      vec3f N = normalize(hit.Ng);
+      if (dot(N,dir) > 0.f)
+        N = -N;
+
+      if (fs.shadeMode == device::SHADE_NORMALS)
+        return device::normalColor(N);
+      if (fs.shadeMode == device::SHADE_DEPTH)
+        return device::depthColor(hit.t,fs.depthScale);
+
+      const vec3f albedo
+        = (hit.meshID >= 0)
+        ? vec3f(.8f)
+        : linkColor(*scene.glyphs,hit.primID);
+      int numOccluded = 0;
+      for (int i=0;i<fs.aoSamples;i++) {
+        const int dim = device::DIM_BOUNCE+i*device::DIMS_PER_BOUNCE+device::BOUNCE_DIM_DIRECTION;
+        const vec3f w = device::cosineSampleHemisphere(N,rnd.get2D(dim));
+        rayStats.shadow++;
+        if (scene.occluded(Ray(org,w,1e-3f,fs.aoRadius),rnd,stats))
+          numOccluded++;
+      }
+      return device::aoColor(albedo,numOccluded,fs.aoSamples);
+    }
+
+    /*! samples a lambertian bounce; returns the albedo, which for
+        cosine-weighted sampling is exactly the path weight */
+    inline vec3f sampleBounce(const Glyphs &glyphs,
+                              const Hit &hit,
+                              const vec3f &dir,
+                              Random &rnd,
+                              vec3f &scattered_direction,
+                              float &pdf)
+    {
+      vec3f N = normalize(hit.Ng);
+      if (dot(N,dir) > 0.f)
+        N = -N;
+
+      const vec3f albedo
+        = (hit.meshID >= 0)
+        ? vec3f(.8f)
+        : linkColor(glyphs,hit.primID);
+
+      const vec3f v_x = normalize(fabsf(N.x) < .6f
+                                  ? cross(vec3f(1.f,0.f,0.f),N)
+                                  : cross(vec3f(0.f,1.f,0.f),N));
+      const vec3f v_y = cross(N,v_x);
+      const float r   = sqrtf(rnd());
+      const float phi = 2.f*M_PIF*rnd();
+      const float x = r*cosf(phi), y = r*sinf(phi);
+      scattered_direction = normalize(x*v_x + y*v_y + sqrtf(max(0.f,1.f-x*x-y*y))*N);
+      pdf = max(0.f,dot(scattered_direction,N)) / M_PIF;
+      return albedo;
+    }
+
+    /*! next event estimation: a shadow ray towards the sun from a
+        lambertian surface. Returns the radiance that adds (before
+        path attenuation); counts the shadow ray in 'rayStats' (and
+        its traversal in 'stats') */
+    inline vec3f sampleSun(const Scene &scene,
+                           const FrameState &fs,
+                           const Hit &hit,
+                           const vec3f &org,
+                           const vec3f &dir,
+                           Random &rnd,
+                           int depth,
+                           device::RayStats &rayStats,
+                           device::PixelStats *stats)
+    {
+      vec3f N = normalize(hit.Ng);
+      if (dot(N,dir) > 0.f)
+        N = -N;
+      const int bounceDim = device::DIM_BOUNCE+depth*device::DIMS_PER_BOUNCE;
+      const vec3f w_l = device::Sun::sample(rnd.get2D(bounceDim+device::BOUNCE_DIM_LIGHT));
+      const float cosTheta = dot(w_l,N);
+      if (cosTheta <= 0.f)
+        return vec3f(0.f);
+
+      rayStats.shadow++;
+      if (scene.occluded(Ray(org,w_l,1e-3f,1e8f),rnd,stats))
+        return vec3f(0.f);
+
+      const vec3f albedo
+        = (hit.meshID >= 0)
+        ? vec3f(.8f)
+        : linkColor(*scene.glyphs,hit.primID);
+      const float w = device::sunLightWeight(fs.sunSampling,cosTheta/M_PIF);
+      return albedo * (cosTheta / M_PIF) * device::Sun::radiance() * (w / device::Sun::pdf());
+    }
+
+    /*! how many samples raygen_program() would take for this pixel */
+    inline int pixelSampleCount(const FrameState &fs,
+                                int pixelIdx,
+                                const vec4f *accumBuffer,
+                                const float *varianceBuffer)
+    {
+      if (fs.accumID == 0)
+        return fs.samplesPerPixel;
+      return device::adaptiveSampleCount(fs,pixelIdx,accumBuffer[pixelIdx],varianceBuffer[pixelIdx]);
+    }
+
+    /*! adds this frame's samples (sum and count in 'col', squared
+        luminances in 'lumSqSum') to the pixel's running sums, writes
+        its display color, and returns its relative error */
+    inline float accumulatePixel(const FrameState &fs,
+                                 int pixelIdx,
+                                 vec4f col,
+                                 float lumSqSum,
+                                 vec4f *accumBuffer,
+                                 float *varianceBuffer,
+                                 uint32_t *colorBuffer)
+    {
+      if (fs.accumID > 0) {
+        col      = col + accumBuffer[pixelIdx];
+        lumSqSum = lumSqSum + varianceBuffer[pixelIdx];
+      }
+      accumBuffer[pixelIdx]    = col;
+      varianceBuffer[pixelIdx] = lumSqSum;
+      colorBuffer[pixelIdx]    = make_rgba8(col / max(col.w,1.f));
+      return device::relativeError(col,lumSqSum);
+    }
+
+    inline device::ErrorStats errorStatsOf(const std::vector<float> &rowError,
+                                           const std::vector<float> &rowSamples,
+                                           const vec2i &fbSize)
+    {
+      double sumError = 0., numSamples = 0.;
+      for (size_t y=0;y<rowError.size();y++) {
+        sumError   += rowError[y];
+        numSamples += rowSamples[y];
+      }
+      const double numPixels = max(1.,double(fbSize.x)*fbSize.y);
+      device::ErrorStats stats;
+      stats.meanRelativeError = float(sumError / numPixels);
+      stats.samplesPerPixel   = float(numSamples / numPixels);
+      return stats;
+    }
+
+    // ------------------------------------------------------------------
+    // megakernel
+    // ------------------------------------------------------------------
+
+    inline vec3f pathTrace(const Scene &scene,
+                           const FrameState &fs,
+                           Ray ray,
+                           Random &rnd,
+                           int pixelY,
+                           int fbHeight,
+                           device::RayStats &rayStats,
+                           device::PixelStats *stats = nullptr)
+    {
+      const Glyphs &glyphs = *scene.glyphs;
+      vec3f attenuation = 1.f;
+      vec3f L = 0.f;
+      float bsdfPdf = 0.f;
+      Hit hit;
+
+      if (fs.shadeMode != device::SHADE_PATH) {
+        rayStats.primary++;
+        if (!scene.intersect(ray,hit,rnd,stats))
+          return missColor(pixelY,fbHeight);
+        return previewShade(scene,fs,hit,ray.origin + hit.t * ray.direction,
+                            ray.direction,rnd,rayStats,stats);
+      }
+
+      if (fs.pathDepth <= 1) {
+        rayStats.primary++;
+        if (!scene.intersect(ray,hit,rnd,stats))
+          return missColor(pixelY,fbHeight);
+        return localShading(glyphs,hit,ray.direction);
+      }
+
+      for (int depth=0;true;depth++) {
+        if (depth == 0) rayStats.primary++; else rayStats.bounce++;
+        hit = Hit();
+        if (!scene.intersect(ray,hit,rnd,stats)) {
+          if (depth == 0)
+            return missColor(pixelY,fbHeight);
+          return L + attenuation * device::escapedRadiance(fs.sunSampling,ray.direction,bsdfPdf);
+        }
+
+        const vec3f scattered_origin = ray.origin + hit.t * ray.direction;
+        if (depth < fs.pathDepth && fs.sunSampling != device::SUN_SAMPLING_BSDF)
+          L += attenuation * sampleSun(scene,fs,hit,scattered_origin,ray.direction,
+                                       rnd,depth,rayStats,stats);
+
+        vec3f scattered_direction;
+        rnd.startDimension(device::DIM_BOUNCE+depth*device::DIMS_PER_BOUNCE);
+        const vec3f albedo = sampleBounce(glyphs,hit,ray.direction,rnd,
+                                          scattered_direction,bsdfPdf);
+        if (depth >= fs.pathDepth)
+          return L;
+
+        ray = Ray(scattered_origin,scattered_direction,1e-3f,1e8f);
+        attenuation *= albedo;
+        if (!device::russianRoulette(fs.rouletteDepth,depth,rnd,attenuation)) {
+          rayStats.roulette++;
+          return L;
+        }
+      }
+    }
+
+    float PathTracer::startHistory(const FrameState &fs,
+                                   const vec2i &fbSize,
+                                   const vec4f *prevAccumBuffer,
+                                   const float *prevVarianceBuffer,
+                                   const device::Surface *prevSurfaces,
+                                   vec4f *accumBuffer,
+                                   float *varianceBuffer,
+                                   device::Surface *surfaces)
+    {
+      std::atomic<int> numReprojected { 0 };
+      parallel_for(fbSize.y,[&](int y) {
+          int rowReprojected = 0;
+          for (int x=0;x<fbSize.x;x++) {
+            const int pixelIdx = x+fbSize.x*y;
+            Random rnd(fs.samplerType,pixelIdx,0,fs.seed);
+            Ray ray = generateRay(fs,vec2f(vec2i(x,y))+vec2f(.5f));
+            Hit hit;
+            scene->intersect(ray,hit,rnd);
+
+            device::Surface surface;
+            surface.t      = hit.t;
+            surface.primID = hit.primID;
+            surface.meshID = hit.meshID;
+            surfaces[pixelIdx] = surface;
+
+            vec4f accum(0.f);
+            float lumSqSum = 0.f;
+            const int prevIdx
+              = fs.reproject
+              ? device::reprojectedPixel(fs,fbSize,surface,
+                                         ray.origin + hit.t * ray.direction,
+                                         prevSurfaces)
+              : -1;
+            if (prevIdx >= 0) {
+              accum    = prevAccumBuffer[prevIdx];
+              lumSqSum = prevVarianceBuffer[prevIdx];
+              device::capHistory(accum,lumSqSum,fs.reprojectMaxSamples);
+              rowReprojected++;
+            }
+            accumBuffer[pixelIdx]    = accum;
+            varianceBuffer[pixelIdx] = lumSqSum;
+          }
+          numReprojected += rowReprojected;
+        });
+      return numReprojected / max(1.f,float(fbSize.x)*fbSize.y);
+    }
+
+    void PathTracer::renderMotionFrame(const FrameState &fs,
+                                       const vec2i &fbSize,
+                                       uint32_t *colorBuffer)
+    {
+      const int   scale      = fs.motionScale;
+      const vec2i launchDims = device::motionLaunchDims(fbSize,scale);
+      std::mutex statsMutex;
+      device::RayStats totalStats;
+      parallel_for(launchDims.y,[&](int by) {
+          device::RayStats rowStats;
+          for (int bx=0;bx<launchDims.x;bx++) {
+            const vec2i pixel0 = vec2i(bx,by)*scale;
+            Random rnd(fs.samplerType,pixel0.x+fbSize.x*pixel0.y,0,fs.seed);
+            const vec2f pixelSample = vec2f(pixel0) + vec2f(.5f*scale);
+            const Ray ray = generateRay(fs,pixelSample);
+            const vec3f sample = pathTrace(*scene,fs,ray,rnd,by,launchDims.y,rowStats);
+            const uint32_t rgba = make_rgba8(vec4f(sample,1.f));
+            const int endX = min(pixel0.x+scale,fbSize.x);
+            const int endY = min(pixel0.y+scale,fbSize.y);
+            for (int y=pixel0.y;y<endY;y++)
+              for (int x=pixel0.x;x<endX;x++)
+                colorBuffer[x+fbSize.x*y] = rgba;
+          }
+          std::lock_guard<std::mutex> lock(statsMutex);
+          totalStats += rowStats;
+        });
+      this->rayStats = totalStats;
+      this->errorStats = device::ErrorStats();
+    }
+
+    void MegakernelPathTracer::render(const FrameState &fs,
+                                      const vec2i &fbSize,
+                                      vec4f *accumBuffer,
+                                      float *varianceBuffer,
+                                      uint32_t *colorBuffer)
+    {
+      if (fs.motionScale > 0) {
+        renderMotionFrame(fs,fbSize,colorBuffer);
+        return;
+      }
+      std::mutex statsMutex;
+      device::RayStats totalStats;
+      std::vector<float> rowError(fbSize.y), rowSamples(fbSize.y);
+      GLYPHS_STAT(pixelStats.assign(size_t(fbSize.x)*fbSize.y,device::PixelStats()));
+      parallel_for(fbSize.y,[&](int y) {
+          device::RayStats rowStats;
+          float  sumError = 0.f;
+          int    numSamples = 0;
+          for (int x=0;x<fbSize.x;x++) {
+            const int pixelIdx = x+fbSize.x*y;
+            const int spp = pixelSampleCount(fs,pixelIdx,accumBuffer,varianceBuffer);
+            const uint32_t firstSample
+              = fs.accumID > 0 ? uint32_t(accumBuffer[pixelIdx].w) : 0;
+            vec4f col(0.f);
+            float lumSqSum = 0.f;
+            device::PixelStats *stats = GLYPHS_STATS ? &pixelStats[pixelIdx] : nullptr;
+            GLYPHS_STAT(const device::RayStats raysBefore = rowStats);
+            for (int s=0;s<spp;s++) {
+              Random rnd(fs.samplerType,pixelIdx,firstSample+s,fs.seed);
+              const vec2f pixelSample = vec2f(vec2i(x,y)) + rnd.get2D(device::DIM_PIXEL);
+              const Ray ray = generateRay(fs,pixelSample);
+              const vec3f sample = pathTrace(*scene,fs,ray,rnd,y,fbSize.y,rowStats,stats);
+              col += vec4f(sample,1.f);
+              lumSqSum += device::luminance(sample)*device::luminance(sample);
+            }
+#if GLYPHS_STATS
+            stats->counter[device::COUNT_PRIMARY] = uint32_t(rowStats.primary-raysBefore.primary);
+            stats->counter[device::COUNT_BOUNCE]  = uint32_t(rowStats.bounce -raysBefore.bounce);
+            stats->counter[device::COUNT_SHADOW]  = uint32_t(rowStats.shadow -raysBefore.shadow);
+#endif
+            sumError += accumulatePixel(fs,pixelIdx,col,lumSqSum,
+                                        accumBuffer,varianceBuffer,colorBuffer);
+            numSamples += spp;
+          }
+          rowError[y]   = sumError;
+          rowSamples[y] = float(numSamples);
+          std::lock_guard<std::mutex> lock(statsMutex);
+          totalStats += rowStats;
+        });
+      this->rayStats = totalStats;
+      this->errorStats = errorStatsOf(rowError,rowSamples,fbSize);
+    }
+
+    // ------------------------------------------------------------------
+    // wavefront
+    // ------------------------------------------------------------------
+
+    enum { WAVEFRONT_BLOCK_SIZE = 1024 };
+
+    void WavefrontPathTracer::RayQueue::resize(size_t n)
+    {
+      org_x.resize(n); org_y.resize(n); org_z.resize(n);
+      dir_x.resize(n); dir_y.resize(n); dir_z.resize(n);
+      weight_r.resize(n); weight_g.resize(n); weight_b.resize(n);
+      pdf.resize(n);
+      pathID.resize(n);
+      rnd.resize(n);
+    }
+
+    void WavefrontPathTracer::HitQueue::resize(size_t n)
+    {
+      t.resize(n);
+      primID.resize(n); meshID.resize(n);
+      Ng_x.resize(n); Ng_y.resize(n); Ng_z.resize(n);
+    }
+
+    /*! stage 1: one ray per pixel sample */
+    void WavefrontPathTracer::generate(const FrameState &fs, const vec2i &fbSize,
+                                       const vec4f *accumBuffer,
+                                       const float *varianceBuffer)
+    {
+      const size_t numPixels = size_t(fbSize.x)*fbSize.y;
+      pixelPaths.resize(numPixels+1);
+      pixelPaths[0] = 0;
+      parallel_for_blocked(size_t(0),numPixels,size_t(WAVEFRONT_BLOCK_SIZE),
+                           [&](size_t begin, size_t end) {
+          for (size_t i=begin;i<end;i++)
+            pixelPaths[i+1] = pixelSampleCount(fs,int(i),accumBuffer,varianceBuffer);
+        });
+      for (size_t i=0;i<numPixels;i++)
+        pixelPaths[i+1] += pixelPaths[i];
+
+      const size_t numPaths = pixelPaths[numPixels];
+      current.resize(numPaths);
+      pathPixel.resize(numPaths);
+      pathRadiance.assign(numPaths,vec3f(0.f));
+
+      parallel_for_blocked(size_t(0),numPixels,size_t(WAVEFRONT_BLOCK_SIZE),
+                           [&](size_t begin, size_t end) {
+          for (size_t pixelIdx=begin;pixelIdx<end;pixelIdx++) {
+            const vec2i pixelID(int(pixelIdx % fbSize.x), int(pixelIdx / fbSize.x));
+            const uint32_t firstSample
+              = fs.accumID > 0 ? uint32_t(accumBuffer[pixelIdx].w) : 0;
+            for (size_t i=pixelPaths[pixelIdx];i<pixelPaths[pixelIdx+1];i++) {
+              const int s = int(i-pixelPaths[pixelIdx]);
+              Random rnd(fs.samplerType,uint32_t(pixelIdx),firstSample+s,fs.seed);
+              const vec2f pixelSample = vec2f(pixelID) + rnd.get2D(device::DIM_PIXEL);
+              const Ray ray = generateRay(fs,pixelSample);
+              current.org_x[i] = ray.origin.x;
+              current.org_y[i] = ray.origin.y;
+              current.org_z[i] = ray.origin.z;
+              current.dir_x[i] = ray.direction.x;
+              current.dir_y[i] = ray.direction.y;
+              current.dir_z[i] = ray.direction.z;
+              current.weight_r[i] = current.weight_g[i] = current.weight_b[i] = 1.f;
+              current.pdf[i] = 0.f;
+              current.pathID[i] = (int)i;
+              current.rnd[i] = rnd;
+              pathPixel[i] = int(pixelIdx);
+            }
+          }
+        });
+    }
+
+    /*! stage 2: trace all queued rays */
+    void WavefrontPathTracer::extend(int depth)
+    {
+      /* same tmin as generateRay() and pathTrace() use, respectively */
+      const float tmin = (depth == 0) ? 1e-6f : 1e-3f;
+      const size_t numRays = current.size();
+      hits.resize(numRays);
+      parallel_for_blocked(size_t(0),numRays,size_t(WAVEFRONT_BLOCK_SIZE),
+                           [&](size_t begin, size_t end) {
+          for (size_t i=begin;i<end;i++) {
+            Ray ray(vec3f(current.org_x[i],current.org_y[i],current.org_z[i]),
+                    vec3f(current.dir_x[i],current.dir_y[i],current.dir_z[i]),
+                    tmin,1e8f);
+            Hit hit;
+            scene->intersect(ray,hit,current.rnd[i]);
+            hits.t[i]      = hit.t;
+            hits.primID[i] = hit.primID;
+            hits.meshID[i] = hit.meshID;
+            hits.Ng_x[i]   = hit.Ng.x;
+            hits.Ng_y[i]   = hit.Ng.y;
+            hits.Ng_z[i]   = hit.Ng.z;
+          }
+        });
+    }
+
+    /*! stage 3: terminate paths that left the scene (adding their
+        radiance), and write bounce rays for all others into 'next' */
+    void WavefrontPathTracer::shade(const FrameState &fs, const vec2i &fbSize, int depth)
+    {
+      const Glyphs &glyphs = *scene->glyphs;
+      const size_t numRays = current.size();
+      next.resize(numRays);
+      alive.assign(numRays,0);
+
+      std::atomic<size_t> totalShadowRays { 0 }, totalRoulette { 0 };
+      parallel_for_blocked(size_t(0),numRays,size_t(WAVEFRONT_BLOCK_SIZE),
+                           [&](size_t begin, size_t end) {
+          device::RayStats blockStats;
+          for (size_t i=begin;i<end;i++) {
+            const int pathID = current.pathID[i];
+            const vec3f dir(current.dir_x[i],current.dir_y[i],current.dir_z[i]);
+            const vec3f weight(current.weight_r[i],current.weight_g[i],current.weight_b[i]);
+
+            Hit hit;
+            hit.primID = hits.primID[i];
+            hit.meshID = hits.meshID[i];
+            hit.t      = hits.t[i];
+            hit.Ng     = vec3f(hits.Ng_x[i],hits.Ng_y[i],hits.Ng_z[i]);
+
+            if (hit.primID < 0) {
+              const int pixelY = pathPixel[pathID] / fbSize.x;
+              pathRadiance[pathID]
+                += (depth == 0)
+                ? missColor(pixelY,fbSize.y)
+                : weight * device::escapedRadiance(fs.sunSampling,dir,current.pdf[i]);
+              continue;
+            }
+
+            if (fs.pathDepth <= 1 && fs.shadeMode == device::SHADE_PATH) {
+              pathRadiance[pathID] += localShading(glyphs,hit,dir);
+              continue;
+            }
+
+            const vec3f org
+              = vec3f(current.org_x[i],current.org_y[i],current.org_z[i])
+              + hit.t * dir;
+            Random rnd = current.rnd[i];
+            if (fs.shadeMode != device::SHADE_PATH) {
+              pathRadiance[pathID]
+                += previewShade(*scene,fs,hit,org,dir,rnd,blockStats,nullptr);
+              continue;
+            }
+            // shadow rays are traced right here rather than queued;
+            // there's at most one per path, and they need no shading
+            if (depth < fs.pathDepth && fs.sunSampling != device::SUN_SAMPLING_BSDF)
+              pathRadiance[pathID]
+                += weight * sampleSun(*scene,fs,hit,org,dir,rnd,depth,blockStats,nullptr);
+
+            rnd.startDimension(device::DIM_BOUNCE+depth*device::DIMS_PER_BOUNCE);
+            vec3f scattered_direction;
+            float pdf;
+            const vec3f albedo = sampleBounce(glyphs,hit,dir,rnd,scattered_direction,pdf);
+            if (depth >= fs.pathDepth)
+              continue;
+
+            vec3f newWeight = weight * albedo;
+            if (!device::russianRoulette(fs.rouletteDepth,depth,rnd,newWeight)) {
+              blockStats.roulette++;
+              continue;
+            }
+            next.org_x[i] = org.x;
+            next.org_y[i] = org.y;
+            next.org_z[i] = org.z;
+            next.dir_x[i] = scattered_direction.x;
+            next.dir_y[i] = scattered_direction.y;
+            next.dir_z[i] = scattered_direction.z;
+            next.weight_r[i] = newWeight.x;
+            next.weight_g[i] = newWeight.y;
+            next.weight_b[i] = newWeight.z;
+            next.pdf[i] = pdf;
+            next.pathID[i] = pathID;
+            next.rnd[i] = rnd;
+            alive[i] = 1;
+          }
+          totalShadowRays += blockStats.shadow;
+          totalRoulette   += blockStats.roulette;
+        });
+      rayStats.shadow   += totalShadowRays;
+      rayStats.roulette += totalRoulette;
+    }
+
+    inline uint32_t spreadBits4(uint32_t v)
+    {
+      // 4 bits -> every third bit
+      return (v & 1) | ((v & 2) << 2) | ((v & 4) << 4) | ((v & 8) << 6);
+    }
+
+    enum { NUM_SORT_BINS = 1<<15 };
+
+    /*! 15-bit sort key: 4-bit-per-axis morton code of the origin
+        within the scene bounds, plus the direction octant */
+    inline uint32_t sortKey(const box3f &bounds, const vec3f &org, const vec3f &dir)
+    {
+      const vec3f rel = (org - bounds.lower) / max(bounds.span(),vec3f(1e-20f));
+      const uint32_t cx = (uint32_t)clamp(int(rel.x*16.f),0,15);
+      const uint32_t cy = (uint32_t)clamp(int(rel.y*16.f),0,15);
+      const uint32_t cz = (uint32_t)clamp(int(rel.z*16.f),0,15);
+      const uint32_t cell = spreadBits4(cx) | (spreadBits4(cy) << 1) | (spreadBits4(cz) << 2);
+      const uint32_t octant
+        = (dir.x < 0.f ? 1 : 0)
+        | (dir.y < 0.f ? 2 : 0)
+        | (dir.z < 0.f ? 4 : 0);
+      return (cell << 3) | octant;
+    }
+
+    /*! drop dead paths from 'next' and (optionally) counting-sort the
+        survivors into 'current' */
+    void WavefrontPathTracer::compactAndSort()
+    {
+      const size_t numRays = next.size();
+      std::vector<uint32_t> order;
+      order.reserve(numRays);
+
+      if (sortRays) {
+        std::vector<uint32_t> keys(numRays);
+        std::vector<uint32_t> binBegin(NUM_SORT_BINS+1,0);
+        const box3f &bounds = scene->bounds;
+        for (size_t i=0;i<numRays;i++) {
+          if (!alive[i]) continue;
+          keys[i] = sortKey(bounds,
+                            vec3f(next.org_x[i],next.org_y[i],next.org_z[i]),
+                            vec3f(next.dir_x[i],next.dir_y[i],next.dir_z[i]));
+          binBegin[keys[i]+1]++;
+        }
+        for (int b=0;b<NUM_SORT_BINS;b++)
+          binBegin[b+1] += binBegin[b];
+        order.resize(binBegin[NUM_SORT_BINS]);
+        for (size_t i=0;i<numRays;i++)
+          if (alive[i])
+            order[binBegin[keys[i]]++] = (uint32_t)i;
+      } else {
+        for (size_t i=0;i<numRays;i++)
+          if (alive[i])
+            order.push_back((uint32_t)i);
+      }
+
+      current.resize(order.size());
+      parallel_for_blocked(size_t(0),order.size(),size_t(WAVEFRONT_BLOCK_SIZE),
+                           [&](size_t begin, size_t end) {
+          for (size_t i=begin;i<end;i++) {
+            const uint32_t j = order[i];
+            current.org_x[i] = next.org_x[j];
+            current.org_y[i] = next.org_y[j];
+            current.org_z[i] = next.org_z[j];
+            current.dir_x[i] = next.dir_x[j];
+            current.dir_y[i] = next.dir_y[j];
+            current.dir_z[i] = next.dir_z[j];
+            current.weight_r[i] = next.weight_r[j];
+            current.weight_g[i] = next.weight_g[j];
+            current.weight_b[i] = next.weight_b[j];
+            current.pdf[i] = next.pdf[j];
+            current.pathID[i] = next.pathID[j];
+            current.rnd[i] = next.rnd[j];
+          }
+        });
+    }
+
+    /*! stage 4: sum up path radiance per pixel, and accumulate */
+    void WavefrontPathTracer::accumulate(const FrameState &fs,
+                                         const vec2i &fbSize,
+                                         vec4f *accumBuffer,
+                                         float *varianceBuffer,
+                                         uint32_t *colorBuffer)
+    {
+      std::vector<float> rowError(fbSize.y), rowSamples(fbSize.y);
+      parallel_for(fbSize.y,[&](int y) {
+          float sumError = 0.f;
+          for (int x=0;x<fbSize.x;x++) {
+            const int pixelIdx = x+fbSize.x*y;
+            vec4f col(0.f);
+            float lumSqSum = 0.f;
+            for (size_t i=pixelPaths[pixelIdx];i<pixelPaths[pixelIdx+1];i++) {
+              col += vec4f(pathRadiance[i],1.f);
+              lumSqSum += device::luminance(pathRadiance[i])*device::luminance(pathRadiance[i]);
+            }
+            sumError += accumulatePixel(fs,pixelIdx,col,lumSqSum,
+                                        accumBuffer,varianceBuffer,colorBuffer);
+          }
+          rowError[y]   = sumError;
+          rowSamples[y] = float(pixelPaths[fbSize.x*(y+1)]-pixelPaths[fbSize.x*y]);
+        });
+      errorStats = errorStatsOf(rowError,rowSamples,fbSize);
+    }
+
+    void WavefrontPathTracer::render(const FrameState &fs,
+                                     const vec2i &fbSize,
+                                     vec4f *accumBuffer,
+                                     float *varianceBuffer,
+                                     uint32_t *colorBuffer)
+    {
+      if (fs.motionScale > 0) {
+        renderMotionFrame(fs,fbSize,colorBuffer);
+        return;
+      }
+      rayStats = device::RayStats();
+      generate(fs,fbSize,accumBuffer,varianceBuffer);
+      for (int depth=0;current.size() > 0;depth++) {
+        (depth == 0 ? rayStats.primary : rayStats.bounce) += current.size();
+        extend(depth);
+        shade(fs,fbSize,depth);
+        compactAndSort();
+      }
+      accumulate(fs,fbSize,accumBuffer,varianceBuffer,colorBuffer);
+    }
+
+  }
+}
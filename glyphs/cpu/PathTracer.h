@@ -0,0 +1,170 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/cpu/Scene.h"
+#include "glyphs/device/FrameState.h"
+#include "glyphs/device/Adaptive.h"
+#include "glyphs/device/RayStats.h"
+#include "glyphs/device/Reprojection.h"
+
+namespace glyphs {
+  namespace cpu {
+
+    using device::FrameState;
+
+    /*! host-side version of pathTrace()/raygen_program() in
+        device/common.cu. Shading is what SHADING_FAST does on the
+        device (lambertian), the sky is the SHADING_DISNEY one
+        (including next event estimation for the sun, see
+        device/Sky.h) */
+    struct PathTracer {
+      typedef std::shared_ptr<PathTracer> SP;
+
+      PathTracer(Scene::SP scene) : scene(scene) {}
+      virtual ~PathTracer() {}
+
+      /*! render one frame with given frame state; accumulates into
+          accumBuffer and varianceBuffer (if fs.accumID > 0) and
+          writes RGBA8 into colorBuffer, exactly like
+          raygen_program() - including adaptive sampling and motion
+          frames */
+      virtual void render(const FrameState &fs,
+                          const vec2i &fbSize,
+                          vec4f *accumBuffer,
+                          float *varianceBuffer,
+                          uint32_t *colorBuffer) = 0;
+
+      virtual std::string name() const = 0;
+
+      /*! startHistory() in device/common.cu, as a separate pass
+          before the first render() of an accumulation: traces each
+          pixel center into 'surfaces' and, if fs.reproject is set,
+          seeds accumBuffer and varianceBuffer from the previous
+          view's buffers where its history matches (zero elsewhere).
+          render() then continues from there, with accumID > 0.
+          Returns the fraction of pixels that kept their history */
+      float startHistory(const FrameState &fs,
+                         const vec2i &fbSize,
+                         const vec4f *prevAccumBuffer,
+                         const float *prevVarianceBuffer,
+                         const device::Surface *prevSurfaces,
+                         vec4f *accumBuffer,
+                         float *varianceBuffer,
+                         device::Surface *surfaces);
+
+      /*! rays traced in last render(), by kind */
+      device::RayStats rayStats;
+      /*! error estimate after last render(); always computed */
+      device::ErrorStats errorStats;
+      /*! per pixel counters of the last render(), with GLYPHS_STATS
+          (see device/PixelStats.h); only the megakernel variant
+          fills these in */
+      std::vector<device::PixelStats> pixelStats;
+
+    protected:
+      /*! fs.motionScale > 0: one megakernel sample per block of
+          pixels, as motionFrame() in device/common.cu does; both
+          variants use this */
+      void renderMotionFrame(const FrameState &fs,
+                             const vec2i &fbSize,
+                             uint32_t *colorBuffer);
+
+      Scene::SP scene;
+    };
+
+    /*! one 'megakernel' loop per pixel that runs all bounces, as
+        the device-side pathTrace() does */
+    struct MegakernelPathTracer : public PathTracer {
+      MegakernelPathTracer(Scene::SP scene) : PathTracer(scene) {}
+
+      void render(const FrameState &fs,
+                  const vec2i &fbSize,
+                  vec4f *accumBuffer,
+                  float *varianceBuffer,
+                  uint32_t *colorBuffer) override;
+
+      std::string name() const override { return "megakernel"; }
+    };
+
+    /*! wavefront variant: separate generate, extend, shade and
+        accumulate stages that communicate through SoA ray queues;
+        secondary rays get sorted by origin/direction bins between
+        bounces */
+    struct WavefrontPathTracer : public PathTracer {
+      WavefrontPathTracer(Scene::SP scene) : PathTracer(scene) {}
+
+      void render(const FrameState &fs,
+                  const vec2i &fbSize,
+                  vec4f *accumBuffer,
+                  float *varianceBuffer,
+                  uint32_t *colorBuffer) override;
+
+      std::string name() const override
+      { return sortRays ? "wavefront+sort" : "wavefront"; }
+
+      /*! sort secondary rays by origin/direction bins */
+      bool sortRays { true };
+
+    private:
+      /*! paths (one per pixel sample) that are still alive, SoA */
+      struct RayQueue {
+        void resize(size_t n);
+        size_t size() const { return pathID.size(); }
+
+        std::vector<float>  org_x, org_y, org_z;
+        std::vector<float>  dir_x, dir_y, dir_z;
+        std::vector<float>  weight_r, weight_g, weight_b;
+        /*! pdf the direction was sampled with, for MIS */
+        std::vector<float>  pdf;
+        std::vector<int>    pathID;
+        std::vector<Random> rnd;
+      };
+
+      /*! result of the extend stage, one entry per queued ray */
+      struct HitQueue {
+        void resize(size_t n);
+
+        std::vector<float> t;
+        std::vector<int>   primID, meshID;
+        std::vector<float> Ng_x, Ng_y, Ng_z;
+      };
+
+      void generate(const FrameState &fs, const vec2i &fbSize,
+                    const vec4f *accumBuffer, const float *varianceBuffer);
+      void extend(int depth);
+      void shade(const FrameState &fs, const vec2i &fbSize, int depth);
+      void compactAndSort();
+      void accumulate(const FrameState &fs, const vec2i &fbSize,
+                      vec4f *accumBuffer, float *varianceBuffer,
+                      uint32_t *colorBuffer);
+
+      RayQueue current, next;
+      HitQueue hits;
+      /*! per next-queue entry: 1 if the shade stage spawned a ray */
+      std::vector<uint8_t> alive;
+      /*! radiance per path, summed per pixel in accumulate() */
+      std::vector<vec3f>   pathRadiance;
+      /*! pixel i's paths are [pixelPaths[i],pixelPaths[i+1]); with
+          adaptive sampling pixels can have different counts */
+      std::vector<size_t>  pixelPaths;
+      /*! pixel index of each path */
+      std::vector<int>     pathPixel;
+    };
+
+  }
+}
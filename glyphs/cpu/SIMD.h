@@ -0,0 +1,197 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! minimal 8-wide float/mask types for the cpu back-end. Picks the
+    widest ISA the compiler was told about: AVX-512VL (with k-mask
+    registers), AVX2 (with vector masks), or a plain scalar fallback;
+    see GLYPHS_CPU_ISA in CMakeLists.txt */
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+#  define GLYPHS_SIMD_AVX512 1
+#elif defined(__AVX2__)
+#  define GLYPHS_SIMD_AVX2 1
+#endif
+
+#if GLYPHS_SIMD_AVX512 || GLYPHS_SIMD_AVX2
+#  include <immintrin.h>
+#endif
+
+namespace glyphs {
+  namespace cpu {
+
+    inline const char *simdISA()
+    {
+#if GLYPHS_SIMD_AVX512
+      return "avx512vl";
+#elif GLYPHS_SIMD_AVX2
+      return "avx2";
+#else
+      return "scalar";
+#endif
+    }
+
+    // ------------------------------------------------------------------
+    // AVX-512VL: 256-bit vectors, masks in k-registers
+    // ------------------------------------------------------------------
+#if GLYPHS_SIMD_AVX512
+    struct vbool8 {
+      vbool8() = default;
+      vbool8(__mmask8 m) : m(m) {}
+      __mmask8 m;
+    };
+    inline vbool8 operator&(vbool8 a, vbool8 b) { return __mmask8(a.m & b.m); }
+    inline vbool8 operator|(vbool8 a, vbool8 b) { return __mmask8(a.m | b.m); }
+    inline vbool8 operator!(vbool8 a)           { return __mmask8(~a.m); }
+    inline int    movemask(vbool8 a)            { return a.m; }
+
+    struct vfloat8 {
+      vfloat8() = default;
+      vfloat8(__m256 v) : v(v) {}
+      vfloat8(float f) : v(_mm256_set1_ps(f)) {}
+      static vfloat8 load(const float *p) { return _mm256_loadu_ps(p); }
+      void store(float *p) const { _mm256_storeu_ps(p,v); }
+      __m256 v;
+    };
+    inline vbool8 operator<(vfloat8 a, vfloat8 b)  { return _mm256_cmp_ps_mask(a.v,b.v,_CMP_LT_OQ); }
+    inline vbool8 operator>(vfloat8 a, vfloat8 b)  { return _mm256_cmp_ps_mask(a.v,b.v,_CMP_GT_OQ); }
+    inline vbool8 operator>=(vfloat8 a, vfloat8 b) { return _mm256_cmp_ps_mask(a.v,b.v,_CMP_GE_OQ); }
+    /*! a where m is set, else b */
+    inline vfloat8 select(vbool8 m, vfloat8 a, vfloat8 b) { return _mm256_mask_blend_ps(m.m,b.v,a.v); }
+
+    // ------------------------------------------------------------------
+    // AVX2: masks are full-width float vectors
+    // ------------------------------------------------------------------
+#elif GLYPHS_SIMD_AVX2
+    struct vbool8 {
+      vbool8() = default;
+      vbool8(__m256 m) : m(m) {}
+      __m256 m;
+    };
+    inline vbool8 operator&(vbool8 a, vbool8 b) { return _mm256_and_ps(a.m,b.m); }
+    inline vbool8 operator|(vbool8 a, vbool8 b) { return _mm256_or_ps(a.m,b.m); }
+    inline vbool8 operator!(vbool8 a)
+    { return _mm256_xor_ps(a.m,_mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+    inline int    movemask(vbool8 a)            { return _mm256_movemask_ps(a.m); }
+
+    struct vfloat8 {
+      vfloat8() = default;
+      vfloat8(__m256 v) : v(v) {}
+      vfloat8(float f) : v(_mm256_set1_ps(f)) {}
+      static vfloat8 load(const float *p) { return _mm256_loadu_ps(p); }
+      void store(float *p) const { _mm256_storeu_ps(p,v); }
+      __m256 v;
+    };
+    inline vbool8 operator<(vfloat8 a, vfloat8 b)  { return _mm256_cmp_ps(a.v,b.v,_CMP_LT_OQ); }
+    inline vbool8 operator>(vfloat8 a, vfloat8 b)  { return _mm256_cmp_ps(a.v,b.v,_CMP_GT_OQ); }
+    inline vbool8 operator>=(vfloat8 a, vfloat8 b) { return _mm256_cmp_ps(a.v,b.v,_CMP_GE_OQ); }
+    inline vfloat8 select(vbool8 m, vfloat8 a, vfloat8 b) { return _mm256_blendv_ps(b.v,a.v,m.m); }
+#endif
+
+#if GLYPHS_SIMD_AVX512 || GLYPHS_SIMD_AVX2
+    inline vfloat8 operator+(vfloat8 a, vfloat8 b) { return _mm256_add_ps(a.v,b.v); }
+    inline vfloat8 operator-(vfloat8 a, vfloat8 b) { return _mm256_sub_ps(a.v,b.v); }
+    inline vfloat8 operator*(vfloat8 a, vfloat8 b) { return _mm256_mul_ps(a.v,b.v); }
+    inline vfloat8 operator/(vfloat8 a, vfloat8 b) { return _mm256_div_ps(a.v,b.v); }
+    inline vfloat8 operator-(vfloat8 a)            { return _mm256_xor_ps(a.v,_mm256_set1_ps(-0.f)); }
+    inline vfloat8 min(vfloat8 a, vfloat8 b)       { return _mm256_min_ps(a.v,b.v); }
+    inline vfloat8 max(vfloat8 a, vfloat8 b)       { return _mm256_max_ps(a.v,b.v); }
+    inline vfloat8 sqrt(vfloat8 a)                 { return _mm256_sqrt_ps(a.v); }
+    inline vfloat8 abs(vfloat8 a)                  { return _mm256_andnot_ps(_mm256_set1_ps(-0.f),a.v); }
+
+    // ------------------------------------------------------------------
+    // scalar fallback; same interface, plain loops the compiler may
+    // or may not vectorize
+    // ------------------------------------------------------------------
+#else
+    struct vbool8 {
+      vbool8() = default;
+      vbool8(int m) : m(m) {}
+      int m;
+    };
+    inline vbool8 operator&(vbool8 a, vbool8 b) { return a.m & b.m; }
+    inline vbool8 operator|(vbool8 a, vbool8 b) { return a.m | b.m; }
+    inline vbool8 operator!(vbool8 a)           { return ~a.m & 0xff; }
+    inline int    movemask(vbool8 a)            { return a.m; }
+
+    struct vfloat8 {
+      vfloat8() = default;
+      vfloat8(float f) { for (int i=0;i<8;i++) v[i] = f; }
+      static vfloat8 load(const float *p)
+      { vfloat8 r; for (int i=0;i<8;i++) r.v[i] = p[i]; return r; }
+      void store(float *p) const { for (int i=0;i<8;i++) p[i] = v[i]; }
+      float v[8];
+    };
+
+#define GLYPHS_SIMD_BINARY_OP(op)                                       \
+    inline vfloat8 operator op(vfloat8 a, vfloat8 b)                    \
+    { vfloat8 r; for (int i=0;i<8;i++) r.v[i] = a.v[i] op b.v[i]; return r; }
+    GLYPHS_SIMD_BINARY_OP(+)
+    GLYPHS_SIMD_BINARY_OP(-)
+    GLYPHS_SIMD_BINARY_OP(*)
+    GLYPHS_SIMD_BINARY_OP(/)
+#undef GLYPHS_SIMD_BINARY_OP
+
+#define GLYPHS_SIMD_COMPARE_OP(op)                                      \
+    inline vbool8 operator op(vfloat8 a, vfloat8 b)                     \
+    { int m = 0; for (int i=0;i<8;i++) m |= (a.v[i] op b.v[i]) << i; return m; }
+    GLYPHS_SIMD_COMPARE_OP(<)
+    GLYPHS_SIMD_COMPARE_OP(>)
+    GLYPHS_SIMD_COMPARE_OP(>=)
+#undef GLYPHS_SIMD_COMPARE_OP
+
+#define GLYPHS_SIMD_UNARY_FCT(name,expr)                                \
+    inline vfloat8 name(vfloat8 a)                                      \
+    { vfloat8 r; for (int i=0;i<8;i++) { const float x = a.v[i]; r.v[i] = expr; } return r; }
+    GLYPHS_SIMD_UNARY_FCT(operator-,-x)
+    GLYPHS_SIMD_UNARY_FCT(sqrt,sqrtf(x))
+    GLYPHS_SIMD_UNARY_FCT(abs,fabsf(x))
+#undef GLYPHS_SIMD_UNARY_FCT
+
+    inline vfloat8 min(vfloat8 a, vfloat8 b)
+    { vfloat8 r; for (int i=0;i<8;i++) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+    inline vfloat8 max(vfloat8 a, vfloat8 b)
+    { vfloat8 r; for (int i=0;i<8;i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+    inline vfloat8 select(vbool8 m, vfloat8 a, vfloat8 b)
+    { vfloat8 r; for (int i=0;i<8;i++) r.v[i] = (m.m >> i) & 1 ? a.v[i] : b.v[i]; return r; }
+#endif
+
+    inline bool any(vbool8 a) { return movemask(a) != 0; }
+
+    // ------------------------------------------------------------------
+    // 3-vectors of 8 floats each
+    // ------------------------------------------------------------------
+    struct vec3f8 {
+      vec3f8() = default;
+      vec3f8(vfloat8 x, vfloat8 y, vfloat8 z) : x(x), y(y), z(z) {}
+      /*! broadcast */
+      template<typename Vec3>
+      explicit vec3f8(const Vec3 &v) : x(v.x), y(v.y), z(v.z) {}
+
+      vfloat8 x, y, z;
+    };
+    inline vec3f8 operator+(const vec3f8 &a, const vec3f8 &b) { return { a.x+b.x, a.y+b.y, a.z+b.z }; }
+    inline vec3f8 operator-(const vec3f8 &a, const vec3f8 &b) { return { a.x-b.x, a.y-b.y, a.z-b.z }; }
+    inline vec3f8 operator*(vfloat8 s, const vec3f8 &a)       { return { s*a.x, s*a.y, s*a.z }; }
+    inline vfloat8 dot(const vec3f8 &a, const vec3f8 &b)      { return a.x*b.x + a.y*b.y + a.z*b.z; }
+    inline vfloat8 length(const vec3f8 &a)                    { return sqrt(dot(a,a)); }
+
+  }
+}
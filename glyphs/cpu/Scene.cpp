@@ -0,0 +1,314 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "glyphs/cpu/Scene.h"
+#include "glyphs/device/roundedCone.h"
+#include "glyphs/Timings.h"
+
+namespace glyphs {
+  namespace cpu {
+
+    using namespace glyphs::device;
+
+    Scene::SP Scene::create(const std::string &method,
+                            Glyphs::SP glyphs,
+                            Triangles::SP triangles)
+    {
+      Scene::SP scene = std::make_shared<Scene>();
+      if (method == "arrows")
+        scene->method = ARROWS;
+      else if (method == "spheres")
+        scene->method = SPHERES;
+      else if (method == "motionblur")
+        scene->method = MOTIONBLUR;
+      else
+        throw std::runtime_error("cpu back-end does not support glyphs method '"+method+"'");
+
+      scene->glyphs = glyphs;
+      {
+        ScopedTimer timer("build glyphs");
+        scene->buildGlyphs();
+      }
+      if (triangles) {
+        ScopedTimer timer("build triangles");
+        scene->buildTriangles(triangles);
+      }
+
+      for (auto &box : scene->primBounds)
+        scene->bounds.extend(box);
+
+      ScopedTimer timer("BVH");
+      double t0 = getCurrentTime();
+      scene->bvh.build(scene->primBounds);
+      scene->bvhSAH = scene->bvh.sahCost();
+      std::cout << "#glyphs.cpu: built bvh over " << scene->primBounds.size()
+                << " prims in " << (getCurrentTime()-t0) << "s" << std::endl;
+      return scene;
+    }
+
+    void Scene::setTimestep(Glyphs::SP newGlyphs)
+    {
+      if (newGlyphs->links.size() != glyphs->links.size())
+        throw std::runtime_error("#glyphs.cpu: timestep has different number of links - can't refit");
+
+      // glyphs come first in primBounds, triangles stay where they are
+      const size_t numGlyphs = glyphLinks.size();
+      std::vector<box3f> triBounds(primBounds.begin()+numGlyphs,primBounds.end());
+      glyphs = newGlyphs;
+      glyphLinks.clear();
+      primBounds.clear();
+      xfm.clear();
+      rcpXfm.clear();
+      buildGlyphs();
+      if (glyphLinks.size() != numGlyphs)
+        throw std::runtime_error("#glyphs.cpu: timestep has different topology - can't refit");
+      primBounds.insert(primBounds.end(),triBounds.begin(),triBounds.end());
+
+      bounds = box3f();
+      for (auto &box : primBounds)
+        bounds.extend(box);
+
+      double t0 = getCurrentTime();
+      bvh.refit(primBounds);
+      const double refitTime = getCurrentTime()-t0;
+      const float sahGrowth = bvh.sahCost() / max(bvhSAH,1e-20f);
+      if (sahGrowth <= rebuildThreshold) {
+        std::cout << "#glyphs.cpu: refit bvh in " << refitTime
+                  << "s (SAH cost growth " << sahGrowth << "x)" << std::endl;
+        return;
+      }
+
+      t0 = getCurrentTime();
+      bvh.build(primBounds);
+      bvhSAH = bvh.sahCost();
+      std::cout << "#glyphs.cpu: SAH cost grew by " << sahGrowth << "x after refit ("
+                << refitTime << "s), rebuilt bvh in "
+                << (getCurrentTime()-t0) << "s" << std::endl;
+    }
+
+    /*! arrow geometry, exactly as assembled in device/ArrowGlyphs.cu */
+    struct Arrow {
+      Arrow(const Glyphs &glyphs, const Link &link)
+      {
+        pa = link.pos;
+        ra = 0.0001f;
+        rb = glyphs.links[link.prev].rad;
+        pb = glyphs.links[link.prev].pos;
+        vec3f va = pa-pb;
+        float len = length(va);
+        float tiplen = rb*4.f;
+        rc = rb/3.f;
+        float maxlen = 0.5f*len;
+        if (tiplen > maxlen) {
+          rb *= maxlen/tiplen;
+          if (rb < rc)
+            rb = rc;
+          tiplen = maxlen;
+        }
+        pc = pa-normalize(va)*tiplen;
+      }
+
+      box3f bounds() const
+      {
+        return box3f()
+          .including(pa-rb).including(pa+rb)
+          .including(pb-rb).including(pb+rb);
+      }
+
+      vec3f pa, pb, pc;
+      float ra, rb, rc;
+    };
+
+    void Scene::buildGlyphs()
+    {
+      const Glyphs &g = *glyphs;
+      for (int linkID=0;linkID<(int)g.links.size();linkID++) {
+        const Link &link = g.links[linkID];
+        // all three device-side intersectors ignore links w/o predecessor
+        if (link.prev < 0) continue;
+
+        box3f box;
+        switch (method) {
+        case SPHERES: {
+          const affine3f x = Glyphs::getXform(glyphs,link);
+          for (int i=0;i<8;i++)
+            box.extend(xfmPoint(x,vec3f((i&1)?+1.f:-1.f,
+                                        (i&2)?+1.f:-1.f,
+                                        (i&4)?+1.f:-1.f)));
+          xfm.push_back(x);
+          rcpXfm.push_back(rcp(x));
+        } break;
+        case ARROWS:
+          box = Arrow(g,link).bounds();
+          break;
+        case MOTIONBLUR: {
+          const vec3f pb = g.links[link.prev].pos;
+          box
+            = box3f()
+            .including(link.pos-g.radius)
+            .including(link.pos+g.radius)
+            .including(pb-g.radius)
+            .including(pb+g.radius);
+        } break;
+        }
+        glyphLinks.push_back(linkID);
+        primBounds.push_back(box);
+      }
+    }
+
+    void Scene::buildTriangles(Triangles::SP triangles)
+    {
+      for (auto m : triangles->meshes) {
+        const int size = (int)vertices.size();
+        vertices.insert(vertices.end(),m->vertex.begin(),m->vertex.end());
+        for (auto id : m->index)
+          indices.push_back(id + size);
+      }
+      for (auto idx : indices)
+        primBounds.push_back(box3f()
+                             .including(vertices[idx.x])
+                             .including(vertices[idx.y])
+                             .including(vertices[idx.z]));
+    }
+
+    bool Scene::intersectGlyph(int glyphID, Ray &ray, Hit &hit, Random &rnd) const
+    {
+      const Glyphs &g = *glyphs;
+      const int linkID = glyphLinks[glyphID];
+      const Link &link = g.links[linkID];
+
+      float tmp_hit_t = ray.tmax;
+      vec3f normal;
+      bool found = false;
+      switch (method) {
+      case SPHERES: {
+        const affine3f &r = rcpXfm[glyphID];
+        const Ray objRay(xfmPoint(r,ray.origin),
+                         xfmVector(r,ray.direction),
+                         ray.tmin,ray.tmax);
+        if (intersectInstanceSphereRTGem(vec3f(0.f),1.f,objRay,tmp_hit_t,normal)
+            && tmp_hit_t < ray.tmax) {
+          // object-to-world normal transform, ie, inverse transpose
+          normal = r.l.transposed() * normal;
+          found = true;
+        }
+      } break;
+      case ARROWS: {
+        const Arrow arrow(g,link);
+        // head and shaft each write their t whether or not it is
+        // closer, so each gets its own, and the closer one wins
+        float headT = ray.tmax;
+        if (intersectRoundedCone(arrow.pc,arrow.pa,arrow.rb,arrow.ra,ray,headT,normal)
+            && headT < tmp_hit_t) {
+          tmp_hit_t = headT;
+          found = true;
+        }
+        float shaftT = ray.tmax;
+        vec3f shaftNormal;
+        if (intersectCylinder(arrow.pc,arrow.pb,arrow.rc,ray,shaftT,shaftNormal)
+            && shaftT < tmp_hit_t) {
+          tmp_hit_t = shaftT;
+          normal    = shaftNormal;
+          found = true;
+        }
+      } break;
+      case MOTIONBLUR: {
+        // same time sampling as in device/MotionSpheres.cu
+        const vec3f pa = link.pos;
+        const vec3f pb = g.links[link.prev].pos;
+        const float dt = 4e-3f;
+        const vec3f va = (pa-pb)/0.02f;
+        const vec3f p  = 0.5f*(pa+pb);
+        const float a  = dot(normalize(va),link.accel);
+        const float r  = (rnd.get1D(device::DIM_TIME) - 0.5f);
+        const vec3f pc = p+r*dt*(va+r*dt*normalize(va)*a);
+        if (intersectSphere2(pc,link.rad,ray,tmp_hit_t,normal)
+            && tmp_hit_t < ray.tmax)
+          found = true;
+      } break;
+      }
+
+      if (!found) return false;
+      ray.tmax   = tmp_hit_t;
+      hit.primID = linkID;
+      hit.meshID = -1;
+      hit.t      = tmp_hit_t;
+      hit.Ng     = normal;
+      return true;
+    }
+
+    bool Scene::intersectTriangle(int triID, Ray &ray, Hit &hit) const
+    {
+      const vec3i idx = indices[triID];
+      const vec3f A = vertices[idx.x];
+      const vec3f e1 = vertices[idx.y] - A;
+      const vec3f e2 = vertices[idx.z] - A;
+
+      const vec3f pvec = cross(ray.direction,e2);
+      const float det = dot(e1,pvec);
+      if (fabsf(det) < 1e-12f) return false;
+      const float rcpDet = 1.f/det;
+      const vec3f tvec = ray.origin - A;
+      const float u = dot(tvec,pvec) * rcpDet;
+      if (u < 0.f || u > 1.f) return false;
+      const vec3f qvec = cross(tvec,e1);
+      const float v = dot(ray.direction,qvec) * rcpDet;
+      if (v < 0.f || u+v > 1.f) return false;
+      const float t = dot(e2,qvec) * rcpDet;
+      if (t <= ray.tmin || t >= ray.tmax) return false;
+
+      ray.tmax   = t;
+      hit.primID = triID;
+      hit.meshID = 0;
+      hit.t      = t;
+      hit.Ng     = normalize(cross(e1,e2));
+      return true;
+    }
+
+    bool Scene::intersect(Ray &ray, Hit &hit, Random &rnd,
+                          device::PixelStats *stats) const
+    {
+      const int numGlyphs = (int)glyphLinks.size();
+      bool found = false;
+      bvh.traverse(ray,[&](int primID, Ray &ray) {
+          GLYPHS_STAT(if (stats) stats->counter[device::COUNT_INTERSECT]++);
+          if (primID < numGlyphs)
+            found |= intersectGlyph(primID,ray,hit,rnd);
+          else
+            found |= intersectTriangle(primID-numGlyphs,ray,hit);
+          return false;
+        },stats ? &stats->counter[device::COUNT_NODES] : nullptr);
+      return found;
+    }
+
+    bool Scene::occluded(Ray ray, Random &rnd, device::PixelStats *stats) const
+    {
+      const int numGlyphs = (int)glyphLinks.size();
+      bool found = false;
+      Hit hit;
+      bvh.traverse(ray,[&](int primID, Ray &ray) {
+          GLYPHS_STAT(if (stats) stats->counter[device::COUNT_INTERSECT]++);
+          if (primID < numGlyphs)
+            found = intersectGlyph(primID,ray,hit,rnd);
+          else
+            found = intersectTriangle(primID-numGlyphs,ray,hit);
+          return found;
+        },stats ? &stats->counter[device::COUNT_NODES] : nullptr);
+      return found;
+    }
+
+  }
+}
@@ -0,0 +1,95 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/cpu/BVH.h"
+#include "glyphs/device/PerRayData.h"
+#include "glyphs/Glyphs.h"
+#include "glyphs/Triangles.h"
+
+namespace glyphs {
+  namespace cpu {
+
+    using device::Random;
+
+    /*! what a ray hit; same semantics as device::PerRayData (ie,
+        meshID -1 means 'glyph', in which case primID is the link) */
+    struct Hit {
+      int   primID { -1 };
+      int   meshID { -1 };
+      float t;
+      vec3f Ng;
+    };
+
+    /*! host-side counterpart of the OWLGlyphs back-ends: one BVH over
+        all glyphs (and triangles, if any) in world space, using the
+        same intersection code as the device programs */
+    struct Scene {
+      typedef std::shared_ptr<Scene> SP;
+
+      /*! 'method' is the same string the viewer uses to pick the
+          OWLGlyphs back-end (arrows,spheres,motionblur) */
+      static Scene::SP create(const std::string &method,
+                              Glyphs::SP glyphs,
+                              Triangles::SP triangles);
+
+      /*! switch to another timestep of the same glyphs (same
+          topology); refits the BVH, or rebuilds it if the refit
+          degraded its SAH cost by more than rebuildThreshold */
+      void setTimestep(Glyphs::SP glyphs);
+
+      /*! find closest hit; returns false on miss. 'rnd' is only
+          used for glyph types that sample (ie, motion blur). With
+          GLYPHS_STATS, counts visited nodes and primitive tests in
+          'stats', if given */
+      bool intersect(Ray &ray, Hit &hit, Random &rnd,
+                     device::PixelStats *stats = nullptr) const;
+
+      /*! returns true if there is any hit in [ray.tmin,ray.tmax] */
+      bool occluded(Ray ray, Random &rnd,
+                    device::PixelStats *stats = nullptr) const;
+
+      enum Method { ARROWS, SPHERES, MOTIONBLUR };
+
+      Method     method;
+      Glyphs::SP glyphs;
+      box3f      bounds;
+      float      rebuildThreshold { 1.5f };
+
+    private:
+      void buildGlyphs();
+      void buildTriangles(Triangles::SP triangles);
+
+      bool intersectGlyph(int linkID, Ray &ray, Hit &hit, Random &rnd) const;
+      bool intersectTriangle(int triID, Ray &ray, Hit &hit) const;
+
+      /*! per-prim info; glyphs come first, then triangles */
+      std::vector<box3f>    primBounds;
+      std::vector<int>      glyphLinks;
+      /*! for spheres: instance transform and its inverse, per glyph */
+      std::vector<affine3f> xfm, rcpXfm;
+
+      std::vector<vec3f>    vertices;
+      std::vector<vec3i>    indices;
+
+      BVH   bvh;
+      /*! SAH cost right after the last full build */
+      float bvhSAH { 0.f };
+    };
+
+  }
+}
@@ -0,0 +1,741 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! compares megakernel and wavefront path tracing on the cpu
+    back-end, at different path depths; optionally, also the time
+    the samplers and sun sampling strategies take to reach a given
+    error, with uniform and with adaptive sampling */
+
+#include "glyphs/BenchStats.h"
+#include "glyphs/CameraPath.h"
+#include "glyphs/cpu/PathTracer.h"
+#include "glyphs/Timings.h"
+// std
+#include <fstream>
+#include <iomanip>
+
+#define STB_IMAGE_IMPLEMENTATION 1
+#include "samples/common/3rdParty/stb/stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION 1
+#include "samples/common/3rdParty/stb/stb_image_write.h"
+
+namespace glyphs {
+
+  struct {
+    std::string method = "arrows"; //arrows,spheres,motionblur
+    int spp = 1;
+    int numFrames = 4;
+    std::vector<int> pathDepths;
+    vec2i fbSize = vec2i(800,800);
+    Camera camera;
+    bool haveCamera = false;
+    std::string outFileName;
+    std::vector<std::string> objFileNames;
+    bool timesteps = false;
+    float rebuildThreshold = 1.5f;
+    float targetError = 0.f;
+    float adaptiveThreshold = 0.f;
+    int adaptiveMinSamples = 16;
+    int referenceSpp = 0;
+    /*! -1: compare all samplers */
+    int samplerType = -1;
+    /*! -1: compare all strategies */
+    int sunSampling = -1;
+    /*! the frame time table compares this with roulette off */
+    int rouletteDepth = 3;
+    /*! preview shade modes to time, in addition to path tracing */
+    std::vector<int> shadeModes;
+    int aoSamples = 4;
+    /*! if > 0, time motion frames and the block size the viewer
+        would pick for this target frame time */
+    float motionTargetMs = 0.f;
+    /*! if > 0, orbit the camera by this many degrees after
+        accumulating, and compare restarting with reprojecting */
+    float reprojectDegrees = 0.f;
+    int reprojectMaxSpp = 64;
+    /*! print the per-pixel work counters of a megakernel frame at
+        each depth (needs GLYPHS_STATS) */
+    bool pixelStats = false;
+    /*! print the startup phase timings */
+    bool timings = false;
+    /*! untimed frames before each row of the frame time table */
+    int warmupFrames = 1;
+    /*! see FrameState::seed */
+    uint32_t seed = 0;
+    /*! write each row of the frame time table, with every frame's
+        time, to this file as JSON (see BenchStats.h) */
+    std::string benchJSON;
+    /*! also time a playback of this camera path (see CameraPath.h),
+        with framesPerKey frames from each key to the next */
+    std::string playPath;
+    int framesPerKey = 8;
+  } cmdline;
+
+  const char *sunSamplingNames[] = { "bsdf", "nee", "mis" };
+
+  void usage(const std::string &msg)
+  {
+    if (msg != "") std::cerr << "Error: " << msg << std::endl << std::endl;
+    std::cout << "Usage: ./owlGlyphsCPUBench <inputfile> [--arrows|--spheres|--motionblur]"
+              << " [-rd <depth>]* [--frames <n>] [--warmup <n>] [-spp <n>] [-win <w> <h>]"
+              << " [--seed <n>] [--bench-json <file>]"
+              << " [--play-path <file> [--frames-per-key <n>]]"
+              << " [--camera <from> <at> <up>] [-o <file.png>]"
+              << " [--timesteps [--rebuild-threshold <f>]]"
+              << " [--sampler random|sobol] [--sun-sampling bsdf|nee|mis]"
+              << " [--roulette-depth <d>] [-sm <preview mode>]* [--ao-samples <n>]"
+              << " [--motion-target-ms <ms>] [--pixel-stats] [--timings]"
+              << " [--reproject <degrees> [--reproject-max-spp <n>]]"
+              << " [--target-error <e> [--adaptive <threshold>] [--adaptive-min-spp <n>]"
+              << " [--reference-spp <n>]]"
+              << std::endl;
+    exit(msg != "");
+  }
+
+  void savePNG(const std::string &fileName,
+               const vec2i &fbSize,
+               const std::vector<uint32_t> &fb)
+  {
+    std::vector<uint32_t> pixels;
+    for (int y=0;y<fbSize.y;y++) {
+      const uint32_t *line = fb.data() + (fbSize.y-1-y)*fbSize.x;
+      for (int x=0;x<fbSize.x;x++)
+        pixels.push_back(line[x] | (0xff << 24));
+    }
+    stbi_write_png(fileName.c_str(),fbSize.x,fbSize.y,4,
+                   pixels.data(),fbSize.x*sizeof(uint32_t));
+  }
+
+  extern "C" int main(int argc, char **argv)
+  {
+    std::vector<std::string> fileNames;
+    for (int i=1;i<argc;i++) {
+      const std::string arg = argv[i];
+      if (arg[0] != '-')
+        fileNames.push_back(arg);
+      else if (arg == "--arrows" || arg == "-arr")
+        cmdline.method = "arrows";
+      else if (arg == "--spheres" || arg == "-sph")
+        cmdline.method = "spheres";
+      else if (arg == "--motionblur" || arg == "-mb")
+        cmdline.method = "motionblur";
+      else if (arg == "--rec-depth" || arg == "-rd")
+        cmdline.pathDepths.push_back(std::atoi(argv[++i]));
+      else if (arg == "--frames")
+        cmdline.numFrames = std::atoi(argv[++i]);
+      else if (arg == "--warmup")
+        cmdline.warmupFrames = std::atoi(argv[++i]);
+      else if (arg == "--seed")
+        cmdline.seed = uint32_t(std::stoul(argv[++i]));
+      else if (arg == "--bench-json")
+        cmdline.benchJSON = argv[++i];
+      else if (arg == "--play-path")
+        cmdline.playPath = argv[++i];
+      else if (arg == "--frames-per-key")
+        cmdline.framesPerKey = std::atoi(argv[++i]);
+      else if (arg == "-spp")
+        cmdline.spp = std::atoi(argv[++i]);
+      else if (arg == "-win" || arg == "--size") {
+        cmdline.fbSize.x = std::atoi(argv[++i]);
+        cmdline.fbSize.y = std::atoi(argv[++i]);
+      }
+      else if (arg == "--camera") {
+        Camera &c = cmdline.camera;
+        c.from.x = std::atof(argv[++i]);
+        c.from.y = std::atof(argv[++i]);
+        c.from.z = std::atof(argv[++i]);
+        c.at.x = std::atof(argv[++i]);
+        c.at.y = std::atof(argv[++i]);
+        c.at.z = std::atof(argv[++i]);
+        c.up.x = std::atof(argv[++i]);
+        c.up.y = std::atof(argv[++i]);
+        c.up.z = std::atof(argv[++i]);
+        cmdline.haveCamera = true;
+      }
+      else if (arg == "-o")
+        cmdline.outFileName = argv[++i];
+      else if (arg == "-obj")
+        cmdline.objFileNames.push_back(argv[++i]);
+      else if (arg == "--timesteps")
+        cmdline.timesteps = true;
+      else if (arg == "--rebuild-threshold")
+        cmdline.rebuildThreshold = std::atof(argv[++i]);
+      else if (arg == "--target-error")
+        cmdline.targetError = std::atof(argv[++i]);
+      else if (arg == "--adaptive")
+        cmdline.adaptiveThreshold = std::atof(argv[++i]);
+      else if (arg == "--adaptive-min-spp")
+        cmdline.adaptiveMinSamples = std::atoi(argv[++i]);
+      else if (arg == "--reference-spp")
+        cmdline.referenceSpp = std::atoi(argv[++i]);
+      else if (arg == "-sm" || arg == "--shade-mode") {
+        const int mode = std::atoi(argv[++i]);
+        if (mode <= device::SHADE_PATH || mode >= device::NUM_SHADE_MODES)
+          usage("unknown preview shade mode '"+std::string(argv[i])+"'");
+        cmdline.shadeModes.push_back(mode);
+      }
+      else if (arg == "--ao-samples")
+        cmdline.aoSamples = std::atoi(argv[++i]);
+      else if (arg == "--motion-target-ms")
+        cmdline.motionTargetMs = std::atof(argv[++i]);
+      else if (arg == "--reproject")
+        cmdline.reprojectDegrees = std::atof(argv[++i]);
+      else if (arg == "--reproject-max-spp")
+        cmdline.reprojectMaxSpp = std::atoi(argv[++i]);
+      else if (arg == "--pixel-stats") {
+        if (!GLYPHS_STATS)
+          usage("--pixel-stats needs a build with GLYPHS_STATS");
+        cmdline.pixelStats = true;
+      }
+      else if (arg == "--timings")
+        cmdline.timings = true;
+      else if (arg == "--roulette-depth")
+        cmdline.rouletteDepth = std::atoi(argv[++i]);
+      else if (arg == "--sun-sampling") {
+        const std::string strategy = argv[++i];
+        for (int s=0;s<3;s++)
+          if (strategy == sunSamplingNames[s])
+            cmdline.sunSampling = s;
+        if (cmdline.sunSampling < 0)
+          usage("unknown sun sampling strategy '"+strategy+"'");
+      }
+      else if (arg == "--sampler") {
+        const std::string sampler = argv[++i];
+        if (sampler == "random")
+          cmdline.samplerType = device::SAMPLER_RANDOM;
+        else if (sampler == "sobol")
+          cmdline.samplerType = device::SAMPLER_SOBOL;
+        else
+          usage("unknown sampler '"+sampler+"'");
+      }
+      else
+        usage("unknown cmdline arg '"+arg+"'");
+    }
+    if (fileNames.empty())
+      usage("No glyph file name provided. See testdata.glyphs in project root directory.");
+    if (cmdline.pathDepths.empty())
+      cmdline.pathDepths = { 2, 4, 8 };
+
+    Glyphs::SP glyphs;
+    {
+      ScopedTimer timer("load glyphs");
+      glyphs = Glyphs::load(fileNames);
+    }
+    Triangles::SP triangles = nullptr;
+    if (!cmdline.objFileNames.empty()) {
+      ScopedTimer timer("load obj");
+      triangles = Triangles::load(cmdline.objFileNames,vec3f(.8f));
+    }
+
+    cpu::Scene::SP scene;
+    {
+      ScopedTimer timer("create scene");
+      scene = cpu::Scene::create(cmdline.method,glyphs,triangles);
+    }
+    scene->rebuildThreshold = cmdline.rebuildThreshold;
+    if (cmdline.timings)
+      Timings::printText(std::cout);
+
+    std::vector<cpu::PathTracer::SP> tracers;
+    tracers.push_back(std::make_shared<cpu::MegakernelPathTracer>(scene));
+    auto unsorted = std::make_shared<cpu::WavefrontPathTracer>(scene);
+    unsorted->sortRays = false;
+    tracers.push_back(unsorted);
+    tracers.push_back(std::make_shared<cpu::WavefrontPathTracer>(scene));
+
+    const vec2i fbSize = cmdline.fbSize;
+    device::FrameState fs;
+    fs.samplesPerPixel = cmdline.spp;
+    fs.seed = cmdline.seed;
+    if (cmdline.samplerType >= 0)
+      fs.samplerType = cmdline.samplerType;
+    if (cmdline.sunSampling >= 0)
+      fs.sunSampling = cmdline.sunSampling;
+    const Camera camera
+      = cmdline.haveCamera
+      ? cmdline.camera
+      : Camera::defaultFor(scene->bounds);
+    camera.setup(fs,fbSize);
+    // same defaults as the viewer
+    fs.aoSamples  = cmdline.aoSamples;
+    fs.aoRadius   = .05f*length(scene->bounds.span());
+    fs.depthScale
+      = length(camera.from - scene->bounds.center())
+      + .5f*length(scene->bounds.span());
+
+    std::vector<vec4f>    accumBuffer(fbSize.x*fbSize.y);
+    std::vector<float>    varianceBuffer(fbSize.x*fbSize.y);
+    std::vector<uint32_t> colorBuffer(fbSize.x*fbSize.y);
+
+    // rays per frame by kind, with and without russian roulette
+    std::vector<int> rouletteDepths = { -1 };
+    if (cmdline.rouletteDepth >= 0)
+      rouletteDepths.push_back(cmdline.rouletteDepth);
+    std::cout << std::setw(8) << "depth"
+              << std::setw(18) << "tracer"
+              << std::setw(10) << "roulette"
+              << std::setw(12) << "ms/frame"
+              << std::setw(10) << "median"
+              << std::setw(10) << "p95"
+              << std::setw(12) << "rays/frame"
+              << std::setw(12) << "bounce"
+              << std::setw(12) << "shadow"
+              << std::setw(12) << "rr-ended"
+              << std::setw(10) << "Mrays/s" << std::endl;
+    std::vector<std::pair<BenchRun::Config,BenchRun>> benchRuns;
+    for (int pathDepth : cmdline.pathDepths) {
+      fs.pathDepth = pathDepth;
+      for (auto tracer : tracers)
+        for (int rouletteDepth : rouletteDepths) {
+          fs.rouletteDepth = rouletteDepth;
+          // warm-up frames, so queues etc are allocated
+          for (int f=0;f<cmdline.warmupFrames;f++) {
+            fs.accumID = f;
+            tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+          }
+
+          device::RayStats stats;
+          BenchRun run;
+          run.warmupFrames    = cmdline.warmupFrames;
+          run.samplesPerPixel = cmdline.numFrames*cmdline.spp;
+          run.seed            = cmdline.seed;
+          for (int f=0;f<cmdline.numFrames;f++) {
+            fs.accumID = f;
+            const double t0 = getCurrentTime();
+            tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+            run.addFrame(getCurrentTime()-t0,tracer->rayStats.total());
+            stats += tracer->rayStats;
+          }
+          const double t = run.totalSeconds();
+          const std::string roulette
+            = rouletteDepth < 0 ? std::string("off") : std::to_string(rouletteDepth);
+          std::cout << std::setw(8) << pathDepth
+                    << std::setw(18) << tracer->name()
+                    << std::setw(10) << roulette
+                    << std::setw(12) << std::fixed << std::setprecision(2)
+                    << (1000.*t/cmdline.numFrames)
+                    << std::setw(10) << (1000.*run.percentile(50.))
+                    << std::setw(10) << (1000.*run.percentile(95.))
+                    << std::setw(12) << (stats.total()/cmdline.numFrames)
+                    << std::setw(12) << (stats.bounce/cmdline.numFrames)
+                    << std::setw(12) << (stats.shadow/cmdline.numFrames)
+                    << std::setw(12) << (stats.roulette/cmdline.numFrames)
+                    << std::setw(10) << (stats.total()/t*1e-6) << std::endl;
+          benchRuns.push_back({ {
+                { "tool",     "owlGlyphsCPUBench" },
+                { "method",   cmdline.method },
+                { "dataset",  datasetName(fileNames) },
+                { "tracer",   tracer->name() },
+                { "depth",    std::to_string(pathDepth) },
+                { "roulette", roulette },
+                { "sampler",  fs.samplerType == device::SAMPLER_SOBOL ? "sobol" : "random" },
+                { "size",     std::to_string(fbSize.x)+"x"+std::to_string(fbSize.y) },
+                { "spp",      std::to_string(cmdline.spp) } }, run });
+
+          if (!cmdline.outFileName.empty() && rouletteDepth == rouletteDepths.back())
+            savePNG(tracer->name()+"_rd"+std::to_string(pathDepth)+"_"+cmdline.outFileName,
+                    fbSize,colorBuffer);
+        }
+    }
+    fs.rouletteDepth = cmdline.rouletteDepth;
+
+    if (!cmdline.playPath.empty()) {
+      // camera path playback: every frame a fresh accumulation at
+      // the next camera on the path, as in the viewer's --play-path
+      const CameraPath path = CameraPath::load(cmdline.playPath);
+      const int numFrames = path.numFrames(cmdline.framesPerKey);
+      device::FrameState pathFs = fs;
+      auto setCamera = [&](int frame) {
+        const Camera c = path.at(frame,cmdline.framesPerKey);
+        c.setup(pathFs,fbSize);
+        pathFs.depthScale
+          = length(c.from - scene->bounds.center())
+          + .5f*length(scene->bounds.span());
+        pathFs.accumID = 0;
+      };
+      std::cout << "camera path '" << cmdline.playPath << "', "
+                << path.keys.size() << " keys, " << numFrames << " frames:" << std::endl;
+      std::cout << std::setw(8) << "depth"
+                << std::setw(18) << "tracer"
+                << std::setw(12) << "ms/frame"
+                << std::setw(10) << "median"
+                << std::setw(10) << "p95"
+                << std::setw(10) << "p99"
+                << std::setw(10) << "max"
+                << std::setw(10) << "Mrays/s" << std::endl;
+      for (int pathDepth : cmdline.pathDepths) {
+        pathFs.pathDepth = pathDepth;
+        for (auto tracer : tracers) {
+          for (int f=0;f<cmdline.warmupFrames;f++) {
+            setCamera(0);
+            tracer->render(pathFs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+          }
+          BenchRun run;
+          run.warmupFrames    = cmdline.warmupFrames;
+          run.samplesPerPixel = numFrames*cmdline.spp;
+          run.seed            = cmdline.seed;
+          for (int f=0;f<numFrames;f++) {
+            setCamera(f);
+            const double t0 = getCurrentTime();
+            tracer->render(pathFs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+            run.addFrame(getCurrentTime()-t0,tracer->rayStats.total());
+          }
+          std::cout << std::setw(8) << pathDepth
+                    << std::setw(18) << tracer->name()
+                    << std::setw(12) << std::fixed << std::setprecision(2)
+                    << (1000.*run.totalSeconds()/numFrames)
+                    << std::setw(10) << (1000.*run.percentile(50.))
+                    << std::setw(10) << (1000.*run.percentile(95.))
+                    << std::setw(10) << (1000.*run.percentile(99.))
+                    << std::setw(10) << (1000.*run.percentile(100.))
+                    << std::setw(10) << run.mraysPerSecond() << std::endl;
+          benchRuns.push_back({ {
+                { "tool",         "owlGlyphsCPUBench" },
+                { "method",       cmdline.method },
+                { "dataset",      datasetName(fileNames) },
+                { "tracer",       tracer->name() },
+                { "depth",        std::to_string(pathDepth) },
+                { "roulette",     pathFs.rouletteDepth < 0
+                                  ? std::string("off")
+                                  : std::to_string(pathFs.rouletteDepth) },
+                { "sampler",      pathFs.samplerType == device::SAMPLER_SOBOL ? "sobol" : "random" },
+                { "size",         std::to_string(fbSize.x)+"x"+std::to_string(fbSize.y) },
+                { "spp",          std::to_string(cmdline.spp) },
+                { "path",         cmdline.playPath },
+                { "framesPerKey", std::to_string(cmdline.framesPerKey) } }, run });
+        }
+      }
+    }
+
+    if (!cmdline.benchJSON.empty()) {
+      std::ofstream out(cmdline.benchJSON);
+      if (!out)
+        throw std::runtime_error("could not open '"+cmdline.benchJSON+"'");
+      out << "{ \"runs\": [" << std::endl;
+      for (size_t i=0;i<benchRuns.size();i++) {
+        benchRuns[i].second.printJSON(out,benchRuns[i].first,"  ");
+        out << (i+1 < benchRuns.size() ? "," : "") << std::endl;
+      }
+      out << "] }" << std::endl;
+    }
+
+    if (cmdline.pixelStats) {
+      // what one megakernel frame did at each depth, reduced over
+      // all pixels (see device/PixelStats.h)
+      cpu::PathTracer::SP tracer = tracers[0];
+      for (int pathDepth : cmdline.pathDepths) {
+        fs.pathDepth = pathDepth;
+        fs.accumID = 0;
+        tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+        device::PixelStatsSummary summary;
+        for (const device::PixelStats &stats : tracer->pixelStats)
+          summary.add(stats);
+        std::cout << std::endl << "counters, depth " << pathDepth << ":" << std::endl;
+        summary.print(std::cout);
+      }
+    }
+
+    if (!cmdline.shadeModes.empty()) {
+      // preview modes, against path tracing at the deepest depth
+      const char *shadeModeNames[] = { "path", "ao", "normals", "depth" };
+      fs.pathDepth = cmdline.pathDepths.back();
+      std::cout << std::endl
+                << std::setw(10) << "shading"
+                << std::setw(18) << "tracer"
+                << std::setw(12) << "ms/frame"
+                << std::setw(12) << "rays/frame" << std::endl;
+      std::vector<int> shadeModes = { device::SHADE_PATH };
+      shadeModes.insert(shadeModes.end(),cmdline.shadeModes.begin(),cmdline.shadeModes.end());
+      for (int shadeMode : shadeModes)
+        for (auto tracer : tracers) {
+          fs.shadeMode = shadeMode;
+          fs.accumID = 0;
+          tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+
+          device::RayStats stats;
+          const double t0 = getCurrentTime();
+          for (int f=0;f<cmdline.numFrames;f++) {
+            fs.accumID = f;
+            tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+            stats += tracer->rayStats;
+          }
+          const double t = getCurrentTime()-t0;
+          std::cout << std::setw(10) << shadeModeNames[shadeMode]
+                    << std::setw(18) << tracer->name()
+                    << std::setw(12) << std::fixed << std::setprecision(2)
+                    << (1000.*t/cmdline.numFrames)
+                    << std::setw(12) << (stats.total()/cmdline.numFrames) << std::endl;
+          if (!cmdline.outFileName.empty())
+            savePNG(tracer->name()+"_"+shadeModeNames[shadeMode]+"_"+cmdline.outFileName,
+                    fbSize,colorBuffer);
+        }
+      fs.shadeMode = device::SHADE_PATH;
+    }
+
+    if (cmdline.motionTargetMs > 0.f) {
+      // motion frames (one sample per block, no accumulation) at
+      // each block size, against a regular frame; then let the
+      // viewer's controller pick a block size for the target
+      fs.pathDepth = cmdline.pathDepths.back();
+      cpu::PathTracer::SP tracer = tracers[0];
+      std::cout << std::endl
+                << std::setw(10) << "block"
+                << std::setw(12) << "ms/frame"
+                << std::setw(12) << "rays/frame" << std::endl;
+      for (int scale : { 0, 1, 2, 4 }) {
+        fs.motionScale = scale;
+        fs.accumID = 0;
+        tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+
+        device::RayStats stats;
+        const double t0 = getCurrentTime();
+        for (int f=0;f<cmdline.numFrames;f++) {
+          fs.accumID = f;
+          tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+          stats += tracer->rayStats;
+        }
+        const double t = getCurrentTime()-t0;
+        std::cout << std::setw(10)
+                  << (scale == 0
+                      ? std::string("regular")
+                      : std::to_string(scale)+"x"+std::to_string(scale))
+                  << std::setw(12) << std::fixed << std::setprecision(2)
+                  << (1000.*t/cmdline.numFrames)
+                  << std::setw(12) << (stats.total()/cmdline.numFrames) << std::endl;
+        if (!cmdline.outFileName.empty())
+          savePNG(std::string("motion")+std::to_string(scale)+"_"+cmdline.outFileName,
+                  fbSize,colorBuffer);
+      }
+
+      device::MotionScaleController controller;
+      controller.targetFrameTime = 1e-3*cmdline.motionTargetMs;
+      for (int f=0;f<8;f++) {
+        fs.motionScale = controller.scale;
+        const double t0 = getCurrentTime();
+        tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+        controller.update(getCurrentTime()-t0);
+      }
+      std::cout << "block size for " << cmdline.motionTargetMs << " ms/frame: "
+                << controller.scale << "x" << controller.scale << std::endl;
+      fs.motionScale = 0;
+    }
+
+    if (cmdline.reprojectDegrees > 0.f) {
+      // accumulate --frames frames, orbit the camera around the
+      // scene center, then compare the error after each of the next
+      // --frames frames when restarting vs when starting from the
+      // reprojected history; vs a reference with --reference-spp,
+      // else estimated (which can't see reprojection errors)
+      fs.pathDepth = cmdline.pathDepths.back();
+      fs.reprojectMaxSamples = cmdline.reprojectMaxSpp;
+      cpu::PathTracer::SP tracer = tracers[0];
+      const size_t numPixels = accumBuffer.size();
+      std::vector<vec4f>           prevAccum(numPixels);
+      std::vector<float>           prevVariance(numPixels);
+      std::vector<device::Surface> prevSurfaces(numPixels), surfaces(numPixels);
+
+      fs.reproject = false;
+      tracer->startHistory(fs,fbSize,nullptr,nullptr,nullptr,
+                           prevAccum.data(),prevVariance.data(),prevSurfaces.data());
+      for (fs.accumID=1;fs.accumID<=cmdline.numFrames;fs.accumID++)
+        tracer->render(fs,fbSize,prevAccum.data(),prevVariance.data(),colorBuffer.data());
+
+      Camera moved = camera;
+      const float angle = cmdline.reprojectDegrees*float(M_PI)/180.f;
+      const vec3f axis  = normalize(moved.up);
+      const vec3f v     = moved.from - moved.at;
+      moved.from = moved.at
+        + v*cosf(angle) + cross(axis,v)*sinf(angle)
+        + axis*dot(axis,v)*(1.f-cosf(angle));
+      fs.prev_camera_screen_00   = fs.camera_screen_00;
+      fs.prev_camera_screen_du   = fs.camera_screen_du;
+      fs.prev_camera_screen_dv   = fs.camera_screen_dv;
+      fs.prev_camera_lens_center = fs.camera_lens_center;
+      moved.setup(fs,fbSize);
+
+      std::vector<float> reference;
+      if (cmdline.referenceSpp > 0) {
+        for (fs.accumID=0;fs.accumID*fs.samplesPerPixel<cmdline.referenceSpp;fs.accumID++)
+          tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+        reference.resize(numPixels);
+        for (size_t i=0;i<numPixels;i++)
+          reference[i] = device::luminance(vec3f(accumBuffer[i].x,accumBuffer[i].y,accumBuffer[i].z)) / accumBuffer[i].w;
+      }
+      auto errorOf = [&]() {
+        if (reference.empty())
+          return tracer->errorStats.meanRelativeError;
+        double sum = 0.;
+        for (size_t i=0;i<numPixels;i++) {
+          const float lum = device::luminance(vec3f(accumBuffer[i].x,accumBuffer[i].y,accumBuffer[i].z)) / accumBuffer[i].w;
+          sum += fabsf(lum-reference[i]) / max(reference[i],1e-2f);
+        }
+        return float(sum / numPixels);
+      };
+
+      std::vector<float> restartError, reprojectError;
+      for (fs.accumID=0;fs.accumID<cmdline.numFrames;fs.accumID++) {
+        tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+        restartError.push_back(errorOf());
+      }
+      fs.reproject = true;
+      const double t0 = getCurrentTime();
+      const float kept
+        = tracer->startHistory(fs,fbSize,prevAccum.data(),prevVariance.data(),prevSurfaces.data(),
+                               accumBuffer.data(),varianceBuffer.data(),surfaces.data());
+      const double reprojectTime = getCurrentTime()-t0;
+      for (fs.accumID=1;fs.accumID<=cmdline.numFrames;fs.accumID++) {
+        tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+        reprojectError.push_back(errorOf());
+      }
+      if (!cmdline.outFileName.empty())
+        savePNG("reprojected_"+cmdline.outFileName,fbSize,colorBuffer);
+      fs.reproject = false;
+
+      std::cout << std::endl << "after orbiting " << cmdline.reprojectDegrees
+                << " degrees: " << std::setprecision(1) << (100.f*kept)
+                << "% of pixels kept their history (reprojection took "
+                << std::setprecision(2) << (1000.*reprojectTime) << " ms), mean relative error "
+                << (reference.empty() ? "(estimated)" : "(vs reference)") << std::endl
+                << std::setw(8) << "frame"
+                << std::setw(12) << "restart"
+                << std::setw(12) << "reproject" << std::endl;
+      for (int f=0;f<cmdline.numFrames;f++)
+        std::cout << std::setw(8) << (f+1)
+                  << std::setw(12) << std::setprecision(5) << restartError[f]
+                  << std::setw(12) << reprojectError[f] << std::endl;
+    }
+
+    if (cmdline.targetError > 0.f) {
+      // frames until the image error drops below the target, for
+      // each sampler, with uniform and with adaptive sampling. With
+      // a reference image that's the true error; otherwise it's the
+      // variance-based estimate, which assumes independent samples,
+      // so it over-states the error of low-discrepancy samplers
+      const float threshold
+        = cmdline.adaptiveThreshold > 0.f
+        ? cmdline.adaptiveThreshold
+        : cmdline.targetError;
+      fs.pathDepth = cmdline.pathDepths.back();
+      fs.adaptiveMinSamples = cmdline.adaptiveMinSamples;
+      cpu::PathTracer::SP tracer = tracers[0];
+
+      std::vector<float> reference;
+      if (cmdline.referenceSpp > 0) {
+        fs.samplerType = device::SAMPLER_SOBOL;
+        fs.sunSampling = device::SUN_SAMPLING_MIS;
+        fs.adaptiveThreshold = 0.f;
+        const double t0 = getCurrentTime();
+        for (fs.accumID=0;fs.accumID*fs.samplesPerPixel<cmdline.referenceSpp;fs.accumID++)
+          tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+        reference.resize(accumBuffer.size());
+        for (size_t i=0;i<accumBuffer.size();i++)
+          reference[i] = device::luminance(vec3f(accumBuffer[i].x,accumBuffer[i].y,accumBuffer[i].z)) / accumBuffer[i].w;
+        std::cout << std::endl << "reference image (" << cmdline.referenceSpp
+                  << " spp) took " << prettyDouble(getCurrentTime()-t0) << "s" << std::endl;
+      }
+      /*! mean per-pixel relative error vs the reference, with the
+          same floor for dark pixels as relativeError() */
+      auto referenceError = [&]() {
+        double sum = 0.;
+        for (size_t i=0;i<reference.size();i++) {
+          const float lum = device::luminance(vec3f(accumBuffer[i].x,accumBuffer[i].y,accumBuffer[i].z)) / accumBuffer[i].w;
+          sum += fabsf(lum-reference[i]) / max(reference[i],1e-2f);
+        }
+        return float(sum / reference.size());
+      };
+
+      std::cout << std::endl << "time to mean relative error " << cmdline.targetError
+                << (reference.empty() ? " (estimated)" : " (vs reference)")
+                << ", megakernel, depth " << fs.pathDepth << std::endl;
+      std::cout << std::setw(8)  << "sun"
+                << std::setw(10) << "sampler"
+                << std::setw(18) << "sampling"
+                << std::setw(10) << "frames"
+                << std::setw(10) << "spp"
+                << std::setw(12) << "seconds"
+                << std::setw(10) << "Mrays"
+                << std::setw(12) << "error" << std::endl;
+      std::vector<int> samplers = { device::SAMPLER_RANDOM, device::SAMPLER_SOBOL };
+      if (cmdline.samplerType >= 0)
+        samplers = { cmdline.samplerType };
+      std::vector<int> sunSamplings
+        = { device::SUN_SAMPLING_BSDF, device::SUN_SAMPLING_NEE, device::SUN_SAMPLING_MIS };
+      if (cmdline.sunSampling >= 0)
+        sunSamplings = { cmdline.sunSampling };
+      for (int sunSampling : sunSamplings)
+        for (int sampler : samplers)
+          for (float adaptive : { 0.f, threshold }) {
+            fs.sunSampling = sunSampling;
+            fs.samplerType = sampler;
+            fs.adaptiveThreshold = adaptive;
+            double numSamples = 0., numRays = 0.;
+            int numFrames = 0;
+            float error = 1.f;
+            const double t0 = getCurrentTime();
+            for (fs.accumID=0;fs.accumID<100000;fs.accumID++) {
+              tracer->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+              numSamples += tracer->errorStats.samplesPerPixel;
+              numRays    += tracer->rayStats.total();
+              numFrames++;
+              error
+                = reference.empty()
+                ? tracer->errorStats.meanRelativeError
+                : referenceError();
+              if (error <= cmdline.targetError)
+                break;
+            }
+            const std::string sunName = sunSamplingNames[sunSampling];
+            const std::string samplerName
+              = sampler == device::SAMPLER_SOBOL ? "sobol" : "random";
+            const std::string name
+              = adaptive > 0.f
+              ? "adaptive("+std::to_string(adaptive).substr(0,6)+")"
+              : "uniform";
+            std::cout << std::setw(8)  << sunName
+                      << std::setw(10) << samplerName
+                      << std::setw(18) << name
+                      << std::setw(10) << numFrames
+                      << std::setw(10) << std::fixed << std::setprecision(1) << numSamples
+                      << std::setw(12) << std::setprecision(3) << (getCurrentTime()-t0)
+                      << std::setw(10) << std::setprecision(1) << (numRays*1e-6)
+                      << std::setw(12) << std::setprecision(5) << error << std::endl;
+            if (!cmdline.outFileName.empty())
+              savePNG(sunName+"_"+samplerName+(adaptive > 0.f ? "_adaptive_" : "_uniform_")
+                      +cmdline.outFileName,
+                      fbSize,colorBuffer);
+          }
+    }
+
+    if (cmdline.timesteps) {
+      // step through all timesteps with the megakernel tracer,
+      // refitting the bvh for each (setTimestep() reports times)
+      fs.pathDepth = cmdline.pathDepths.back();
+      int timestep = 1;
+      for (Glyphs::SP step = glyphs->nextTimestep; step; step = step->nextTimestep) {
+        scene->setTimestep(step);
+        const double t0 = getCurrentTime();
+        for (int f=0;f<cmdline.numFrames;f++) {
+          fs.accumID = f;
+          tracers[0]->render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+        }
+        std::cout << "timestep " << timestep++ << ": "
+                  << (1000.*(getCurrentTime()-t0)/cmdline.numFrames)
+                  << " ms/frame" << std::endl;
+      }
+    }
+    return 0;
+  }
+}
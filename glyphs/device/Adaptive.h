@@ -0,0 +1,90 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/FrameState.h"
+
+/*! per-pixel adaptive sampling, shared by raygen_program() and the
+    cpu path tracers.
+
+    Each pixel keeps the sum of its samples (rgb) and the number of
+    samples (w) in the accum buffer, plus the sum of squared sample
+    luminances in the variance buffer. From those we estimate the
+    relative standard error of the pixel's mean; pixels whose error
+    is below FrameState::adaptiveThreshold stop getting samples, and
+    those above it get up to ADAPTIVE_MAX_BOOST x samplesPerPixel per
+    frame, proportional to how far they are from converging. The
+    error estimate is maintained (and reported) whether adaptive
+    sampling is on or not, so runs with and without it can be
+    compared at equal error */
+
+namespace glyphs {
+  namespace device {
+
+    enum {
+      ADAPTIVE_MAX_BOOST = 4,
+      /*! converged pixels still get samples every this many frames:
+          the error estimate is itself noisy, and a pixel that by
+          chance missed a small bright feature (such as the sun) in
+          all of its first samples looks converged, but is not */
+      ADAPTIVE_REVISIT   = 8
+    };
+
+    /*! image-wide summary of the per-pixel error estimates, for
+        reporting time-to-error */
+    struct ErrorStats {
+      /*! mean of relativeError() over all pixels */
+      float meanRelativeError { 1.f };
+      /*! samples taken in the last frame, per pixel */
+      float samplesPerPixel   { 0.f };
+    };
+
+    /*! relative standard error of the pixel's mean luminance; 1 (ie,
+        'not converged at all') with fewer than two samples. Dark
+        pixels are measured relative to a floor of 1e-2, so they
+        don't need an infinite number of samples */
+    inline __both__ float relativeError(const vec4f &accum, float lumSqSum)
+    {
+      const float n = accum.w;
+      if (n < 2.f) return 1.f;
+      const float mean = luminance(vec3f(accum.x,accum.y,accum.z)) / n;
+      const float var  = max(0.f,lumSqSum/n - mean*mean) * (n/(n-1.f));
+      return min(1.f,sqrtf(var/n) / max(mean,1e-2f));
+    }
+
+    /*! number of samples to take for this pixel in this frame;
+        'accum' and 'lumSqSum' are the pixel's values from previous
+        frames (ignored if fs.accumID is 0) */
+    inline __both__ int adaptiveSampleCount(const FrameState &fs,
+                                            int pixelIdx,
+                                            const vec4f &accum,
+                                            float lumSqSum)
+    {
+      if (fs.adaptiveThreshold <= 0.f || fs.accumID == 0
+          || accum.w < fs.adaptiveMinSamples)
+        return fs.samplesPerPixel;
+      const float err = relativeError(accum,lumSqSum);
+      if (err <= fs.adaptiveThreshold)
+        return ((fs.accumID + pixelIdx) % ADAPTIVE_REVISIT) == 0
+          ? fs.samplesPerPixel
+          : 0;
+      const float boost = min(float(ADAPTIVE_MAX_BOOST),err/fs.adaptiveThreshold);
+      return int(ceilf(fs.samplesPerPixel*boost));
+    }
+
+  }
+}
@@ -26,6 +26,7 @@ namespace glyphs {
 
     OPTIX_INTERSECT_PROGRAM(ArrowGlyphs)()
     {
+      GLYPHS_STAT(owl::getPRD<PerRayData>().stats.counter[COUNT_INTERSECT]++);
       int primID = optixGetInstanceIndex();
 
       const auto& self
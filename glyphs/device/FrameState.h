@@ -16,7 +16,10 @@
 
 #pragma once
 
-#include "glyphs/device/common.h"
+#include "glyphs/device/Sampler.h"
+#include "glyphs/device/Sky.h"
+#include "glyphs/device/RenderVariant.h"
+#include "glyphs/device/Interactive.h"
 
 namespace glyphs {
   namespace device {
@@ -36,15 +39,75 @@ namespace glyphs {
       vec3f camera_lens_dv;
       /*! accumulation id, for progressive refinement */
       int   accumID;
-      /*! shading mode, in case we support different modes */
-      int   shadeMode { 0 };
+      /*! 0 for regular frames; else a motion frame, one sample per
+          block of this many pixels squared (see device/Interactive.h) */
+      int   motionScale { 0 };
+      /*! one of ShadeMode (see device/Preview.h) */
+      int   shadeMode { SHADE_PATH };
       /*! path tracing path depth */
       int   pathDepth { 0 };
+      /*! one of Shading; together with shadeMode and pathDepth this
+          selects the raygen program (see device/RenderVariant.h) */
+      int   shading   { SHADING_DISNEY };
       vec2i dbgPixel;
       /*! num samples per pixel */
       int   samplesPerPixel { 1 };
       bool  heatMapEnabled  { 0 };
       float heatMapScale    { 1.f };
+      /*! what the heat map shows: -1 for clock64() cycles, else one
+          of PixelCounter (needs GLYPHS_STATS, see
+          device/PixelStats.h) */
+      int   heatMapCounter  { -1 };
+      /*! adaptive sampling: pixels whose relative error estimate is
+          below this stop getting samples; 0 means 'off' (see
+          device/Adaptive.h) */
+      float adaptiveThreshold  { 0.f };
+      /*! don't trust the error estimate before this many samples */
+      int   adaptiveMinSamples { 16 };
+      /*! have raygen sum up per-pixel errors and sample counts in
+          errorStats (costs two atomics per pixel) */
+      bool  errorStatsEnabled  { 0 };
+      /*! one of SamplerType */
+      int   samplerType        { SAMPLER_SOBOL };
+      /*! one of SunSampling */
+      int   sunSampling        { SUN_SAMPLING_MIS };
+      /*! paths get russian roulette from this bounce on (survival
+          probability = max component of throughput); -1 means 'off' */
+      int   rouletteDepth      { 3 };
+      /*! have raygen count rays by kind in rayStats (costs four
+          atomics per pixel) */
+      bool  rayStatsEnabled    { 0 };
+      /*! SHADE_AO: occlusion rays per sample, and their length */
+      int   aoSamples          { 4 };
+      float aoRadius           { 1.f };
+      /*! SHADE_DEPTH: distance that maps to black */
+      float depthScale         { 1.f };
+      /*! temporal reprojection (see device/Reprojection.h): record
+          each pixel's surface on accumID 0 */
+      bool  historyEnabled     { 0 };
+      /*! ... and start that frame from the history in the other half
+          of the buffers, seen from the prev_camera_ view */
+      bool  reproject          { 0 };
+      /*! which half of the accum, variance and surface buffers is the
+          current one */
+      int   historyIndex       { 0 };
+      /*! reprojected pixels keep at most this many samples */
+      int   reprojectMaxSamples { 64 };
+      /*! accumulate into the half precision buffer rather than the
+          float4 one (see device/HalfAccum.h) */
+      bool  halfAccum          { 0 };
+      /*! raygen only accumulates; colors get written by a separate
+          display pass (display_program) when the host asks for it.
+          Motion frames always write colors */
+      bool  deferDisplay       { 0 };
+      /*! mixed into every pixel's sampler seed; 0 is the default
+          sequence, so images are reproducible either way and a
+          benchmark can pin (or vary) it explicitly */
+      uint32_t seed            { 0 };
+      vec3f prev_camera_screen_du;
+      vec3f prev_camera_screen_dv;
+      vec3f prev_camera_screen_00;
+      vec3f prev_camera_lens_center;
       DisneyMaterial material;
     };
 
@@ -0,0 +1,123 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/common.h"
+#ifdef __CUDACC__
+# include <cuda_fp16.h>
+#elif defined(__F16C__)
+# include <immintrin.h>
+#else
+# include <string.h>
+#endif
+
+/*! reduced-precision accumulation (FrameState::halfAccum): instead of
+    the float4 sum of samples and sample count (16 bytes per pixel),
+    keep the running mean as three halfs plus a 16-bit count (8
+    bytes). Code that works on sums (adaptive sampling, reprojection)
+    unpacks to the usual sum/count vec4f and packs the result back.
+
+    Halfs have 11 significant bits, and the mean gets rounded again
+    on every update, so the rounding error grows with the number of
+    frames. Up to HALF_ACCUM_MAX_COUNT samples it stays well below the
+    Monte Carlo noise at that sample count (kernelBench measures
+    both); pixels that reach it stop taking samples */
+
+namespace glyphs {
+  namespace device {
+
+    struct HalfAccum {
+      uint16_t r, g, b;
+      uint16_t count;
+    };
+
+    enum { HALF_ACCUM_MAX_COUNT = 1024 };
+
+    /*! round to nearest even; values beyond the half range are
+        clamped to the largest finite half */
+    inline __both__ uint16_t floatToHalf(float f)
+    {
+#ifdef __CUDA_ARCH__
+      return __half_as_ushort(__float2half_rn(fminf(fmaxf(f,-65504.f),65504.f)));
+#elif defined(__F16C__)
+      return _cvtss_sh(fminf(fmaxf(f,-65504.f),65504.f),_MM_FROUND_TO_NEAREST_INT);
+#else
+      uint32_t x;
+      memcpy(&x,&f,sizeof(x));
+      const uint16_t sign = uint16_t((x >> 16) & 0x8000u);
+      float abs_f = fabsf(f);
+      if (!(abs_f <= 65504.f))
+        // nan compares false, too - flush it to the max
+        abs_f = 65504.f;
+      if (abs_f < 6.103515625e-05f)
+        // subnormal: multiples of 2^-24
+        return uint16_t(sign | uint16_t(rintf(abs_f * 16777216.f)));
+      uint32_t u;
+      memcpy(&u,&abs_f,sizeof(u));
+      u += 0x00000fffu + ((u >> 13) & 1u);
+      return uint16_t(sign | ((u - (112u << 23)) >> 13));
+#endif
+    }
+
+    inline __both__ float halfToFloat(uint16_t h)
+    {
+#ifdef __CUDA_ARCH__
+      return __half2float(__ushort_as_half(h));
+#elif defined(__F16C__)
+      return _cvtsh_ss(h);
+#else
+      const uint32_t sign = uint32_t(h & 0x8000u) << 16;
+      const uint32_t exp  = (h >> 10) & 0x1fu;
+      const uint32_t mant = h & 0x3ffu;
+      if (exp == 0) {
+        const float f = mant * (1.f/16777216.f);
+        return sign ? -f : f;
+      }
+      const uint32_t x
+        = sign
+        | ((exp == 31 ? 255u : exp + 112u) << 23)
+        | (mant << 13);
+      float f;
+      memcpy(&f,&x,sizeof(f));
+      return f;
+#endif
+    }
+
+    /*! sum of samples (rgb) and their count (w) -> mean and count */
+    inline __both__ HalfAccum packAccum(const vec4f &sum)
+    {
+      HalfAccum packed;
+      const float rcp = sum.w > 0.f ? 1.f/sum.w : 0.f;
+      packed.r     = floatToHalf(sum.x*rcp);
+      packed.g     = floatToHalf(sum.y*rcp);
+      packed.b     = floatToHalf(sum.z*rcp);
+      packed.count = uint16_t(min(sum.w,float(HALF_ACCUM_MAX_COUNT)));
+      return packed;
+    }
+
+    /*! the other way around */
+    inline __both__ vec4f unpackAccum(const HalfAccum &packed)
+    {
+      const float n = float(packed.count);
+      return vec4f(halfToFloat(packed.r)*n,
+                   halfToFloat(packed.g)*n,
+                   halfToFloat(packed.b)*n,
+                   n);
+    }
+
+  }
+}
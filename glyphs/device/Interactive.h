@@ -0,0 +1,61 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/common.h"
+
+/*! 'motion frames', for while the camera moves: if
+    FrameState::motionScale is non-zero, raygen traces one sample (at
+    the block center) per block of motionScale x motionScale pixels,
+    and replicates its color over the block. Motion frames neither
+    read nor write the accumulation buffers; once the camera stops,
+    the viewer goes back to regular frames, starting at accumID 0 */
+
+namespace glyphs {
+  namespace device {
+
+    enum { MAX_MOTION_SCALE = 4 };
+
+    /*! launch size for a frame: one launch index per block */
+    inline __both__ vec2i motionLaunchDims(const vec2i &fbSize, int motionScale)
+    {
+      if (motionScale <= 1)
+        return fbSize;
+      return (fbSize + vec2i(motionScale-1)) / motionScale;
+    }
+
+    /*! picks the motion frame block size (1, 2 or 4) from how long
+        the last motion frame took: coarser if it missed the target
+        frame time, finer if a finer one (4x the pixels) would
+        likely still make it */
+    struct MotionScaleController {
+      /*! call after each motion frame */
+      inline void update(double seconds)
+      {
+        if (seconds > targetFrameTime && scale < MAX_MOTION_SCALE)
+          scale *= 2;
+        else if (scale > 1 && 4.*seconds < .8*targetFrameTime)
+          scale /= 2;
+      }
+
+      /*! in seconds; 0 means 'no motion frames' */
+      double targetFrameTime { 1./30. };
+      int    scale           { 2 };
+    };
+
+  }
+}
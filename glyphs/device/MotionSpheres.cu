@@ -27,6 +27,7 @@ namespace glyphs {
 
     OPTIX_INTERSECT_PROGRAM(MotionSpheres)()
     {
+      GLYPHS_STAT(owl::getPRD<PerRayData>().stats.counter[COUNT_INTERSECT]++);
       int primID = optixGetPrimitiveIndex();
 
       const auto& self
@@ -55,7 +56,8 @@ namespace glyphs {
       vec3f p = 0.5f*(pa+pb);
       float a = dot(normalize(va),accel); // acceleration in direction of arrow
 
-      float r = (rnd() - 0.5f);
+      // one time per path, so all spheres move consistently
+      float r = (rnd.get1D(DIM_TIME) - 0.5f);
       vec3f pc = p+r*dt*(va+r*dt*normalize(va)*a);
       vec3f normal;
       if (intersectSphere2(pc, ra, ray, tmp_hit_t, normal)) {
@@ -16,12 +16,15 @@
 
 #pragma once
 
-#include "glyphs/device/common.h"
+#include "glyphs/device/Sampler.h"
+#include "glyphs/device/PixelStats.h"
 
 namespace glyphs {
   namespace device {
     
-    typedef owl::common::LCG<16> Random;
+    /*! everything that draws random numbers goes through this; see
+        Sampler.h */
+    typedef Sampler Random;
     
     struct PerRayData {
       /*! primitive ID, -1 means 'no hit', otherwise this is either the
@@ -40,8 +43,14 @@ namespace glyphs {
       /* interpolated surface color, if available */
       vec3f color;
 
-      /* linear congruential generator */
+      /* samples for the current path */
       Random* rnd;
+
+#if GLYPHS_STATS
+      /*! what tracing this pixel's rays took; raygen copies these to
+          RayGenData::pixelStatsPtr */
+      PixelStats stats;
+#endif
     };
 
   }
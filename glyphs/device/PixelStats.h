@@ -0,0 +1,134 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/common.h"
+#include <ostream>
+#include <iomanip>
+
+/*! per-pixel work counters, for comparing glyph types and machines
+    by what got done rather than by clock64() cycles. Only compiled in
+    with the GLYPHS_STATS cmake option: without it, GLYPHS_STAT()
+    expands to nothing, PerRayData has no counters, and raygen writes
+    no per-pixel stats */
+
+#ifndef GLYPHS_STATS
+# define GLYPHS_STATS 0
+#endif
+
+#if GLYPHS_STATS
+# define GLYPHS_STAT(stmt) stmt
+#else
+# define GLYPHS_STAT(stmt)
+#endif
+
+namespace glyphs {
+  namespace device {
+
+    enum PixelCounter {
+      /*! rays by kind, as in RayStats */
+      COUNT_PRIMARY=0,
+      COUNT_BOUNCE,
+      COUNT_SHADOW,
+      /*! BVH nodes visited; cpu back-end only, RTX traversal is not
+          observable */
+      COUNT_NODES,
+      /*! intersection program invocations (on the cpu, primitive
+          tests) */
+      COUNT_INTERSECT,
+      /*! any-hit program invocations */
+      COUNT_ANY_HIT,
+      /*! f/df evaluations in the super-quadric solver, see
+          super::Hit::iterations */
+      COUNT_SOLVER,
+      NUM_PIXEL_COUNTERS
+    };
+
+    inline const char *pixelCounterName(int counter)
+    {
+      static const char *names[NUM_PIXEL_COUNTERS] = {
+        "primary",
+        "bounce",
+        "shadow",
+        "nodes",
+        "intersect",
+        "anyhit",
+        "solver"
+      };
+      return names[counter];
+    }
+
+    /*! one pixel's counters for one frame (all its samples) */
+    struct PixelStats {
+      typedef uint32_t Counter;
+
+      inline __both__ PixelStats &operator+=(const PixelStats &other)
+      {
+        for (int i=0;i<NUM_PIXEL_COUNTERS;i++)
+          counter[i] += other.counter[i];
+        return *this;
+      }
+
+      Counter counter[NUM_PIXEL_COUNTERS] {};
+    };
+
+    /*! host-side reduction of a frame's PixelStats */
+    struct PixelStatsSummary {
+      void add(const PixelStats &stats)
+      {
+        for (int i=0;i<NUM_PIXEL_COUNTERS;i++) {
+          total[i] += stats.counter[i];
+          max[i]    = std::max(max[i],stats.counter[i]);
+        }
+        numPixels++;
+      }
+
+      double perPixel(int counter) const
+      { return numPixels ? total[counter] / double(numPixels) : 0.; }
+
+      /*! per ray (of any kind) */
+      double perRay(int counter) const
+      {
+        const uint64_t numRays
+          = total[COUNT_PRIMARY]+total[COUNT_BOUNCE]+total[COUNT_SHADOW];
+        return numRays ? total[counter] / double(numRays) : 0.;
+      }
+
+      /*! one line per counter: total, mean and max per pixel, and
+          mean per ray */
+      void print(std::ostream &out) const
+      {
+        out << std::setw(12) << "counter"
+            << std::setw(14) << "total"
+            << std::setw(12) << "per pixel"
+            << std::setw(12) << "max"
+            << std::setw(12) << "per ray" << std::endl;
+        for (int i=0;i<NUM_PIXEL_COUNTERS;i++)
+          out << std::setw(12) << pixelCounterName(i)
+              << std::setw(14) << total[i]
+              << std::setw(12) << std::fixed << std::setprecision(2) << perPixel(i)
+              << std::setw(12) << max[i]
+              << std::setw(12) << perRay(i) << std::endl;
+      }
+
+      uint64_t            total[NUM_PIXEL_COUNTERS] {};
+      PixelStats::Counter max[NUM_PIXEL_COUNTERS] {};
+      size_t              numPixels { 0 };
+    };
+
+  }
+}
@@ -0,0 +1,77 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/common.h"
+
+#ifndef M_PIF
+#define M_PIF 3.14159265358979323846f
+#endif
+
+/*! preview shade modes (FrameState::shadeMode, keys 0-9 / -sm in the
+    viewer): cheap alternatives to the path tracer for interactive
+    use. All of them trace one primary ray per sample; SHADE_AO adds
+    FrameState::aoSamples short occlusion rays, which only need to
+    know whether they hit anything - on the device they terminate on
+    the first hit and skip closest-hit programs */
+
+namespace glyphs {
+  namespace device {
+
+    enum ShadeMode {
+      /*! path tracing (or local shading if pathDepth <= 1) */
+      SHADE_PATH=0,
+      /*! albedo times ambient occlusion within aoRadius */
+      SHADE_AO,
+      /*! surface normal (facing the camera), as rgb */
+      SHADE_NORMALS,
+      /*! distance to the camera, white (near) to black (depthScale) */
+      SHADE_DEPTH,
+      NUM_SHADE_MODES
+    };
+
+    /*! cosine-weighted direction around N */
+    inline __both__ vec3f cosineSampleHemisphere(const vec3f &N, const vec2f &u)
+    {
+      const vec3f v_x = normalize(fabsf(N.x) < .6f
+                                  ? cross(vec3f(1.f,0.f,0.f),N)
+                                  : cross(vec3f(0.f,1.f,0.f),N));
+      const vec3f v_y = cross(N,v_x);
+      const float r   = sqrtf(u.x);
+      const float phi = 2.f*M_PIF*u.y;
+      const float x = r*cosf(phi), y = r*sinf(phi);
+      return normalize(x*v_x + y*v_y + sqrtf(max(0.f,1.f-x*x-y*y))*N);
+    }
+
+    inline __both__ vec3f normalColor(const vec3f &N)
+    {
+      return .5f*N + vec3f(.5f);
+    }
+
+    inline __both__ vec3f depthColor(float t, float depthScale)
+    {
+      return vec3f(1.f - min(1.f,t/max(depthScale,1e-20f)));
+    }
+
+    /*! what SHADE_AO shows, given how many of the occlusion rays hit */
+    inline __both__ vec3f aoColor(const vec3f &albedo, int numOccluded, int numRays)
+    {
+      return albedo * (1.f - numOccluded/float(max(numRays,1)));
+    }
+
+  }
+}
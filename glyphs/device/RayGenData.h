@@ -18,6 +18,10 @@
 
 #include "glyphs/device/FrameState.h"
 #include "glyphs/device/GlyphsGeom.h"
+#include "glyphs/device/RayStats.h"
+#include "glyphs/device/PixelStats.h"
+#include "glyphs/device/Reprojection.h"
+#include "glyphs/device/HalfAccum.h"
 
 namespace glyphs {
   namespace device {
@@ -33,6 +37,24 @@ namespace glyphs {
 #else
       vec4f      *accumBufferPtr;
 #endif
+      /*! instead of accumBufferPtr, with FrameState::halfAccum */
+      HalfAccum  *halfAccumBufferPtr;
+      /*! per pixel: sum of squared sample luminances */
+      float      *varianceBufferPtr;
+      /*! per pixel: what its center sees; only written with
+          FrameState::historyEnabled. This and the two above have two
+          halves if temporal reprojection is on, see
+          FrameState::historyIndex */
+      Surface    *surfaceBufferPtr;
+      /*! per device: sum of per-pixel relative errors, and samples
+          taken in this frame; only written if errorStatsEnabled */
+      float      *errorStatsPtr;
+      /*! per device: rays traced in this frame; only written if
+          rayStatsEnabled */
+      RayStats   *rayStatsPtr;
+      /*! per pixel: this frame's counters; only written with
+          GLYPHS_STATS (see device/PixelStats.h) */
+      PixelStats *pixelStatsPtr;
       Link       *linkBuffer;
       FrameState *frameStateBuffer;
     };
@@ -0,0 +1,49 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/common.h"
+
+namespace glyphs {
+  namespace device {
+
+    /*! rays traced in one frame, by kind; raygen counts per pixel and
+        adds to one of these per device (if FrameState::rayStatsEnabled),
+        the cpu path tracers always count */
+    struct RayStats {
+      typedef unsigned long long Counter;
+
+      inline __both__ Counter total() const { return primary+bounce+shadow; }
+
+      inline __both__ RayStats &operator+=(const RayStats &other)
+      {
+        primary  += other.primary;
+        bounce   += other.bounce;
+        shadow   += other.shadow;
+        roulette += other.roulette;
+        return *this;
+      }
+
+      Counter primary  { 0 };
+      Counter bounce   { 0 };
+      Counter shadow   { 0 };
+      /*! paths that russian roulette terminated */
+      Counter roulette { 0 };
+    };
+
+  }
+}
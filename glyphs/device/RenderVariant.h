@@ -0,0 +1,87 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/Preview.h"
+
+/*! raygen_program() is a template over shade mode, depth class and
+    shading quality; device/common.cu instantiates one raygen program
+    per combination that makes a difference (see RenderVariant), and
+    the host launches the one that matches the frame state. So none
+    of these choices cost a per-pixel branch, and none of them needs
+    a separate build */
+
+namespace glyphs {
+  namespace device {
+
+    /*! BSDF used by the path tracer */
+    enum Shading {
+      /*! the full Disney BRDF, with next event estimation for the sun */
+      SHADING_DISNEY=0,
+      /*! lambertian only, constant sky (what the FAST_SHADING cmake
+          option used to do) */
+      SHADING_FAST
+    };
+
+    enum DepthClass {
+      /*! pathDepth <= 1: primary ray plus local shading */
+      DEPTH_LOCAL=0,
+      /*! full path tracer */
+      DEPTH_PATH
+    };
+
+    enum RenderVariant {
+      RENDER_LOCAL=0,
+      RENDER_PATH_DISNEY,
+      RENDER_PATH_FAST,
+      RENDER_AO,
+      RENDER_NORMALS,
+      RENDER_DEPTH,
+      NUM_RENDER_VARIANTS
+    };
+
+    /*! the variant for given FrameState::shadeMode, pathDepth and
+        shading */
+    inline __both__ int renderVariantOf(int shadeMode, int pathDepth, int shading)
+    {
+      switch (shadeMode) {
+      case SHADE_AO:      return RENDER_AO;
+      case SHADE_NORMALS: return RENDER_NORMALS;
+      case SHADE_DEPTH:   return RENDER_DEPTH;
+      default:
+        if (pathDepth <= 1)
+          return RENDER_LOCAL;
+        return shading == SHADING_FAST ? RENDER_PATH_FAST : RENDER_PATH_DISNEY;
+      }
+    }
+
+    /*! name of the variant's raygen program in device/common.cu */
+    inline const char *raygenProgramName(int variant)
+    {
+      static const char *names[NUM_RENDER_VARIANTS] = {
+        "raygen_local",
+        "raygen_path_disney",
+        "raygen_path_fast",
+        "raygen_ao",
+        "raygen_normals",
+        "raygen_depth"
+      };
+      return names[variant];
+    }
+
+  }
+}
@@ -0,0 +1,125 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/FrameState.h"
+
+/*! temporal reprojection, shared by raygen_program() and the cpu
+    path tracers.
+
+    With FrameState::historyEnabled, the first frame of each
+    accumulation (accumID 0) traces the pixel center and records what
+    it hits (a Surface) next to the pixel's accum/variance values;
+    accum, variance and surface buffers are double-buffered, and
+    FrameState::historyIndex says which half is current. If
+    FrameState::reproject is also set, that frame starts each pixel
+    off with the other half's sums - the history accumulated in the
+    view given by the prev_camera_ fields - at the pixel the hit
+    point projects to there, provided that pixel saw the same
+    primitive at about the same distance. Otherwise (disocclusion,
+    different glyph, miss) the pixel starts from scratch. History is
+    capped at FrameState::reprojectMaxSamples samples, so
+    view-dependent shading that no longer matches fades out */
+
+namespace glyphs {
+  namespace device {
+
+    /*! what a pixel's center sees */
+    struct Surface {
+      /*! distance to the camera */
+      float t;
+      /*! -1 for a miss; see PerRayData */
+      int   primID;
+      int   meshID;
+    };
+
+    /*! max relative depth difference for history to be accepted */
+    enum { REPROJECT_DEPTH_TOLERANCE_PERCENT = 5 };
+
+    /*! continuous pixel coordinates of world space point P in the
+        view of the prev_camera_ fields; false if it is behind that
+        camera */
+    inline __both__ bool projectToPrevPixel(const FrameState &fs,
+                                            const vec3f &P,
+                                            vec2f &pixel)
+    {
+      // P - lens center = k*(screen_00 + x*du + y*dv), solved for x
+      // and y with Cramer's rule
+      const vec3f D = P - fs.prev_camera_lens_center;
+      const vec3f &s00 = fs.prev_camera_screen_00;
+      const vec3f &du  = fs.prev_camera_screen_du;
+      const vec3f &dv  = fs.prev_camera_screen_dv;
+      const float det  = dot(du,cross(dv,s00));
+      const float k    = dot(D,cross(du,dv));
+      if (det == 0.f || k/det <= 0.f)
+        return false;
+      pixel.x = dot(D,cross(dv,s00)) / k;
+      pixel.y = dot(D,cross(s00,du)) / k;
+      return true;
+    }
+
+    /*! index of the previous view's pixel whose history can be
+        reused for a pixel that sees 'surface' at world space point
+        P, or -1 if there is none. Of the four pixel centers around
+        the projected point, takes the one that saw the same
+        primitive at the closest distance */
+    inline __both__ int reprojectedPixel(const FrameState &fs,
+                                         const vec2i &fbSize,
+                                         const Surface &surface,
+                                         const vec3f &P,
+                                         const Surface *prevSurfaces)
+    {
+      if (surface.primID < 0)
+        return -1;
+      vec2f pixel;
+      if (!projectToPrevPixel(fs,P,pixel))
+        return -1;
+      const float dist = length(P - fs.prev_camera_lens_center);
+      float bestDelta  = dist*(REPROJECT_DEPTH_TOLERANCE_PERCENT/100.f);
+      int   bestIdx    = -1;
+      const vec2i pixel0(int(floorf(pixel.x-.5f)),int(floorf(pixel.y-.5f)));
+      for (int dy=0;dy<2;dy++)
+        for (int dx=0;dx<2;dx++) {
+          const vec2i prevPixel = pixel0+vec2i(dx,dy);
+          if (prevPixel.x < 0 || prevPixel.x >= fbSize.x ||
+              prevPixel.y < 0 || prevPixel.y >= fbSize.y)
+            continue;
+          const int prevIdx = prevPixel.x+fbSize.x*prevPixel.y;
+          const Surface prev = prevSurfaces[prevIdx];
+          if (prev.primID != surface.primID || prev.meshID != surface.meshID)
+            continue;
+          const float delta = fabsf(prev.t - dist);
+          if (delta <= bestDelta) {
+            bestDelta = delta;
+            bestIdx   = prevIdx;
+          }
+        }
+      return bestIdx;
+    }
+
+    /*! scales reprojected sums down to at most maxSamples samples */
+    inline __both__ void capHistory(vec4f &accum, float &lumSqSum, int maxSamples)
+    {
+      if (accum.w <= maxSamples)
+        return;
+      const float scale = maxSamples / accum.w;
+      accum    = accum * scale;
+      lumSqSum = lumSqSum * scale;
+    }
+
+  }
+}
@@ -0,0 +1,193 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/common.h"
+
+/*! samples for one path: a point in [0,1)^n, addressed by dimension,
+    for a given pixel and sample index. Which dimension is used for
+    what is fixed (see the DIM_ enums), so the same dimensions of
+    successive samples of a pixel are well distributed w.r.t. each
+    other - which for low-discrepancy samplers is the whole point.
+
+    SAMPLER_RANDOM: independent uniform numbers (hashed from pixel,
+    sample index and dimension); same quality as the LCG this
+    replaces.
+
+    SAMPLER_SOBOL: the first two Sobol dimensions, Owen-scrambled
+    per pixel, and padded to higher dimensions by shuffling the
+    sample index per pair of dimensions (Burley, "Practical
+    Hash-based Owen Scrambling", JCGT 2020). Good 2D stratification
+    for pixel and bounce direction, progressive (any prefix of
+    samples is well distributed), and no tables.
+
+    operator() hands out successive dimensions starting from the
+    last startDimension(), so code that just draws numbers (BSDF
+    sampling etc) works with either */
+
+namespace glyphs {
+  namespace device {
+
+    enum SamplerType { SAMPLER_RANDOM=0, SAMPLER_SOBOL };
+
+    /*! dimension layout; 2D samples start at even dimensions */
+    enum {
+      /*! 2D: sub-pixel position */
+      DIM_PIXEL  = 0,
+      /*! 2D: lens position (currently unused - pinhole camera) */
+      DIM_LENS   = 2,
+      /*! 1D: time, for motion blur */
+      DIM_TIME   = 4,
+      /*! first dimension of the first bounce; see BOUNCE_DIM_ */
+      DIM_BOUNCE = 6,
+      DIMS_PER_BOUNCE = 6,
+      /*! within a bounce: 2D direction, then 1D BSDF component (as
+          drawn by operator()), 1D russian roulette, then a 2D light
+          sample */
+      BOUNCE_DIM_DIRECTION = 0,
+      BOUNCE_DIM_ROULETTE  = 3,
+      BOUNCE_DIM_LIGHT     = 4
+    };
+
+    inline __both__ uint32_t hashInt(uint32_t x)
+    {
+      // lowbias32, by Chris Wellons
+      x ^= x >> 16;
+      x *= 0x7feb352du;
+      x ^= x >> 15;
+      x *= 0x846ca68bu;
+      x ^= x >> 16;
+      return x;
+    }
+
+    inline __both__ uint32_t hashCombine(uint32_t seed, uint32_t v)
+    {
+      return hashInt(seed ^ (v + 0x9e3779b9u + (seed << 6) + (seed >> 2)));
+    }
+
+    inline __both__ uint32_t reverseBits(uint32_t x)
+    {
+#ifdef __CUDA_ARCH__
+      return __brev(x);
+#else
+      x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+      x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+      x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+      x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+      return (x >> 16) | (x << 16);
+#endif
+    }
+
+    /*! hash-based Owen scramble (Laine-Karras style permutation on
+        the reversed bits) */
+    inline __both__ uint32_t owenScramble(uint32_t x, uint32_t seed)
+    {
+      x = reverseBits(x);
+      x += seed;
+      x ^= x * 0x6c50b47cu;
+      x ^= x * 0xb82f1e52u;
+      x ^= x * 0xc7afe638u;
+      x ^= x * 0x8d22f6e6u;
+      return reverseBits(x);
+    }
+
+    /*! first two dimensions of the Sobol sequence, as 32-bit fixed
+        point: van der Corput, and the one with direction numbers
+        v_k = v_{k-1} ^ (v_{k-1} >> 1) */
+    inline __both__ void sobol2D(uint32_t index, uint32_t &x, uint32_t &y)
+    {
+      x = reverseBits(index);
+      y = 0;
+      for (uint32_t v = 0x80000000u; index; index >>= 1, v ^= v >> 1)
+        if (index & 1) y ^= v;
+    }
+
+    inline __both__ float toUnitFloat(uint32_t x)
+    {
+      // top 24 bits, so the result is < 1
+      return (x >> 8) * (1.f/float(1<<24));
+    }
+
+    struct Sampler {
+      inline __both__ Sampler() {}
+      /*! a non-zero frameSeed decorrelates whole images (see
+          FrameState::seed); 0 keeps the default per-pixel streams */
+      inline __both__ Sampler(int type, uint32_t pixelID, uint32_t sampleID,
+                              uint32_t frameSeed=0)
+        : type(type),
+          seed(frameSeed ? hashCombine(frameSeed,pixelID) : hashInt(pixelID)),
+          sampleID(sampleID)
+      {}
+
+      /*! the given dimension of this sample */
+      inline __both__ float get1D(int dim) const
+      {
+        if (type == SAMPLER_RANDOM)
+          return toUnitFloat(hashCombine(hashCombine(seed,sampleID),dim));
+        const vec2f pair = get2D(dim & ~1);
+        return (dim & 1) ? pair.y : pair.x;
+      }
+
+      /*! dimensions dim and dim+1 of this sample; 'dim' should be
+          even */
+      inline __both__ vec2f get2D(int dim) const
+      {
+        if (type == SAMPLER_RANDOM)
+          return vec2f(get1D(dim),get1D(dim+1));
+        const uint32_t pairSeed = hashCombine(seed,dim);
+        const uint32_t index = owenScramble(sampleID,pairSeed);
+        uint32_t x, y;
+        sobol2D(index,x,y);
+        return vec2f(toUnitFloat(owenScramble(x,hashCombine(pairSeed,0))),
+                     toUnitFloat(owenScramble(y,hashCombine(pairSeed,1))));
+      }
+
+      /*! have operator() continue at given dimension */
+      inline __both__ void startDimension(int dim) { nextDim = dim; }
+
+      /*! next dimension */
+      inline __both__ float operator()() { return get1D(nextDim++); }
+
+      int      type     { SAMPLER_SOBOL };
+      uint32_t seed     { 0 };
+      uint32_t sampleID { 0 };
+      int      nextDim  { 0 };
+    };
+
+    /*! russian roulette for a path that just bounced at 'depth':
+        from bounce 'rouletteDepth' on (-1 means never) the path
+        survives with probability max(throughput) (clamped to 1), and
+        survivors get their throughput divided by that, so the
+        estimate stays unbiased. Returns false if the path ends */
+    inline __both__ bool russianRoulette(int rouletteDepth,
+                                         int depth,
+                                         const Sampler &rnd,
+                                         vec3f &throughput)
+    {
+      if (rouletteDepth < 0 || depth < rouletteDepth)
+        return true;
+      const float survive
+        = min(1.f,max(throughput.x,max(throughput.y,throughput.z)));
+      const int bounceDim = DIM_BOUNCE+depth*DIMS_PER_BOUNCE;
+      if (rnd.get1D(bounceDim+BOUNCE_DIM_ROULETTE) >= survive)
+        return false;
+      throughput = throughput * (1.f/survive);
+      return true;
+    }
+
+  }
+}
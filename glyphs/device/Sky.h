@@ -0,0 +1,109 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "glyphs/device/common.h"
+
+#ifndef M_PIF
+#define M_PIF 3.14159265358979323846f
+#endif
+
+/*! the sky that bounce rays see: constant ambient, plus a small
+    bright "sun" patch - a window in theta (measured from +z) and phi.
+    Shared by pathTrace() and the cpu path tracers, which can find the
+    sun either by BSDF sampling, by sampling it directly (next event
+    estimation), or both, combined with MIS */
+
+namespace glyphs {
+  namespace device {
+
+    enum SunSampling {
+      /*! only through BSDF sampling */
+      SUN_SAMPLING_BSDF=0,
+      /*! only through shadow rays towards it */
+      SUN_SAMPLING_NEE,
+      /*! both, with power-heuristic MIS weights */
+      SUN_SAMPLING_MIS
+    };
+
+    struct Sun {
+      static __both__ float thetaLo()   { return (0.55f - 0.1f) * M_PIF; }
+      static __both__ float thetaHi()   { return (0.55f + 0.1f) * M_PIF; }
+      static __both__ float phiLo()     { return (0.75f - 0.1f) * M_PIF; }
+      static __both__ float phiHi()     { return (0.75f + 0.1f) * M_PIF; }
+      static __both__ vec3f radiance()  { return vec3f(8.f); }
+
+      /*! whether 'dir' points into the sun */
+      static __both__ bool contains(const vec3f &dir)
+      {
+        const float phi = atan2f(dir.y, dir.x);
+        const float theta = acosf(dir.z / length(dir));
+        return theta > thetaLo() && theta < thetaHi()
+          &&   phi   > phiLo()   && phi   < phiHi();
+      }
+
+      static __both__ float solidAngle()
+      {
+        return (cosf(thetaLo()) - cosf(thetaHi())) * (phiHi() - phiLo());
+      }
+
+      /*! pdf (w.r.t. solid angle) of sample() */
+      static __both__ float pdf() { return 1.f / solidAngle(); }
+
+      /*! direction uniformly distributed (in solid angle) over the
+          sun: uniform in phi and cos(theta) */
+      static __both__ vec3f sample(const vec2f &u)
+      {
+        const float phi = phiLo() + u.x * (phiHi() - phiLo());
+        const float cosTheta = cosf(thetaHi()) + u.y * (cosf(thetaLo()) - cosf(thetaHi()));
+        const float sinTheta = sqrtf(max(0.f,1.f - cosTheta*cosTheta));
+        return vec3f(sinTheta*cosf(phi), sinTheta*sinf(phi), cosTheta);
+      }
+    };
+
+    /*! radiance of the sky (ambient part) for bounce rays */
+    inline __both__ vec3f ambientSky() { return vec3f(.8f) / 2.f; }
+
+    /*! what a BSDF-sampled bounce ray that leaves the scene in
+        direction 'dir' picks up; 'bsdfPdf' is the pdf it was sampled
+        with, needed for the MIS weight */
+    inline __both__ vec3f escapedRadiance(int sunSampling,
+                                          const vec3f &dir,
+                                          float bsdfPdf)
+    {
+      if (!Sun::contains(dir))
+        return ambientSky();
+      if (sunSampling == SUN_SAMPLING_BSDF)
+        return Sun::radiance();
+      if (sunSampling == SUN_SAMPLING_NEE)
+        return vec3f(0.f);
+      const float lightPdf = Sun::pdf();
+      return Sun::radiance() * (bsdfPdf*bsdfPdf / (bsdfPdf*bsdfPdf + lightPdf*lightPdf));
+    }
+
+    /*! MIS weight for a shadow ray towards the sun whose direction
+        the BSDF would have sampled with 'bsdfPdf' */
+    inline __both__ float sunLightWeight(int sunSampling, float bsdfPdf)
+    {
+      if (sunSampling != SUN_SAMPLING_MIS)
+        return 1.f;
+      const float lightPdf = Sun::pdf();
+      return lightPdf*lightPdf / (bsdfPdf*bsdfPdf + lightPdf*lightPdf);
+    }
+
+  }
+}
@@ -30,6 +30,7 @@ namespace glyphs {
 
     OPTIX_INTERSECT_PROGRAM(SphereGlyphs)()
     {
+      GLYPHS_STAT(owl::getPRD<PerRayData>().stats.counter[COUNT_INTERSECT]++);
       int instID = optixGetInstanceIndex();
 
       const auto& self
@@ -22,6 +22,18 @@ namespace glyphs {
 
   // https://en.wikipedia.org/wiki/Superquadrics
   namespace super {
+    /*! how SuperGlyphs finds the surface; each is its own geometry
+        type and program set (see device/SuperGlyphs.cu) */
+    enum Mode {
+      /*! coarse triangle proxy, refined by the solver in any-hit */
+      MODE_PROXY=0,
+      /*! the same triangle tessellation, as the surface itself */
+      MODE_TESSELLATE,
+      /*! user geometry; the solver starts at the bounding box */
+      MODE_USER_GEOM,
+      NUM_MODES
+    };
+
     struct Quadric {
       float r, s, t;
       float A, B, C; // scaling
@@ -69,27 +81,124 @@ namespace glyphs {
              - 1.f;
     }
 
-    /*! Partial derivatives */
+    /*! Partial derivatives of f(q,pos) */
     __both__
     inline vec3f df(const Quadric& q, const vec3f& pos)
     {
         return {
-            pos.x > 0.f ? powf(pos.x/q.A,q.r-1.f) : -powf(-pos.x/q.A,q.r-1.f),
-            pos.y > 0.f ? powf(pos.y/q.B,q.r-1.f) : -powf(-pos.y/q.B,q.r-1.f),
-            pos.z > 0.f ? powf(pos.z/q.C,q.r-1.f) : -powf(-pos.z/q.C,q.r-1.f)
+            q.r/q.A * sgn(pos.x) * powf(fabsf(pos.x/q.A),q.r-1.f),
+            q.s/q.B * sgn(pos.y) * powf(fabsf(pos.y/q.B),q.s-1.f),
+            q.t/q.C * sgn(pos.z) * powf(fabsf(pos.z/q.C),q.t-1.f)
             };
     }
 
-    /*! Normal (partials w/o scale) */
+    /*! Normal (normalized gradient) */
     __both__
     inline vec3f normal(const Quadric& q, const vec3f& pos)
     {
-        vec3f n{
-            pos.x > 0.f ? powf(pos.x,q.r-1.f) : -powf(-pos.x,q.r-1.f),
-            pos.y > 0.f ? powf(pos.y,q.r-1.f) : -powf(-pos.y,q.r-1.f),
-            pos.z > 0.f ? powf(pos.z,q.r-1.f) : -powf(-pos.z,q.r-1.f)
-            };
-        return normalize(n);
+        return normalize(df(q,pos));
+    }
+
+    struct Hit {
+        float t;
+        vec3f N;
+        /*! num f/df evaluations the solver needed */
+        int   iterations;
+    };
+
+    /*! Ray/superquadric intersection, for exponents r,s,t >= 1 (ie,
+        convex superquadrics, which is all that mapToSuperQuadric()
+        creates); along the ray, f then is a convex function of t.
+
+        'tEnter' is where the ray enters a conservative proxy hull
+        (the tessellation, or just tmin); the search is clamped to
+        that and the quadric's bounding box. We first look for a
+        point inside the quadric by bisecting on the sign of the
+        directional derivative (which is monotonic), and then find
+        the root between the entry point and that inside point with
+        safeguarded Newton: Newton steps are only taken if they stay
+        in the bracket and shrink it fast enough, else we bisect. Both
+        phases are capped at the number of bisections needed to
+        reach 'tol', so the iteration count is bounded, and a miss
+        really is a miss (the ray never got inside) */
+    __both__
+    inline bool intersect(const Quadric& q,
+                          const vec3f& ori,
+                          const vec3f& dir,
+                          float tEnter,
+                          float tMax,
+                          Hit& hit,
+                          float tol = 1e-5f)
+    {
+        // ---- clamp to bounding box ----
+        float t0 = tEnter, t1 = tMax;
+        const vec3f ext(q.A,q.B,q.C);
+        for (int d=0; d<3; ++d) {
+            const float rcp = 1.f / (dir[d] == 0.f ? 1e-20f : dir[d]);
+            float tn = (-ext[d] - ori[d]) * rcp;
+            float tf = (+ext[d] - ori[d]) * rcp;
+            if (tn > tf) { const float tt = tn; tn = tf; tf = tt; }
+            t0 = fmaxf(t0,tn);
+            t1 = fminf(t1,tf);
+        }
+        hit.iterations = 0;
+        if (t0 >= t1) return false;
+
+        auto g  = [&](float t) { return f(q,ori+t*dir); };
+        auto dg = [&](float t) { return dot(df(q,ori+t*dir),dir); };
+
+        const float tolT  = tol * fmaxf(1.f,fabsf(t1));
+        const int   maxIt = 2 + 2*(int)ceilf(log2f(fmaxf(2.f,(t1-t0)/tolT)));
+
+        // ---- phase 1: find a point inside ----
+        float gLo = g(t0);
+        ++hit.iterations;
+        if (gLo <= 0.f) {
+            // entry point already on/in the surface
+            hit.t = t0;
+            hit.N = normal(q,ori+t0*dir);
+            return true;
+        }
+        float lo = t0, hi = t1, tIn = t0, gIn = gLo;
+        while (gIn > 0.f) {
+            if (hi-lo < tolT || hit.iterations >= maxIt)
+                return false;
+            tIn = .5f*(lo+hi);
+            gIn = g(tIn);
+            const float slope = dg(tIn);
+            ++hit.iterations;
+            // convex: the minimum is where the slope changes sign
+            if (slope < 0.f) lo = tIn; else hi = tIn;
+        }
+
+        // ---- phase 2: safeguarded Newton on [t0,tIn] ----
+        float a = t0, b = tIn;
+        float t = t0, gt = gLo, dgt = dg(t0);
+        float dtOld = b-a, dtLast = dtOld;
+        for (;;) {
+            float tNew;
+            const bool newtonOk
+                = dgt < 0.f
+                && (t - gt/dgt) > a && (t - gt/dgt) < b
+                && fabsf(2.f*gt) < fabsf(dtOld*dgt);
+            dtOld = dtLast;
+            if (newtonOk)
+                tNew = t - gt/dgt;
+            else
+                tNew = .5f*(a+b);
+            dtLast = fabsf(tNew-t);
+            t = tNew;
+            gt  = g(t);
+            dgt = dg(t);
+            ++hit.iterations;
+            if (gt > 0.f) a = t; else b = t;
+            if (dtLast < tolT || b-a < tolT || gt == 0.f || hit.iterations >= 2*maxIt)
+                break;
+        }
+
+        hit.t = t;
+        hit.N = normal(q,ori+t*dir);
+        return true;
     }
 
   } // ::super
@@ -22,22 +22,13 @@
 #include "glyphs/device/Camera.h"
 #include "glyphs/device/roundedCone.h"
 
-#define DBG     0
-#define NEWTON  1
-
 namespace glyphs {
   namespace device {
 
-#if TESSELLATE_SUPER_GLYPHS
-#   define SUPER_GLYPHS_MAIN OPTIX_CLOSEST_HIT_PROGRAM(SuperGlyphs)()
-#elif USER_GEOM_SUPER_GLYPHS
-#   define SUPER_GLYPHS_MAIN OPTIX_INTERSECT_PROGRAM(SuperGlyphs)()
-#else
-#   define SUPER_GLYPHS_MAIN OPTIX_ANY_HIT_PROGRAM(SuperGlyphs)()
-#endif
+    // one geometry type and program set per super::Mode; SuperGlyphs
+    // creates all three, and builds with whichever is selected
 
-#if USER_GEOM_SUPER_GLYPHS
-    OPTIX_BOUNDS_PROGRAM(SuperGlyphs)(const void* geomData,
+    OPTIX_BOUNDS_PROGRAM(SuperGlyphsUserGeom)(const void* geomData,
         box3f& primBounds,
         const int    primID)
     {
@@ -45,12 +36,14 @@ namespace glyphs {
                          vec3f(+1.f,+1.f,+1.f));
     }
 
-    OPTIX_CLOSEST_HIT_PROGRAM(SuperGlyphs)()
+    OPTIX_CLOSEST_HIT_PROGRAM(SuperGlyphsUserGeom)()
     { }
-#endif
 
+    /*! find the actual surface between where the ray enters the
+        proxy (tessellation or bounding box) and 'tMax', the closest
+        hit known so far; see super::intersect() */
     __device__
-    inline bool refine(const SuperGeomData& self, float& t, vec3f& n)
+    inline bool refine(const SuperGeomData& self, float& t, float tMax, vec3f& n)
     {
       const vec3f& rst = self.rst[0];
       const vec3f& ABC = self.ABC[0];
@@ -58,57 +51,23 @@ namespace glyphs {
 
       vec3f ori = optixGetObjectRayOrigin();
       vec3f dir = vec3f(optixGetObjectRayDirection());
-      vec3f pos = ori + dir * t;
-
-#if NEWTON
-      // Refinement with Newton's method
-      float f = super::f(sq,pos);
-      vec3f df = super::df(sq,pos);
-      t += 1e-2f;
-      for (int i=0; i<50; ++i) {
-        pos = ori + dir * t;
-        f = super::f(sq,pos);
-        df = super::df(sq,pos);
-        if (f < 1e-3f) {
-          n = super::normal(sq,pos);
-          return true;
-        }
-        float dt = .5f * (f / dot(df,dir));
-        t -= dt;
-      }
-#if DBG
-      const vec2i pixelID = owl::getLaunchIndex();
-      return pixelID.x % 2 == 0 && pixelID.y % 2 == 0;
-#else
-      return false;
-#endif
-#else
-      // Refinement with secant method
-      float f = super::f(sq,pos);
-      float t1 = t;
-      t += 1e-3f;
-      while (f > 1e-3f) {
-        float oldF = f;
-        pos = ori + dir * t;
-        f = super::f(sq,pos);
-        if (f >= oldF) {
-#if DBG
-          const vec2i pixelID = owl::getLaunchIndex();
-          return pixelID.x % 2 == 0 && pixelID.y % 2 == 0;
-#else
-          return false;
-#endif
-        }
-        float dt = (f * (t-t1)) / (f-oldF);
-        t1 = t;
-        t -= dt;
-      }
-      n = super::normal(sq,pos);
+
+      super::Hit hit;
+      const bool found = super::intersect(sq,ori,dir,t,tMax,hit);
+      GLYPHS_STAT(owl::getPRD<PerRayData>().stats.counter[COUNT_SOLVER] += hit.iterations);
+      if (!found)
+        return false;
+      t = hit.t;
+      n = hit.N;
       return true;
-#endif
     }
 
-    SUPER_GLYPHS_MAIN
+    /*! hit on the triangle tessellation; for MODE_PROXY that's only
+        where the solver starts (and a miss of the actual surface
+        gets ignored), for MODE_TESSELLATE it's the surface */
+    template<int mode>
+    __device__
+    inline void triangleHit()
     {
       PerRayData& prd = owl::getPRD<PerRayData>();
       const SuperGeomData& self = owl::getProgramData<SuperGeomData>();
@@ -116,10 +75,6 @@ namespace glyphs {
       int   primID = optixGetPrimitiveIndex();
       const vec3i index  = self.index[primID];
         
-#if USER_GEOM_SUPER_GLYPHS
-      vec3f Ng;
-      vec3f col(.5f);
-#else
       // compute normal:
       const vec3f& v1     = self.vertex[index.x];
       const vec3f& v2     = self.vertex[index.y];
@@ -134,16 +89,14 @@ namespace glyphs {
            + u * self.color[index.y]
            + v * self.color[index.z])
         : vec3f(.5f);
-#endif
 
       float t    = optixGetRayTmax();
 
-#if !USER_GEOM_SUPER_GLYPHS
-
-#if !TESSELLATE_SUPER_GLYPHS
-      if (!refine(self,t,Ng))
+      // in any-hit, the ray's tmax is this candidate's t (the proxy
+      // entry), not the closest hit so far, so it can't bound the
+      // search; the surface lies behind it
+      if (mode == super::MODE_PROXY && !refine(self,t,1e20f,Ng))
         optixIgnoreIntersection();
-#endif
 
       // Multiplication by two is an implementation detail (ignore!)
       prd.primID = optixGetInstanceIndex()*2;
@@ -152,20 +105,29 @@ namespace glyphs {
       prd.color = col;
       prd.t = t;
       prd.Ng = Ng;
-#else
-      // Guess a first root by intersecting the bounding sphere
-      // of the super quadric
-      owl::Ray ray(optixGetObjectRayOrigin(),
-                   optixGetObjectRayDirection(),
-                   optixGetRayTmin(),
-                   optixGetRayTmax());
-
-      //printf("%f %f %f  %f %f %f\n",ray.origin.x,ray.origin.y,ray.origin.z,ray.direction.x,ray.direction.y,ray.direction.z);
-      bool sph = intersectSphere2(vec3f(0.f),1.f,ray,t,Ng);
-
-      // Refine
-      if (sph) {
-        if (refine(self,t,Ng) && optixReportIntersection(t, 0)) {
+    }
+
+    OPTIX_ANY_HIT_PROGRAM(SuperGlyphsProxy)()
+    {
+      GLYPHS_STAT(owl::getPRD<PerRayData>().stats.counter[COUNT_ANY_HIT]++);
+      triangleHit<super::MODE_PROXY>();
+    }
+
+    OPTIX_CLOSEST_HIT_PROGRAM(SuperGlyphsTessellate)()
+    { triangleHit<super::MODE_TESSELLATE>(); }
+
+    OPTIX_INTERSECT_PROGRAM(SuperGlyphsUserGeom)()
+    {
+      PerRayData& prd = owl::getPRD<PerRayData>();
+      const SuperGeomData& self = owl::getProgramData<SuperGeomData>();
+      GLYPHS_STAT(prd.stats.counter[COUNT_INTERSECT]++);
+
+      vec3f Ng;
+      vec3f col(.5f);
+      // no proxy here; the solver starts from the bounding box
+      float t = optixGetRayTmin();
+      if (refine(self,t,optixGetRayTmax(),Ng) && t < optixGetRayTmax()) {
+        if (optixReportIntersection(t, 0)) {
           // Multiplication by two is an implementation detail (ignore!)
           prd.primID = optixGetInstanceIndex()*2;
           // we currently have all triangles baked into a single mesh:
@@ -175,7 +137,6 @@ namespace glyphs {
           prd.Ng = Ng;
         }
       }
-#endif
     }
 
   }
@@ -20,6 +20,7 @@
 #include "glyphs/device/Camera.h"
 #include "glyphs/device/disney_bsdf.h"
 #include "glyphs/device/TriangleMesh.h"
+#include "glyphs/device/Adaptive.h"
 
 namespace glyphs {
   namespace device {
@@ -39,6 +40,28 @@ namespace glyphs {
         (make_8bit(color.z) << 16);
     }
 
+    /*! sum of samples and their count (w) at given index of the
+        accum buffer in use (see FrameState::halfAccum) */
+    inline __device__ vec4f loadAccum(const RayGenData &self,
+                                      const FrameState &fs,
+                                      int idx)
+    {
+      if (fs.halfAccum)
+        return unpackAccum(self.halfAccumBufferPtr[idx]);
+      return (vec4f)self.accumBufferPtr[idx];
+    }
+
+    inline __device__ void storeAccum(const RayGenData &self,
+                                      const FrameState &fs,
+                                      int idx,
+                                      const vec4f &accum)
+    {
+      if (fs.halfAccum)
+        self.halfAccumBufferPtr[idx] = packAccum(accum);
+      else
+        self.accumBufferPtr[idx] = accum;
+    }
+
     inline __device__ vec3f random_in_unit_sphere(Random &rnd) {
       vec3f p;
       do {
@@ -49,9 +72,9 @@ namespace glyphs {
     
     // ------------------------------------------------------------------
     // A simple path tracer; if pathDepth <= 1 falls back to local
-    // shading.
-    // Enable FAST_SHADING via cmake option to get Lambertian
-    // instead of Disney BRDF
+    // shading. Everything that picks what a sample does (shade mode,
+    // depth class, Lambertian vs Disney BRDF) is a template
+    // parameter, see RenderVariant.h
     // ------------------------------------------------------------------
 
     inline __device__
@@ -63,53 +86,131 @@ namespace glyphs {
       return c;
     }
 
+    /*! whether anything is hit along 'ray'; terminates on the first
+        hit and skips closest-hit programs (so primID starts out as
+        'hit', and miss_program() clears it) */
+    inline __device__
+    bool occluded(const RayGenData &self,
+                  owl::Ray &ray,
+                  PerRayData &prd,
+                  RayStats &rayStats)
+    {
+      prd.primID = 0;
+      rayStats.shadow++;
+      owl::traceRay(self.world,ray,prd,
+                    OPTIX_RAY_FLAG_TERMINATE_ON_FIRST_HIT
+                    | OPTIX_RAY_FLAG_DISABLE_CLOSESTHIT);
+      return prd.primID != -1;
+    }
+
+    /*! the preview shade modes (see device/Preview.h) */
+    template<int shadeMode>
+    inline __device__
+    vec3f previewShade(const RayGenData &self,
+                       owl::Ray &ray,
+                       Random &rnd,
+                       PerRayData &prd,
+                       RayStats &rayStats)
+    {
+      const FrameState *fs = &self.frameStateBuffer[0];
+
+      prd.primID = -1;
+      rayStats.primary++;
+      owl::traceRay(self.world,ray,prd);
+      if (prd.primID < 0)
+        return missColor(ray);
+
+      vec3f N = normalize(prd.Ng);
+      if (dot(N,(vec3f)ray.direction) > 0.f)
+        N = -N;
+
+      if (shadeMode == SHADE_NORMALS)
+        return normalColor(N);
+      if (shadeMode == SHADE_DEPTH)
+        return depthColor(prd.t,fs->depthScale);
+
+      // Random colors for glyphs, grey for triangles
+      vec3f albedo = vec3f(.8f);
+      if (prd.meshID < 0) {
+        unsigned rgba = self.linkBuffer[prd.primID].col; // ignore alpha for now
+        albedo = vec3f((rgba & 0xff) / 255.f,
+                       ((rgba >> 8) & 0xff) / 255.f,
+                       ((rgba >> 16) & 0xff) / 255.f);
+      }
+      const vec3f org = ray.origin + prd.t * ray.direction;
+      int numOccluded = 0;
+      for (int i=0;i<fs->aoSamples;i++) {
+        const int dim = DIM_BOUNCE+i*DIMS_PER_BOUNCE+BOUNCE_DIM_DIRECTION;
+        owl::Ray aoRay(org,cosineSampleHemisphere(N,rnd.get2D(dim)),
+                       1e-3f,fs->aoRadius);
+        if (occluded(self,aoRay,prd,rayStats))
+          numOccluded++;
+      }
+      return aoColor(albedo,numOccluded,fs->aoSamples);
+    }
+
+    /*! DEPTH_LOCAL: primary ray plus local shading */
+    inline __device__
+    vec3f localShade(const RayGenData &self,
+                     owl::Ray &ray,
+                     PerRayData &prd,
+                     RayStats &rayStats)
+    {
+      prd.primID = -1;
+      rayStats.primary++;
+      owl::traceRay(/*accel to trace against*/self.world,
+                    /*the ray to trace*/ ray,
+                    /*prd*/prd/*,
+                            OPTIX_RAY_FLAG_DISABLE_ANYHIT*/);
+
+      if (prd.primID < 0)
+        return missColor(ray);
+        
+      vec3f N = prd.Ng;
+      if (dot(N,(vec3f)ray.direction)  > 0.f)
+        N = -N;
+      N = normalize(N);
+        
+      vec3f albedo;
+        
+      // Random colors for glyphs, grey for triangles
+      if (prd.meshID == 0) {
+        albedo = vec3f(.8f);
+      } else {
+        unsigned rgba = self.linkBuffer[prd.primID].col; // ignore alpha for now
+        albedo = vec3f((rgba & 0xff) / 255.f,
+                       ((rgba >> 8) & 0xff) / 255.f,
+                       ((rgba >> 16) & 0xff) / 255.f);
+      }
+      vec3f color = albedo * (.2f+.6f*fabsf(dot(N,(vec3f)ray.direction)));
+      return color;
+    }
+
+    /*! DEPTH_PATH: the path tracer, with given Shading */
+    template<int shading>
     inline __device__
     vec3f pathTrace(const RayGenData &self,
                     owl::Ray &ray,
                     Random &rnd,
-                    PerRayData &prd)
+                    PerRayData &prd,
+                    RayStats &rayStats)
     {
       vec3f attenuation = 1.f;
       vec3f ambientLight(.8f);
 
       const FrameState *fs = &self.frameStateBuffer[0];
       int pathDepth = fs->pathDepth;
-      
-      if (pathDepth <= 1) {
-        prd.primID = -1;
-        owl::traceRay(/*accel to trace against*/self.world,
-                      /*the ray to trace*/ ray,
-                      /*prd*/prd/*,
-                              OPTIX_RAY_FLAG_DISABLE_ANYHIT*/);
-
-        if (prd.primID < 0)
-          return missColor(ray);
-        
-        vec3f N = prd.Ng;
-        if (dot(N,(vec3f)ray.direction)  > 0.f)
-          N = -N;
-        N = normalize(N);
-        
-        vec3f albedo;
-        
-        // Random colors for glyphs, grey for triangles
-        if (prd.meshID == 0) {
-          albedo = vec3f(.8f);
-        } else {
-          unsigned rgba = self.linkBuffer[prd.primID].col; // ignore alpha for now
-          albedo = vec3f((rgba & 0xff) / 255.f,
-                        ((rgba >> 8) & 0xff) / 255.f,
-                        ((rgba >> 16) & 0xff) / 255.f);
-        }
-        vec3f color = albedo * (.2f+.6f*fabsf(dot(N,(vec3f)ray.direction)));
-        return color;
-      }
 
       // could actually swtich material based on meshID ...
       DisneyMaterial material = fs->material;
+      /*! radiance picked up so far, through shadow rays */
+      vec3f L = 0.f;
+      /*! pdf the current ray's direction was sampled with */
+      float bsdfPdf = 0.f;
       /* iterative version of recursion, up to depth 50 */
       for (int depth=0;true;depth++) {
         prd.primID = -1;
+        if (depth == 0) rayStats.primary++; else rayStats.bounce++;
         owl::traceRay(/*accel to trace against*/self.world,
                       /*the ray to trace*/ ray,
                       /*prd*/prd/*,
@@ -120,20 +221,9 @@ namespace glyphs {
           if (depth == 0)
             return missColor(ray);
 
-#if FAST_SHADING
-          return attenuation * ambientLight;
-#else
-          float phi = atan2(ray.direction.y, ray.direction.x);
-          float theta = acos(ray.direction.z / length(ray.direction));
-          const float half_width = 0.1f;
-
-          if (theta > (0.55f - half_width) * M_PIF && theta < (0.55f + half_width) * M_PIF
-              && phi > (0.75f - half_width) * M_PIF && phi < (0.75f + half_width) * M_PIF) {
-            return attenuation * owl::vec3f(8.f);
-          } else {
-            return attenuation * owl::vec3f(ambientLight / 2.f);
-          }
-#endif
+          if (shading == SHADING_FAST)
+            return L + attenuation * ambientLight;
+          return L + attenuation * escapedRadiance(fs->sunSampling,ray.direction,bsdfPdf);
         }
 
         vec3f N = normalize(prd.Ng);
@@ -154,13 +244,32 @@ namespace glyphs {
 
         owl::vec3f v_x, v_y;
         ortho_basis(v_x, v_y, N);
+        const vec3f scattered_origin    = ray.origin + prd.t * ray.direction;
+        const int   bounceDim = DIM_BOUNCE+depth*DIMS_PER_BOUNCE;
+
+        // next event estimation: shadow ray towards the sun
+        if (shading == SHADING_DISNEY
+            && depth < pathDepth && fs->sunSampling != SUN_SAMPLING_BSDF) {
+          const vec3f w_l = Sun::sample(rnd.get2D(bounceDim+BOUNCE_DIM_LIGHT));
+          const vec3f f = disney_brdf<shading>(material, N, w_o, w_l, v_x, v_y);
+          if (f != vec3f(0.f)) {
+            owl::Ray shadowRay(scattered_origin,w_l,1e-3f,1e+8f);
+            if (!occluded(self,shadowRay,prd,rayStats)) {
+              const float w = sunLightWeight(fs->sunSampling,
+                                             disney_pdf<shading>(material, N, w_o, w_l, v_x, v_y));
+              L += attenuation * f * fabsf(dot(w_l, N)) * Sun::radiance()
+                * (w / Sun::pdf());
+            }
+          }
+        }
+
         // pdf and dir are set by sampling the BRDF
         float pdf;
+        rnd.startDimension(bounceDim+BOUNCE_DIM_DIRECTION);
         vec3f scattered_direction;
-        vec3f albedo = sample_disney_brdf(material, N, w_o, v_x, v_y, rnd,
+        vec3f albedo = sample_disney_brdf<shading>(material, N, w_o, v_x, v_y, rnd,
                                           scattered_direction, pdf);
         
-        const vec3f scattered_origin    = ray.origin + prd.t * ray.direction;
         ray = owl::Ray(/* origin   : */ scattered_origin,
                        /* direction: */ scattered_direction,
                        /* tmin     : */ 1e-3f,
@@ -168,58 +277,213 @@ namespace glyphs {
 
         if (depth >= pathDepth || pdf == 0.f || albedo == owl::vec3f(0.f)) {
           // ambient term:
-          return owl::vec3f(0.f);//attenuation * ambientLight;
+          return L;//attenuation * ambientLight;
         }
 
         attenuation *= albedo * fabs(dot(scattered_direction, N)) / pdf;
+        bsdfPdf = pdf;
+
+        if (!russianRoulette(fs->rouletteDepth,depth,rnd,attenuation)) {
+          rayStats.roulette++;
+          return L;
+        }
       }
     }
 
     OPTIX_MISS_PROGRAM(miss_program)()
     {
-      /*! nothing to do - we initialize prd before trace */
+      /*! regular rays initialize prd before trace, but occluded()
+          ones start out as 'hit' */
+      owl::getPRD<PerRayData>().primID = -1;
+    }
+
+    /*! one sample of whatever the variant renders */
+    template<int shadeMode, int depthClass, int shading>
+    inline __device__
+    vec3f renderSample(const RayGenData &self,
+                       owl::Ray &ray,
+                       Random &rnd,
+                       PerRayData &prd,
+                       RayStats &rayStats)
+    {
+      if (shadeMode != SHADE_PATH)
+        return previewShade<shadeMode>(self,ray,rnd,prd,rayStats);
+      if (depthClass == DEPTH_LOCAL)
+        return localShade(self,ray,prd,rayStats);
+      return pathTrace<shading>(self,ray,rnd,prd,rayStats);
+    }
+
+    /*! first frame of an accumulation with
+        FrameState::historyEnabled: records what the pixel center
+        sees and, with FrameState::reproject, returns the history to
+        start from in 'accum' and 'lumSqSum' (see
+        device/Reprojection.h) */
+    inline __device__ void startHistory(const RayGenData &self,
+                                        const FrameState &fs,
+                                        const vec2i &pixelID,
+                                        vec4f &accum,
+                                        float &lumSqSum,
+                                        PerRayData &prd,
+                                        RayStats &rayStats)
+    {
+      const int numPixels = self.fbSize.x*self.fbSize.y;
+      const int pixelIdx  = pixelID.x+self.fbSize.x*pixelID.y;
+      const int current   = fs.historyIndex*numPixels;
+      const int prev      = (1-fs.historyIndex)*numPixels;
+
+      Random rnd(fs.samplerType,pixelIdx,0,fs.seed);
+      prd.rnd = &rnd;
+      prd.primID = -1;
+      owl::Ray ray = Camera::generateRay(fs,vec2f(pixelID)+vec2f(.5f),rnd);
+      rayStats.primary++;
+      owl::traceRay(self.world,ray,prd);
+
+      Surface surface;
+      surface.t      = prd.t;
+      surface.primID = prd.primID;
+      surface.meshID = prd.meshID;
+      self.surfaceBufferPtr[current+pixelIdx] = surface;
+      if (!fs.reproject || fs.heatMapEnabled)
+        return;
+
+      const vec3f P = ray.origin + prd.t * ray.direction;
+      const int prevIdx
+        = reprojectedPixel(fs,vec2i(self.fbSize),surface,P,
+                           self.surfaceBufferPtr+prev);
+      if (prevIdx < 0)
+        return;
+      // multi-gpu: each device only has its own columns' history
+      if ((((prevIdx % self.fbSize.x)/32) % self.deviceCount) != self.deviceIndex)
+        return;
+      accum    = loadAccum(self,fs,prev+prevIdx);
+      lumSqSum = self.varianceBufferPtr[prev+prevIdx];
+      capHistory(accum,lumSqSum,fs.reprojectMaxSamples);
+    }
+
+    /*! a motion frame (FrameState::motionScale > 0): one sample at
+        the center of the launch index's block of pixels, replicated
+        over the block; no accumulation, adaptive sampling or heat
+        map */
+    template<int shadeMode, int depthClass, int shading>
+    inline __device__ void motionFrame(const RayGenData &self,
+                                       const FrameState &fs,
+                                       const vec2i &blockID)
+    {
+      const int   scale  = fs.motionScale;
+      const vec2i pixel0 = blockID*scale;
+      if (pixel0.x >= self.fbSize.x) return;
+      if (pixel0.y >= self.fbSize.y) return;
+
+      // blocks never straddle the 32-pixel columns of multi-gpu
+      if (((pixel0.x/32) % self.deviceCount) != self.deviceIndex)
+        return;
+
+      PerRayData prd;
+      RayStats   rayStats;
+      // same sample every frame, so the image doesn't flicker
+      Random rnd(fs.samplerType,pixel0.x+self.fbSize.x*pixel0.y,0,fs.seed);
+      prd.rnd = &rnd;
+      const vec2f pixelSample = vec2f(pixel0) + vec2f(.5f*scale);
+      owl::Ray ray = Camera::generateRay(fs, pixelSample, rnd);
+      const vec3f sample
+        = renderSample<shadeMode,depthClass,shading>(self,ray,rnd,prd,rayStats);
+
+      if (fs.rayStatsEnabled) {
+        RayStats &stats = self.rayStatsPtr[self.deviceIndex];
+        atomicAdd(&stats.primary, rayStats.primary);
+        atomicAdd(&stats.bounce,  rayStats.bounce);
+        atomicAdd(&stats.shadow,  rayStats.shadow);
+        atomicAdd(&stats.roulette,rayStats.roulette);
+      }
+
+      const uint32_t rgba = make_rgba8(vec4f(sample,1.f));
+      const int endX = min(pixel0.x+scale,(int)self.fbSize.x);
+      const int endY = min(pixel0.y+scale,(int)self.fbSize.y);
+      for (int y=pixel0.y;y<endY;y++)
+        for (int x=pixel0.x;x<endX;x++)
+          self.colorBufferPtr[x+self.fbSize.x*y] = rgba;
     }
 
     /*! the actual ray generation program - note this has no formal
       function parameters, but gets its paramters throught the 'pixelID'
-      and 'pixelBuffer' variables/buffers declared above */
-    OPTIX_RAYGEN_PROGRAM(raygen_program)()
+      and 'pixelBuffer' variables/buffers declared above; instantiated
+      once per RenderVariant below */
+    template<int shadeMode, int depthClass, int shading>
+    inline __device__ void raygen_program()
     {
       const RayGenData &self = owl::getProgramData<RayGenData>();
       const vec2i pixelID = owl::getLaunchIndex();
       const vec2i launchDim = owl::getLaunchDims();
+      const FrameState *fs = &self.frameStateBuffer[0];
+
+      if (fs->motionScale > 0) {
+        motionFrame<shadeMode,depthClass,shading>(self,*fs,pixelID);
+        return;
+      }
   
       if (pixelID.x >= self.fbSize.x) return;
       if (pixelID.y >= self.fbSize.y) return;
       const int pixelIdx = pixelID.x+self.fbSize.x*pixelID.y;
+      // accum and variance of this pixel, in the current half of the
+      // buffers if they are double-buffered for reprojection
+      const int bufferIdx
+        = pixelIdx + fs->historyIndex*self.fbSize.x*self.fbSize.y;
 
       // for multi-gpu: only render every deviceCount'th column of 32 pixels:
       if (((pixelID.x/32) % self.deviceCount) != self.deviceIndex)
         return;
       
       uint64_t clock_begin = clock64();
-      const FrameState *fs = &self.frameStateBuffer[0];
       int pixel_index = pixelID.y * launchDim.x + pixelID.x;
       vec4f col(0.f);
-      Random rnd(pixel_index,
-                 fs->accumID
-                 );
 
       PerRayData prd;
-      prd.rnd = &rnd;
+      RayStats   rayStats;
+
+      // accum holds the sum of all samples so far (and their count
+      // in w), so pixels can take different numbers of samples
+      vec4f accum    = 0.f;
+      float lumSqSum = 0.f;
+      if (fs->accumID > 0) {
+        accum    = loadAccum(self,*fs,bufferIdx);
+        lumSqSum = self.varianceBufferPtr[bufferIdx];
+      }
+      else if (fs->historyEnabled)
+        startHistory(self,*fs,pixelID,accum,lumSqSum,prd,rayStats);
+      const int numSamples
+        = (fs->halfAccum && accum.w >= HALF_ACCUM_MAX_COUNT)
+        ? 0
+        : fs->heatMapEnabled
+        ? fs->samplesPerPixel
+        : adaptiveSampleCount(*fs,pixelIdx,accum,lumSqSum);
 
-      for (int s = 0; s < fs->samplesPerPixel; s++) {
-        vec2f pixelSample = vec2f(pixelID) + vec2f(rnd(),rnd());
-        float u = float(pixelID.x + rnd());
-        float v = float(pixelID.y + rnd());
+      for (int s = 0; s < numSamples; s++) {
+        // index by samples taken so far, so low-discrepancy samplers
+        // see a contiguous sequence even with adaptive sampling
+        Random rnd(fs->samplerType,pixel_index,uint32_t(accum.w)+s,fs->seed);
+        prd.rnd = &rnd;
+        vec2f pixelSample = vec2f(pixelID) + rnd.get2D(DIM_PIXEL);
         owl::Ray ray = Camera::generateRay(*fs, pixelSample, rnd);
-        col += vec4f(pathTrace(self,ray,rnd,prd),1);
+        const vec3f sample
+          = renderSample<shadeMode,depthClass,shading>(self,ray,rnd,prd,rayStats);
+        col += vec4f(sample,1);
+        lumSqSum += luminance(sample)*luminance(sample);
       }
-      col = col / float(fs->samplesPerPixel);
 
       uint64_t clock_end = clock64();
+#if GLYPHS_STATS
+      prd.stats.counter[COUNT_PRIMARY] = PixelStats::Counter(rayStats.primary);
+      prd.stats.counter[COUNT_BOUNCE]  = PixelStats::Counter(rayStats.bounce);
+      prd.stats.counter[COUNT_SHADOW]  = PixelStats::Counter(rayStats.shadow);
+      self.pixelStatsPtr[pixelIdx] = prd.stats;
+#endif
       if (fs->heatMapEnabled) {
-        float t = (clock_end-clock_begin)*fs->heatMapScale;
+        uint64_t work = clock_end-clock_begin;
+#if GLYPHS_STATS
+        if (fs->heatMapCounter >= 0)
+          work = prd.stats.counter[fs->heatMapCounter];
+#endif
+        float t = work*fs->heatMapScale;
         if (t >= 256.f*256.f*256.f)
           col = vec4f(1,0,0,1);
         else {
@@ -227,16 +491,70 @@ namespace glyphs {
           col.x = ((ti >> 16) & 255)/255.f;
           col.y = ((ti >> 8) & 255)/255.f;
           col.z = ((ti >> 0) & 255)/255.f;
+          col.w = 1.f;
         }
       }
     
-      if (fs->accumID > 0)
-        col = col + (vec4f)self.accumBufferPtr[pixelIdx];
-      self.accumBufferPtr[pixelIdx] = col;
+      col = col + accum;
+      storeAccum(self,*fs,bufferIdx,col);
+      self.varianceBufferPtr[bufferIdx] = lumSqSum;
+
+      if (fs->errorStatsEnabled) {
+        // one pair of counters per device, the host sums them up
+        float *stats = self.errorStatsPtr + 2*self.deviceIndex;
+        atomicAdd(&stats[0],relativeError(col,lumSqSum));
+        atomicAdd(&stats[1],float(numSamples));
+      }
+      if (fs->rayStatsEnabled) {
+        RayStats &stats = self.rayStatsPtr[self.deviceIndex];
+        atomicAdd(&stats.primary, rayStats.primary);
+        atomicAdd(&stats.bounce,  rayStats.bounce);
+        atomicAdd(&stats.shadow,  rayStats.shadow);
+        atomicAdd(&stats.roulette,rayStats.roulette);
+      }
+
+      if (!fs->deferDisplay) {
+        uint32_t rgba = make_rgba8(col / max(col.w,1.f));
+        self.colorBufferPtr[pixelIdx] = rgba;
+      }
+    }
+
+    /*! the display pass, for FrameState::deferDisplay: the current
+        accumulation to RGBA8 */
+    OPTIX_RAYGEN_PROGRAM(display_program)()
+    {
+      const RayGenData &self = owl::getProgramData<RayGenData>();
+      const vec2i pixelID = owl::getLaunchIndex();
+      if (pixelID.x >= self.fbSize.x) return;
+      if (pixelID.y >= self.fbSize.y) return;
+      if (((pixelID.x/32) % self.deviceCount) != self.deviceIndex)
+        return;
 
-      uint32_t rgba = make_rgba8(col / (fs->accumID+1.f));
-      self.colorBufferPtr[pixelIdx] = rgba;
+      const FrameState *fs = &self.frameStateBuffer[0];
+      const int pixelIdx = pixelID.x+self.fbSize.x*pixelID.y;
+      const vec4f col
+        = loadAccum(self,*fs,pixelIdx + fs->historyIndex*self.fbSize.x*self.fbSize.y);
+      self.colorBufferPtr[pixelIdx] = make_rgba8(col / max(col.w,1.f));
     }
+
+    // one raygen per RenderVariant; names must match raygenProgramName()
+    OPTIX_RAYGEN_PROGRAM(raygen_local)()
+    { raygen_program<SHADE_PATH,DEPTH_LOCAL,SHADING_DISNEY>(); }
+
+    OPTIX_RAYGEN_PROGRAM(raygen_path_disney)()
+    { raygen_program<SHADE_PATH,DEPTH_PATH,SHADING_DISNEY>(); }
+
+    OPTIX_RAYGEN_PROGRAM(raygen_path_fast)()
+    { raygen_program<SHADE_PATH,DEPTH_PATH,SHADING_FAST>(); }
+
+    OPTIX_RAYGEN_PROGRAM(raygen_ao)()
+    { raygen_program<SHADE_AO,DEPTH_LOCAL,SHADING_DISNEY>(); }
+
+    OPTIX_RAYGEN_PROGRAM(raygen_normals)()
+    { raygen_program<SHADE_NORMALS,DEPTH_LOCAL,SHADING_DISNEY>(); }
+
+    OPTIX_RAYGEN_PROGRAM(raygen_depth)()
+    { raygen_program<SHADE_DEPTH,DEPTH_LOCAL,SHADING_DISNEY>(); }
  
   }
 }
@@ -43,5 +43,9 @@ namespace glyphs {
   };
 
   namespace device {
+    inline __both__ float luminance(const vec3f &c)
+    {
+      return .2126f*c.x + .7152f*c.y + .0722f*c.z;
+    }
   }
 }
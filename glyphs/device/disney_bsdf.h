@@ -25,6 +25,7 @@
 #endif
 
 #include "common.h"
+#include "RenderVariant.h"
 
 namespace glyphs {
 namespace device {
@@ -43,10 +44,6 @@ __device__ owl::vec3f lerp(const owl::vec3f x, const owl::vec3f &y, float s) {
 	return x * (1.f - s) + y * s;
 }
 
-__device__ float luminance(const owl::vec3f &c) {
-	return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
-}
-
 __device__ owl::vec3f reflect(const owl::vec3f &i, const owl::vec3f &n) {
 	return i - 2.f * n * dot(i, n);
 }
@@ -265,12 +262,13 @@ __device__ float gtr_2_aniso_pdf(const owl::vec3f &w_o, const owl::vec3f &w_i, c
 	return d * cos_theta_h / (4.f * dot(w_o, w_h));
 }
 
+template<int shading = SHADING_DISNEY>
 __device__ owl::vec3f disney_diffuse(const DisneyMaterial &mat, const owl::vec3f &n,
 	const owl::vec3f &w_o, const owl::vec3f &w_i)
 {
-#if FAST_SHADING
-    return mat.base_color * M_1_PIF;
-#else
+	if (shading == SHADING_FAST)
+		return mat.base_color * M_1_PIF;
+
 	owl::vec3f w_h = normalize(w_i + w_o);
 	float n_dot_o = fabs(dot(w_o, n));
 	float n_dot_i = fabs(dot(w_i, n));
@@ -279,7 +277,6 @@ __device__ owl::vec3f disney_diffuse(const DisneyMaterial &mat, const owl::vec3f
 	float fi = schlick_weight(n_dot_i);
 	float fo = schlick_weight(n_dot_o);
 	return mat.base_color * M_1_PIF * lerp(1.f, fd90, fi) * lerp(1.f, fd90, fo);
-#endif
 }
 
 __device__ owl::vec3f disney_microfacet_isotropic(const DisneyMaterial &mat, const owl::vec3f &n,
@@ -365,12 +362,13 @@ __device__ owl::vec3f disney_sheen(const DisneyMaterial &mat, const owl::vec3f &
 	return f * mat.sheen * sheen_color;
 }
 
+template<int shading = SHADING_DISNEY>
 __device__ owl::vec3f disney_brdf(const DisneyMaterial &mat, const owl::vec3f &n,
 	const owl::vec3f &w_o, const owl::vec3f &w_i, const owl::vec3f &v_x, const owl::vec3f &v_y)
 {
-#if FAST_SHADING
-	return disney_diffuse(mat, n, w_o, w_i);
-#endif
+	if (shading == SHADING_FAST)
+		return disney_diffuse<shading>(mat, n, w_o, w_i);
+
 	if (!same_hemisphere(w_o, w_i, n)) {
 		if (mat.specular_transmission > 0.f) {
 			owl::vec3f spec_trans = disney_microfacet_transmission_isotropic(mat, n, w_o, w_i);
@@ -391,12 +389,13 @@ __device__ owl::vec3f disney_brdf(const DisneyMaterial &mat, const owl::vec3f &n
 	return (diffuse + sheen) * (1.f - mat.metallic) * (1.f - mat.specular_transmission) + gloss + coat;
 }
 
+template<int shading = SHADING_DISNEY>
 __device__ float disney_pdf(const DisneyMaterial &mat, const owl::vec3f &n,
 	const owl::vec3f &w_o, const owl::vec3f &w_i, const owl::vec3f &v_x, const owl::vec3f &v_y)
 {
-#if FAST_SHADING
-    return lambertian_pdf(w_i, n);
-#else
+	if (shading == SHADING_FAST)
+		return lambertian_pdf(w_i, n);
+
 	float alpha = max(0.001f, mat.roughness * mat.roughness);
 	float aspect = sqrt(1.f - mat.anisotropy * 0.9f);
 	owl::vec2f alpha_aniso = owl::vec2f(max(0.001f, alpha / aspect), max(0.001f, alpha * aspect));
@@ -419,22 +418,32 @@ __device__ float disney_pdf(const DisneyMaterial &mat, const owl::vec3f &n,
 		microfacet_transmission = gtr_2_transmission_pdf(w_o, w_i, n, alpha, mat.ior);
 	}
 	return (diffuse + microfacet + microfacet_transmission + clear_coat) / n_comp;
-#endif
 }
 
 /* Sample a component of the Disney BRDF, returns the sampled BRDF color,
  * ray reflection direction (w_i) and sample PDF.
  */
+template<int shading = SHADING_DISNEY>
 __device__ owl::vec3f sample_disney_brdf(const DisneyMaterial &mat, const owl::vec3f &n,
 	const owl::vec3f &w_o, const owl::vec3f &v_x, const owl::vec3f &v_y, Random &rng,
 	owl::vec3f &w_i, float &pdf)
 {
-#if FAST_SHADING
-	owl::vec2f samples = owl::vec2f(rng(), rng());
-    w_i = sample_lambertian_dir(n, v_x, v_y, samples);
-	pdf = lambertian_pdf(w_i, n);
-	return disney_diffuse(mat, n, w_o, w_i);
-#else
+	if (shading == SHADING_FAST) {
+		// two statements: argument evaluation order is unspecified
+		const float u = rng();
+		const float v = rng();
+		owl::vec2f samples = owl::vec2f(u, v);
+		w_i = sample_lambertian_dir(n, v_x, v_y, samples);
+		pdf = lambertian_pdf(w_i, n);
+		return disney_diffuse<shading>(mat, n, w_o, w_i);
+	}
+
+	// direction sample first, so it gets a 2D pair of sampler
+	// dimensions (see Sampler.h): u from the first, v from the second
+	const float u = rng();
+	const float v = rng();
+	owl::vec2f samples = owl::vec2f(u, v);
+
 	int component = 0;
 	if (mat.specular_transmission == 0.f) {
 		component = rng() * 3.f;
@@ -443,8 +452,6 @@ __device__ owl::vec3f sample_disney_brdf(const DisneyMaterial &mat, const owl::v
 		component = rng() * 4.f;
 		component = clamp(component, 0, 3);
 	}
-
-	owl::vec2f samples = owl::vec2f(rng(), rng());
 	if (component == 0) {
 		// Sample diffuse component
 		w_i = sample_lambertian_dir(n, v_x, v_y, samples);
@@ -496,7 +503,6 @@ __device__ owl::vec3f sample_disney_brdf(const DisneyMaterial &mat, const owl::v
 	}
 	pdf = disney_pdf(mat, n, w_o, w_i, v_x, v_y);
 	return disney_brdf(mat, n, w_o, w_i, v_x, v_y);
-#endif
 }
 
 }
@@ -17,12 +17,13 @@
 namespace glyphs {
   namespace device {
 
-    inline __device__
+    inline __both__
     float sign(float& val)
     {
       return val < 0.0f ? -1.0f : 1.0;
     }
 
+#ifdef __CUDA_ARCH__
     inline __device__
     int32_t make_8bit(const float f)
     {
@@ -64,11 +65,20 @@ namespace glyphs {
       } while (dot(p, p) >= 1.0f);
       return p;
     }
+#endif
 
-    inline __device__
+    // ------------------------------------------------------------------
+    // The intersectors below are templated over the ray type so that
+    // both the device programs (owl::Ray) and the host-side renderer
+    // in cpu/ (cpu::Ray) can use them; a ray type only needs
+    // origin, direction, tmin and tmax members.
+    // ------------------------------------------------------------------
+
+    template<typename RayT>
+    inline __both__
     bool intersectSphere2(const vec3f   pa,
                           const float   ra,
-                          owl::Ray ray,
+                          RayT ray,
                           float& hit_t,
                           vec3f& isec_normal)
     {
@@ -84,19 +94,21 @@ namespace glyphs {
       if (discriminant < 0.f) return false;
 
       {
-        float temp = (-b - sqrtf(discriminant)) / a + minDist;
-        if (temp < hit_t && temp > ray.tmin) {
-          hit_t = temp;
-          isec_normal = ray.origin + hit_t * ray.direction - pa;
+        float temp = (-b - sqrtf(discriminant)) / a;
+        if (temp + minDist < hit_t && temp + minDist > ray.tmin) {
+          hit_t = temp + minDist;
+          // ray.origin already got moved by minDist
+          isec_normal = ray.origin + temp * ray.direction - pa;
           return true;
         }
       }
 
       {
-        float temp = (-b + sqrtf(discriminant)) / a + minDist;
-        if (temp < hit_t && temp > ray.tmin) {
-          hit_t = temp;
-          isec_normal = ray.origin + hit_t * ray.direction - pa;
+        float temp = (-b + sqrtf(discriminant)) / a;
+        if (temp + minDist < hit_t && temp + minDist > ray.tmin) {
+          hit_t = temp + minDist;
+          // ray.origin already got moved by minDist
+          isec_normal = ray.origin + temp * ray.direction - pa;
           return true;
         }
       }
@@ -107,8 +119,9 @@ namespace glyphs {
     // Haines, Gunther (2019): Precision Improvements for Ray/Sphere Intersection
     // in: Ray Tracing Gems
     // https://link.springer.com/content/pdf/10.1007%2F978-1-4842-4427-2_7.pdf
-    inline __device__
-    bool intersectInstanceSphereRTGem(vec3f pa, float ra, owl::Ray ray, float& hit_t, vec3f& isec_normal)
+    template<typename RayT>
+    inline __both__
+    bool intersectInstanceSphereRTGem(vec3f pa, float ra, RayT ray, float& hit_t, vec3f& isec_normal)
     {
       vec3f d = ray.direction;
       vec3f f = ray.origin; // sphere origin (0,0,0)
@@ -141,12 +154,13 @@ namespace glyphs {
 
     /*! ray-cylinder intersector from shadertoy.com/view/4lcSRn */
     /*! author: Inigo Quilez (2016), license is MIT */
-    inline __device__ bool intersectCylinder(const vec3f   pa,
-                                             const vec3f   pb,
-                                             const float   ra,
-                                             const owl::Ray ray,
-                                             float &hit_t,
-                                             vec3f &isec_normal)
+    template<typename RayT>
+    inline __both__ bool intersectCylinder(const vec3f   pa,
+                                           const vec3f   pb,
+                                           const float   ra,
+                                           const RayT    ray,
+                                           float &hit_t,
+                                           vec3f &isec_normal)
     {
       const vec3f  ba = pb - pa;  
       const vec3f  oc = ray.origin - pa;
@@ -176,7 +190,7 @@ namespace glyphs {
 
       // caps
       t = ( ((y<0.0) ? 0.0 : baba) - baoc)/bard;
-      if( abs(k1+k2*t)<h && t > ray.tmin)
+      if( fabsf(k1+k2*t)<h && t > ray.tmin)
         {
           hit_t = t;
           isec_normal =  ba*sign(y);
@@ -189,11 +203,12 @@ namespace glyphs {
 
     /* ray - rounded cone intersection from https://www.shadertoy.com/view/MlKfzm */
     /*! author: Inigo Quilez (2018), license is MIT */
-    inline __device__
+    template<typename RayT>
+    inline __both__
     bool intersectRoundedCone(
                               const vec3f  pa, const vec3f  pb,
                               const float  ra, const float  rb,
-                              const owl::Ray ray,
+                              const RayT   ray,
                               float& hit_t,
                               vec3f& isec_normal)
     {
@@ -231,7 +246,8 @@ namespace glyphs {
         }
       }
 
-      // Caps. 
+      // Caps; take the closer of the two, as in the original
+      bool  hit = false;
       float h1 = m3 * m3 - m5 + ra * ra;
       if (h1 > 0.0f) {
         float t = -m3 - sqrtf(h1);
@@ -239,20 +255,20 @@ namespace glyphs {
         {
           hit_t = t;
           isec_normal = oa + t * rd;
-          return true;
+          hit = true;
         }
       }
       float h2 = m6 * m6 - m7 + rb * rb;
       if( h2>0.0f )
         {
           float t = -m6 - sqrtf( h2 );
-          if (t > ray.tmin) {
+          if (t > ray.tmin && (!hit || t < hit_t)) {
             hit_t = t;
-            isec_normal = oa + t * rd;
-            return true;
+            isec_normal = ob + t * rd;
+            hit = true;
           }
         }
-      return false;
+      return hit;
     }
     
   }
@@ -0,0 +1,361 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! writes synthetic glyph datasets for scaling studies - uniformly
+    random, clustered, streamline-like chains of links, or a vector
+    field on a grid - as ascii '.glyphs' or binary '.bglyphs' (see
+    BinaryGlyphsHeader). Each item (a glyph, or a chain) only depends
+    on the seed and its index, so a given cmdline always writes the
+    same file, however many threads generate it */
+
+#include "glyphs/Glyphs.h"
+#include <owl/common/parallel/parallel_for.h>
+// std
+#include <fstream>
+#include <limits>
+
+namespace glyphs {
+
+  enum Pattern { UNIFORM=0, CLUSTERED, CHAINS, GRID, NUM_PATTERNS };
+
+  const char *patternNames[NUM_PATTERNS]
+  = { "uniform", "clustered", "chains", "grid" };
+
+  struct {
+    int pattern = UNIFORM;
+    size_t numGlyphs = 1000;
+    uint64_t seed = 1;
+    std::string outFileName;
+    /*! CHAINS: links per chain */
+    int chainLength = 32;
+    /*! CLUSTERED: 0 means one per 10K glyphs */
+    size_t numClusters = 0;
+    float glyphLength = .8f;
+    /*! only '.bglyphs' store it; '.glyphs' always load with 0.2 */
+    float radius = .2f;
+  } cmdline;
+
+  void usage(const std::string &msg)
+  {
+    if (msg != "") std::cerr << "Error: " << msg << std::endl << std::endl;
+    std::cout << "Usage: ./owlGlyphsGen -o <file.glyphs|file.bglyphs>"
+              << " [--pattern uniform|clustered|chains|grid] [-n <count>[K|M|B]]"
+              << " [--seed <n>] [--chain-length <n>] [--clusters <n>]"
+              << " [--length <f>] [--radius <f>]"
+              << std::endl;
+    exit(msg != "");
+  }
+
+  /*! '10K', '2M', '1B' (or '1G') */
+  size_t parseCount(const std::string &s)
+  {
+    size_t end = 0;
+    const double value = std::stod(s,&end);
+    const std::string suffix = s.substr(end);
+    double scale = 1.;
+    if (suffix == "k" || suffix == "K") scale = 1e3;
+    else if (suffix == "m" || suffix == "M") scale = 1e6;
+    else if (suffix == "b" || suffix == "B" || suffix == "g" || suffix == "G") scale = 1e9;
+    else if (suffix != "") usage("bad count '"+s+"'");
+    return size_t(value*scale+.5);
+  }
+
+  /*! counter-based random numbers: a splitmix64 stream for each
+      (seed,item), so items can be generated in any order */
+  struct Random {
+    Random(uint64_t seed, uint64_t item)
+      : state(mix(seed ^ mix(item + 0x9e3779b97f4a7c15ull)))
+    {}
+
+    static uint64_t mix(uint64_t z)
+    {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+    }
+
+    /*! in [0,1) */
+    float operator()()
+    {
+      state += 0x9e3779b97f4a7c15ull;
+      return (mix(state) >> 40) * (1.f/float(1<<24));
+    }
+
+    /*! in [0,1)^3 */
+    vec3f point()
+    {
+      const float x = (*this)();
+      const float y = (*this)();
+      const float z = (*this)();
+      return vec3f(x,y,z);
+    }
+
+    /*! uniform on the unit sphere */
+    vec3f direction()
+    {
+      const float z   = 1.f - 2.f*(*this)();
+      const float phi = 2.f*float(M_PI)*(*this)();
+      const float r   = sqrtf(std::max(0.f,1.f-z*z));
+      return vec3f(r*cosf(phi),r*sinf(phi),z);
+    }
+
+    /*! standard normal, per component (Box-Muller) */
+    vec3f gaussian()
+    {
+      vec3f v;
+      for (int i=0;i<3;i++) {
+        const float u1 = std::max((*this)(),1e-7f);
+        const float u2 = (*this)();
+        v[i] = sqrtf(-2.f*logf(u1))*cosf(2.f*float(M_PI)*u2);
+      }
+      return v;
+    }
+
+    uint64_t state;
+  };
+
+  inline unsigned packColor(const vec3f &c)
+  {
+    const unsigned r = (unsigned)clamp(c.x*255.f,0.f,255.f);
+    const unsigned g = (unsigned)clamp(c.y*255.f,0.f,255.f);
+    const unsigned b = (unsigned)clamp(c.z*255.f,0.f,255.f);
+    return r | (g<<8) | (b<<16) | (255u<<24);
+  }
+
+  inline vec3f unpackColor(unsigned col)
+  {
+    return vec3f((col & 255)/255.f,((col >> 8) & 255)/255.f,((col >> 16) & 255)/255.f);
+  }
+
+  /*! what to generate, derived from the cmdline; glyphs fill a cube
+      with about one glyph per unit volume */
+  struct Dataset {
+    Dataset()
+    {
+      linksPerItem = cmdline.pattern == CHAINS ? cmdline.chainLength+1 : 2;
+      numItems
+        = cmdline.pattern == CHAINS
+        ? (cmdline.numGlyphs+cmdline.chainLength-1)/cmdline.chainLength
+        : cmdline.numGlyphs;
+      numGlyphs = numItems*(linksPerItem-1);
+      side = cbrtf(float(std::max(numGlyphs,size_t(1))));
+      numClusters
+        = cmdline.numClusters
+        ? cmdline.numClusters
+        : std::max(size_t(1),numGlyphs/10000);
+      gridRes = 1;
+      while (gridRes*gridRes*gridRes < numItems)
+        gridRes++;
+    }
+
+    /*! ABC flow, two periods across the cube; |v| <= A+B+C */
+    vec3f field(const vec3f &p) const
+    {
+      const float k = 4.f*float(M_PI)/side;
+      const vec3f q = k*p;
+      return vec3f(A*sinf(q.z)+C*cosf(q.y),
+                   B*sinf(q.x)+A*cosf(q.z),
+                   C*sinf(q.y)+B*cosf(q.x));
+    }
+
+    /*! item 'item's links; 'firstLink' is the index of its first one
+        in the file, for 'prev' */
+    void makeItem(size_t item, Link *links, size_t firstLink) const
+    {
+      Random rnd(cmdline.seed,item);
+      for (int i=0;i<linksPerItem;i++) {
+        links[i].rad   = cmdline.radius;
+        links[i].accel = vec3f(0.f);
+        links[i].prev  = i == 0 ? -1 : int(firstLink+i-1);
+      }
+      const float len = cmdline.glyphLength;
+      switch (cmdline.pattern) {
+      case UNIFORM: {
+        const vec3f dir = rnd.direction();
+        links[0].pos = side*rnd.point();
+        links[1].pos = links[0].pos + len*dir;
+        links[0].col = links[1].col = packColor(abs(dir));
+      } break;
+      case CLUSTERED: {
+        const size_t cluster
+          = std::min(size_t(rnd()*numClusters),numClusters-1);
+        // centers (and colors) come from their own streams
+        Random clusterRnd(~cmdline.seed,cluster);
+        const vec3f center = side*clusterRnd.point();
+        const vec3f color  = clusterRnd.point();
+        const float sigma  = .25f*side/cbrtf(float(numClusters));
+        const vec3f dir = rnd.direction();
+        links[0].pos = center + sigma*rnd.gaussian();
+        links[1].pos = links[0].pos + len*dir;
+        links[0].col = links[1].col = packColor(color);
+      } break;
+      case CHAINS: {
+        // a streamline of the field, from a random seed point
+        links[0].pos = side*rnd.point();
+        const vec3f color = rnd.point();
+        for (int i=0;i<linksPerItem;i++) {
+          links[i].col = packColor(color);
+          if (i == 0) continue;
+          const vec3f v = field(links[i-1].pos);
+          const vec3f dir
+            = length(v) > 1e-3f
+            ? normalize(v)
+            : rnd.direction();
+          links[i].pos = links[i-1].pos + len*dir;
+        }
+      } break;
+      case GRID: {
+        const size_t x = item % gridRes;
+        const size_t y = (item / gridRes) % gridRes;
+        const size_t z = item / (gridRes*gridRes);
+        const float spacing = side/gridRes;
+        const vec3f v = field((vec3f(float(x),float(y),float(z))+.5f)*spacing);
+        const float t = length(v)/(A+B+C);
+        links[0].pos = (vec3f(float(x),float(y),float(z))+.5f)*spacing;
+        links[1].pos = links[0].pos + len*t*v/std::max(length(v),1e-6f);
+        links[0].col = links[1].col = packColor(vec3f(t,.2f,1.f-t));
+      } break;
+      }
+    }
+
+    int    linksPerItem;
+    size_t numItems;
+    size_t numGlyphs;
+    float  side;
+    size_t numClusters;
+    size_t gridRes;
+    const float A = 1.f, B = sqrtf(2.f/3.f), C = sqrtf(1.f/3.f);
+  };
+
+  extern "C" int main(int argc, char **argv)
+  {
+    for (int i=1;i<argc;i++) {
+      const std::string arg = argv[i];
+      if (arg == "-o")
+        cmdline.outFileName = argv[++i];
+      else if (arg == "--pattern") {
+        const std::string pattern = argv[++i];
+        cmdline.pattern = -1;
+        for (int p=0;p<NUM_PATTERNS;p++)
+          if (pattern == patternNames[p])
+            cmdline.pattern = p;
+        if (cmdline.pattern < 0)
+          usage("unknown pattern '"+pattern+"'");
+      }
+      else if (arg == "-n")
+        cmdline.numGlyphs = parseCount(argv[++i]);
+      else if (arg == "--seed")
+        cmdline.seed = std::stoull(argv[++i]);
+      else if (arg == "--chain-length")
+        cmdline.chainLength = std::atoi(argv[++i]);
+      else if (arg == "--clusters")
+        cmdline.numClusters = parseCount(argv[++i]);
+      else if (arg == "--length")
+        cmdline.glyphLength = std::atof(argv[++i]);
+      else if (arg == "--radius")
+        cmdline.radius = std::atof(argv[++i]);
+      else
+        usage("unknown cmdline arg '"+arg+"'");
+    }
+    if (cmdline.outFileName.empty())
+      usage("no output file given");
+    if (cmdline.numGlyphs < 1)
+      usage("need at least one glyph");
+    if (cmdline.chainLength < 1)
+      usage("chains need at least one glyph");
+    const std::string ext
+      = cmdline.outFileName.substr(std::min(cmdline.outFileName.rfind('.'),
+                                            cmdline.outFileName.size()));
+    const bool binary = ext == ".bglyphs";
+    if (!binary && ext != ".glyphs")
+      usage("output file must be '.glyphs' or '.bglyphs'");
+    if (!binary && cmdline.radius != .2f)
+      std::cout << "#glyphs.gen: note: '.glyphs' files don't store the radius" << std::endl;
+
+    const Dataset data;
+    const size_t K = data.linksPerItem;
+    const size_t numLinks = data.numItems*K;
+    if (numLinks >= (size_t)std::numeric_limits<int>::max())
+      usage("too many links for 'prev' to index");
+
+    std::ofstream out(cmdline.outFileName,
+                      binary ? std::ios::binary : std::ios::out);
+    if (!out)
+      throw std::runtime_error("could not open '"+cmdline.outFileName+"'");
+
+    const double t0 = getCurrentTime();
+    if (binary) {
+      BinaryGlyphsHeader header;
+      header.numLinks = numLinks;
+      header.radius   = cmdline.radius;
+      out.write((const char *)&header,sizeof(header));
+    } else {
+      out << "# synthetic '" << patternNames[cmdline.pattern] << "' glyphs, "
+          << data.numGlyphs << " of them, seed " << cmdline.seed
+          << "; written by owlGlyphsGen" << std::endl;
+      if (cmdline.pattern == CHAINS)
+        out << "# ('.glyphs' can't store chains; each link is its own glyph)" << std::endl;
+    }
+
+    // chunks of about a million links, generated in parallel and
+    // written in order
+    const size_t itemsPerChunk = std::max(size_t(1),(size_t(1)<<20)/K);
+    const size_t itemsPerBlock = 1024;
+    std::vector<Link> links;
+    std::vector<std::string> text;
+    for (size_t chunkBegin=0;chunkBegin<data.numItems;chunkBegin+=itemsPerChunk) {
+      const size_t chunkItems = std::min(itemsPerChunk,data.numItems-chunkBegin);
+      const size_t numBlocks  = (chunkItems+itemsPerBlock-1)/itemsPerBlock;
+      links.resize(chunkItems*K);
+      if (!binary) text.assign(numBlocks,std::string());
+      owl::parallel_for(numBlocks,[&](size_t block) {
+          const size_t begin = block*itemsPerBlock;
+          const size_t end   = std::min(begin+itemsPerBlock,chunkItems);
+          char line[256];
+          for (size_t i=begin;i<end;i++) {
+            Link *item = &links[i*K];
+            data.makeItem(chunkBegin+i,item,(chunkBegin+i)*K);
+            if (binary) continue;
+            for (size_t j=1;j<K;j++) {
+              const vec3f a = item[j-1].pos, b = item[j].pos;
+              const vec3f c = unpackColor(item[j].col);
+              snprintf(line,sizeof(line),
+                       "(%.7g,%.7g,%.7g) (%.7g,%.7g,%.7g) (%.3g,%.3g,%.3g)\n",
+                       a.x,a.y,a.z,b.x,b.y,b.z,c.x,c.y,c.z);
+              text[block] += line;
+            }
+          }
+        });
+      if (binary)
+        out.write((const char *)links.data(),links.size()*sizeof(Link));
+      else
+        for (auto &block : text)
+          out << block;
+      if (!out)
+        throw std::runtime_error("error writing '"+cmdline.outFileName+"'");
+    }
+    out.close();
+    const double t = getCurrentTime()-t0;
+
+    std::cout << "#glyphs.gen: " << prettyNumber(data.numGlyphs) << " glyphs ('"
+              << patternNames[cmdline.pattern] << "', "
+              << prettyNumber(numLinks) << " links, seed " << cmdline.seed
+              << ") written to '" << cmdline.outFileName << "' in "
+              << prettyDouble(t) << "s" << std::endl;
+    return 0;
+  }
+
+}
@@ -0,0 +1,770 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! host-side microbenchmark for the glyph primitive intersectors in
+    device/roundedCone.h: fires randomized ray batches at each
+    primitive type and reports ns/test, hit rate, and how well the
+    results agree with a double-precision reference. Also compares the
+    8-wide versions in cpu/Intersect8.h against the scalar ones, for
+    both throughput and results, and the super-quadric solver against
+    the one it replaced, and float vs half precision accumulation
+    buffers. Does not need a GPU. */
+
+#include "glyphs/cpu/Intersect8.h"
+#include "glyphs/device/roundedCone.h"
+#include "glyphs/SuperProxy.h"
+#include "glyphs/device/HalfAccum.h"
+#include "glyphs/device/Sampler.h"
+#include <owl/common/parallel/parallel_for.h>
+// std
+#include <bitset>
+#include <iomanip>
+#include <random>
+
+namespace glyphs {
+
+  using namespace glyphs::device;
+  using cpu::Ray;
+
+  struct {
+    int numRays    = 1<<20;
+    /*! num rays (of the above) that get checked against the reference */
+    int numChecked = 1<<16;
+    int numRepeats = 5;
+    int seed       = 0;
+    /*! frame buffer size for the accumulation buffer benchmark */
+    vec2i accumSize = vec2i(3840,2160);
+  } cmdline;
+
+  void usage(const std::string &msg)
+  {
+    if (msg != "") std::cerr << "Error: " << msg << std::endl << std::endl;
+    std::cout << "Usage: ./owlGlyphsKernelBench [--rays <n>] [--check <n>]"
+              << " [--repeats <n>] [--seed <n>] [--accum-size <w> <h>]" << std::endl;
+    exit(msg != "");
+  }
+
+  // ------------------------------------------------------------------
+  // primitives, as the glyph programs use them
+  // ------------------------------------------------------------------
+
+  struct SpherePrim {
+    box3f bounds() const { return box3f(c-r,c+r); }
+    double sdf(const vec3d &p) const { return length(p-vec3d(c)) - r; }
+
+    vec3f c; float r;
+  };
+
+  /*! exact SDFs from iquilezles.org/articles/distfunctions */
+  struct CylinderPrim {
+    box3f bounds() const { return box3f(min(a,b)-r,max(a,b)+r); }
+    double sdf(const vec3d &p) const
+    {
+      const vec3d  ba = vec3d(b)-vec3d(a);
+      const vec3d  pa = p-vec3d(a);
+      const double baba = dot(ba,ba);
+      const double paba = dot(pa,ba);
+      const double x = length(pa*baba-ba*paba) - r*baba;
+      const double y = fabs(paba-baba*0.5)-baba*0.5;
+      const double x2 = x*x;
+      const double y2 = y*y*baba;
+      const double d
+        = (std::max(x,y) < 0.)
+        ? -std::min(x2,y2)
+        : (((x > 0.) ? x2 : 0.)+((y > 0.) ? y2 : 0.));
+      return (d < 0. ? -1. : 1.)*sqrt(fabs(d))/baba;
+    }
+
+    vec3f a, b; float r;
+  };
+
+  struct RoundedConePrim {
+    box3f bounds() const
+    { return box3f(min(a-ra,b-rb),max(a+ra,b+rb)); }
+    double sdf(const vec3d &p) const
+    {
+      const vec3d  ba  = vec3d(b)-vec3d(a);
+      const double l2  = dot(ba,ba);
+      const double rr  = double(ra)-double(rb);
+      const double a2  = l2-rr*rr;
+      const double il2 = 1./l2;
+      const vec3d  pa  = p-vec3d(a);
+      const double y   = dot(pa,ba);
+      const double z   = y-l2;
+      const vec3d  xv  = pa*l2-ba*y;
+      const double x2  = dot(xv,xv);
+      const double y2  = y*y*l2;
+      const double z2  = z*z*l2;
+      const double k   = (rr < 0. ? -1. : 1.)*rr*rr*x2;
+      if ((z < 0. ? -1. : 1.)*a2*z2 > k) return sqrt(x2+z2)*il2-rb;
+      if ((y < 0. ? -1. : 1.)*a2*y2 < k) return sqrt(x2+y2)*il2-ra;
+      return (sqrt(x2*a2*il2)+y*rr)*il2-ra;
+    }
+
+    vec3f a, b; float ra, rb;
+  };
+
+  // ------------------------------------------------------------------
+  // double-precision reference: sphere-trace the exact SDF. Slow, but
+  // independent of the closed-form solutions we want to check
+  // ------------------------------------------------------------------
+
+  /*! keeps the compiler from dropping timed loops */
+  volatile float benchSink;
+
+  struct RefHit {
+    bool   hit { false };
+    double t;
+    vec3d  N;
+  };
+
+  template<typename Prim>
+  RefHit referenceIntersect(const Prim &prim, const Ray &ray)
+  {
+    const vec3d org = vec3d(ray.origin);
+    const vec3d dir = normalize(vec3d(ray.direction));
+    // we march along the normalized direction, but report t in units
+    // of the original direction, like the float intersectors do
+    const double dirScale = length(vec3d(ray.direction));
+
+    const box3f  box   = prim.bounds();
+    const double scale = length(vec3d(box.span()));
+    const double eps   = 1e-12*scale;
+    const double tFar  = length(vec3d(box.center())-org) + scale;
+
+    RefHit result;
+    double t = ray.tmin*dirScale;
+    for (int i=0;i<100000 && t < tFar;i++) {
+      const double d = prim.sdf(org+t*dir);
+      if (d < eps) {
+        result.hit = true;
+        result.t   = t/dirScale;
+        const vec3d  P = org+t*dir;
+        const double h = 1e-7*scale;
+        result.N = normalize(vec3d(prim.sdf(P+vec3d(h,0,0))-prim.sdf(P-vec3d(h,0,0)),
+                                   prim.sdf(P+vec3d(0,h,0))-prim.sdf(P-vec3d(0,h,0)),
+                                   prim.sdf(P+vec3d(0,0,h))-prim.sdf(P-vec3d(0,0,h))));
+        return result;
+      }
+      t += d;
+    }
+    return result;
+  }
+
+  // ------------------------------------------------------------------
+  // ray generation and the actual benchmark
+  // ------------------------------------------------------------------
+
+  /*! one ray per prim (cycling through prims); origins are well
+      outside the prim, directions aim at a random point in its
+      (slightly enlarged) bounding box, so roughly half the rays hit */
+  template<typename Prim>
+  std::vector<Ray> generateRays(const std::vector<Prim> &prims,
+                                std::mt19937 &rng)
+  {
+    std::uniform_real_distribution<float> uniform(0.f,1.f);
+    std::vector<Ray> rays(cmdline.numRays);
+    for (size_t i=0;i<rays.size();i++) {
+      const box3f box = prims[i%prims.size()].bounds();
+      const vec3f center = box.center();
+      const float extent = length(box.span());
+      vec3f dir;
+      do {
+        dir = 2.f*vec3f(uniform(rng),uniform(rng),uniform(rng))-1.f;
+      } while (dot(dir,dir) > 1.f || dot(dir,dir) < 1e-3f);
+      const vec3f org = center + 2.f*extent*normalize(dir);
+      const vec3f target
+        = center + 1.2f*(vec3f(uniform(rng),uniform(rng),uniform(rng))-.5f)*box.span();
+      rays[i] = Ray(org,normalize(target-org),0.f,1e20f);
+    }
+    return rays;
+  }
+
+  template<typename Prim, typename Intersect>
+  void runBenchmark(const std::string &name,
+                    const std::vector<Prim> &prims,
+                    const Intersect &intersect,
+                    std::mt19937 &rng)
+  {
+    const std::vector<Ray> rays = generateRays(prims,rng);
+
+    // ---- throughput ----
+    double bestTime = std::numeric_limits<double>::infinity();
+    size_t numHits  = 0;
+    float  sum_t    = 0.f;
+    for (int r=0;r<cmdline.numRepeats;r++) {
+      numHits = 0;
+      const double t0 = getCurrentTime();
+      for (size_t i=0;i<rays.size();i++) {
+        float hit_t = rays[i].tmax;
+        vec3f N;
+        if (intersect(prims[i%prims.size()],rays[i],hit_t,N)) {
+          numHits++;
+          sum_t += hit_t;
+        }
+      }
+      bestTime = std::min(bestTime,getCurrentTime()-t0);
+    }
+    benchSink = sum_t;
+
+    // ---- agreement with reference ----
+    const int numChecked = std::min(cmdline.numChecked,(int)rays.size());
+    int    numAgree = 0, numBothHit = 0, numFalseHits = 0, numMissed = 0;
+    double sumRelErr = 0., maxRelErr = 0., sumAngle = 0.;
+    for (int i=0;i<numChecked;i++) {
+      const Prim &prim = prims[i%prims.size()];
+      float hit_t = rays[i].tmax;
+      vec3f N;
+      const bool   hit = intersect(prim,rays[i],hit_t,N);
+      const RefHit ref = referenceIntersect(prim,rays[i]);
+      if (hit != ref.hit) {
+        (hit ? numFalseHits : numMissed)++;
+        continue;
+      }
+      numAgree++;
+      if (!hit) continue;
+
+      numBothHit++;
+      const double relErr = fabs(hit_t-ref.t)/std::max(ref.t,1e-20);
+      sumRelErr += relErr;
+      maxRelErr  = std::max(maxRelErr,relErr);
+      const double cosAngle
+        = std::min(1.,std::max(-1.,dot(normalize(vec3d(N)),ref.N)));
+      sumAngle  += acos(cosAngle)*180./M_PI;
+    }
+
+    std::cout << std::setw(18) << name
+              << std::fixed << std::setprecision(2)
+              << std::setw(10) << (1e9*bestTime/rays.size())
+              << std::setw(10) << (100.*numHits/rays.size())
+              << std::setw(10) << (100.*numAgree/numChecked)
+              << std::setw(8)  << numFalseHits
+              << std::setw(8)  << numMissed
+              << std::scientific << std::setprecision(2)
+              << std::setw(12) << (numBothHit ? sumRelErr/numBothHit : 0.)
+              << std::setw(12) << maxRelErr
+              << std::setw(12) << (numBothHit ? sumAngle/numBothHit : 0.)
+              << std::defaultfloat << std::endl;
+  }
+
+  /*! one ray against packs of 8 prims, scalar (prim by prim) vs
+      8-wide SoA; checks that both find the same hits */
+  template<typename Prim, typename Pack, typename Intersect, typename Intersect8>
+  /*! returns the number of lanes where the 8-wide intersector
+      disagrees with the scalar one on hit or miss. Grazing rays, where
+      nudging the origin by a few ulps already flips the scalar
+      result, don't count: there FMA contraction alone can decide */
+  int runSIMDBenchmark(const std::string &name,
+                        const std::vector<Prim> &prims,
+                        const std::vector<Pack> &packs,
+                        const Intersect &intersect,
+                        const Intersect8 &intersect8,
+                        std::mt19937 &rng)
+  {
+    // ray i aims at prim i%numPrims, and gets tested against that
+    // prim's pack
+    const std::vector<Ray> rays = generateRays(prims,rng);
+    auto packOf = [&](size_t rayID) { return (rayID%prims.size())/8; };
+
+    double scalarTime = std::numeric_limits<double>::infinity();
+    double simdTime   = std::numeric_limits<double>::infinity();
+    size_t scalarHits = 0, simdHits = 0;
+    for (int r=0;r<cmdline.numRepeats;r++) {
+      scalarHits = 0;
+      double t0 = getCurrentTime();
+      for (size_t i=0;i<rays.size();i++) {
+        const Prim *pack = &prims[8*packOf(i)];
+        for (int lane=0;lane<8;lane++) {
+          float hit_t = rays[i].tmax;
+          vec3f N;
+          scalarHits += intersect(pack[lane],rays[i],hit_t,N);
+        }
+      }
+      scalarTime = std::min(scalarTime,getCurrentTime()-t0);
+
+      simdHits = 0;
+      t0 = getCurrentTime();
+      for (size_t i=0;i<rays.size();i++) {
+        cpu::vfloat8 t(rays[i].tmax);
+        simdHits += std::bitset<8>(movemask(intersect8(packs[packOf(i)],rays[i],t))).count();
+      }
+      simdTime = std::min(simdTime,getCurrentTime()-t0);
+    }
+
+    // ---- do both agree, lane by lane? ----
+    const int numChecked = std::min(cmdline.numChecked,(int)rays.size());
+    int    numMismatches = 0, numGrazing = 0;
+    auto grazing = [&](const Prim &prim, const Ray &ray, bool hit) {
+      const float eps = 1e-5f*(1.f+length(ray.origin));
+      for (int axis=0;axis<3;axis++)
+        for (float sign : { -1.f, +1.f }) {
+          Ray nudged = ray;
+          nudged.origin[axis] += sign*eps;
+          float hit_t = nudged.tmax;
+          vec3f N;
+          const bool nudgedHit
+            = intersect(prim,nudged,hit_t,N)
+            && hit_t > nudged.tmin && hit_t < nudged.tmax;
+          if (nudgedHit != hit) return true;
+        }
+      return false;
+    };
+    double maxRelErr = 0.;
+    for (int i=0;i<numChecked;i++) {
+      const Prim *pack = &prims[8*packOf(i)];
+      cpu::vfloat8 t8(rays[i].tmax);
+      const int mask = movemask(intersect8(packs[packOf(i)],rays[i],t8));
+      alignas(32) float t[8];
+      t8.store(t);
+      for (int lane=0;lane<8;lane++) {
+        float hit_t = rays[i].tmax;
+        vec3f N;
+        const bool hit
+          = intersect(pack[lane],rays[i],hit_t,N)
+          && hit_t > rays[i].tmin && hit_t < rays[i].tmax;
+        if (hit != bool((mask >> lane) & 1)) {
+          (grazing(pack[lane],rays[i],hit) ? numGrazing : numMismatches)++;
+          continue;
+        }
+        if (hit)
+          maxRelErr = std::max(maxRelErr,double(fabsf(t[lane]-hit_t)/hit_t));
+      }
+    }
+
+    std::cout << std::setw(18) << name
+              << std::fixed << std::setprecision(2)
+              << std::setw(10) << (1e9*scalarTime/(8*rays.size()))
+              << std::setw(10) << (1e9*simdTime/(8*rays.size()))
+              << std::setw(10) << (scalarTime/simdTime)
+              << std::setw(10) << (100.*simdHits/(8*rays.size()))
+              << std::setw(12) << numMismatches
+              << std::scientific << std::setprecision(2)
+              << std::setw(14) << maxRelErr
+              << std::defaultfloat << std::endl;
+    if (numGrazing)
+      std::cout << "  (and " << numGrazing << " on grazing rays)" << std::endl;
+    if (scalarHits != simdHits)
+      std::cout << "  (" << scalarHits << " scalar vs " << simdHits
+                << " simd hits in timed runs)" << std::endl;
+    return numMismatches;
+  }
+
+  // ------------------------------------------------------------------
+  // super quadrics: super::intersect() vs the solver it replaced
+  // ------------------------------------------------------------------
+
+  /*! what SuperGlyphs.cu's refine() used to do: 50 damped Newton
+      steps from the proxy entry, using the old partials (which used
+      q.r for all axes), accepting any point with f < 1e-3 */
+  inline bool legacyRefine(const super::Quadric &sq,
+                           const vec3f &ori, const vec3f &dir,
+                           float &t, int &iterations)
+  {
+    auto legacyDf = [&](const vec3f &pos) {
+      return vec3f(pos.x > 0.f ? powf(pos.x/sq.A,sq.r-1.f) : -powf(-pos.x/sq.A,sq.r-1.f),
+                   pos.y > 0.f ? powf(pos.y/sq.B,sq.r-1.f) : -powf(-pos.y/sq.B,sq.r-1.f),
+                   pos.z > 0.f ? powf(pos.z/sq.C,sq.r-1.f) : -powf(-pos.z/sq.C,sq.r-1.f));
+    };
+    t += 1e-2f;
+    for (iterations=1; iterations<=50; ++iterations) {
+      const vec3f pos = ori + dir * t;
+      const float f = super::f(sq,pos);
+      if (f < 1e-3f)
+        return true;
+      t -= .5f * (f / dot(legacyDf(pos),dir));
+    }
+    return false;
+  }
+
+  struct SolverStats {
+    void add(bool hit, bool refHit, float t, double tRef, int iterations)
+    {
+      numRays++;
+      if (hit && !refHit) numFalseHits++;
+      if (!hit && refHit) numMissed++;
+      if (hit && refHit) {
+        numBothHit++;
+        const double err = fabs(t-tRef);
+        sumErr += err;
+        maxErr  = std::max(maxErr,err);
+      }
+      sumIterations += iterations;
+      int bucket = 0;
+      while (bucket < NUM_BUCKETS-1 && iterations > (2<<bucket)) bucket++;
+      histogram[bucket]++;
+    }
+
+    void print(const std::string &name, double time) const
+    {
+      std::cout << std::setw(10) << name
+                << std::fixed << std::setprecision(2)
+                << std::setw(10) << (1e9*time/numRays)
+                << std::setw(10) << (100.*numMissed/std::max(1,numRays))
+                << std::setw(10) << (100.*numFalseHits/std::max(1,numRays))
+                << std::setw(10) << (sumIterations/double(numRays))
+                << std::scientific << std::setprecision(2)
+                << std::setw(12) << (numBothHit ? sumErr/numBothHit : 0.)
+                << std::setw(12) << maxErr
+                << std::defaultfloat << "  ";
+      for (int i=0;i<NUM_BUCKETS;i++)
+        std::cout << " " << std::setw(5) << std::fixed << std::setprecision(1)
+                  << (100.*histogram[i]/std::max(1,numRays));
+      std::cout << std::defaultfloat << std::endl;
+    }
+
+    /*! iteration buckets: <=2, <=4, <=8, ... <=64, >64 */
+    enum { NUM_BUCKETS = 7 };
+    int    histogram[NUM_BUCKETS] = { 0 };
+    int    numRays = 0, numMissed = 0, numFalseHits = 0, numBothHit = 0;
+    double sumIterations = 0., sumErr = 0., maxErr = 0.;
+  };
+
+  void runSuperBenchmark(std::mt19937 &rng)
+  {
+    std::uniform_real_distribution<float> uniform(0.f,1.f);
+
+    // same shapes as mapToSuperQuadric(), and the same proxy slack
+    // as the tessellation in SuperGlyphs.cpp
+    const float slack = .4f;
+    struct Sample {
+      super::Quadric q;
+      vec3f ori, dir;
+      float tEnter;
+      bool  refHit;
+      double tRef;
+    };
+    std::vector<Sample> samples;
+    const int numSamples = std::min(cmdline.numRays,cmdline.numChecked);
+    while ((int)samples.size() < numSamples) {
+      Sample s;
+      s.q = { 1.f+2.f*uniform(rng), 1.f+2.f*uniform(rng), 1.f+2.f*uniform(rng), 1.f, 1.f, 1.f };
+      vec3f dir;
+      do {
+        dir = 2.f*vec3f(uniform(rng),uniform(rng),uniform(rng))-1.f;
+      } while (dot(dir,dir) > 1.f || dot(dir,dir) < 1e-3f);
+      s.ori = 4.f*normalize(dir);
+      const vec3f target = 2.4f*(vec3f(uniform(rng),uniform(rng),uniform(rng))-.5f);
+      s.dir = normalize(target-s.ori);
+
+      // where the ray enters the (inflated) proxy; rays that miss
+      // it never get to the solver
+      super::Quadric proxy = s.q;
+      proxy.A += slack; proxy.B += slack; proxy.C += slack;
+      double tProxy;
+      if (!referenceSuper(proxy,s.ori,s.dir,0.,8.,tProxy))
+        continue;
+      s.tEnter = (float)tProxy;
+      s.refHit = referenceSuper(s.q,s.ori,s.dir,tProxy,8.,s.tRef);
+      samples.push_back(s);
+    }
+
+    SolverStats oldStats, newStats;
+    double t0 = getCurrentTime();
+    for (auto &s : samples) {
+      float t = s.tEnter;
+      int   iterations = 0;
+      const bool hit = legacyRefine(s.q,s.ori,s.dir,t,iterations);
+      oldStats.add(hit,s.refHit,t,s.tRef,iterations);
+    }
+    const double oldTime = getCurrentTime()-t0;
+
+    t0 = getCurrentTime();
+    for (auto &s : samples) {
+      super::Hit hit;
+      const bool found = super::intersect(s.q,s.ori,s.dir,s.tEnter,1e20f,hit);
+      newStats.add(found,s.refHit,hit.t,s.tRef,hit.iterations);
+    }
+    const double newTime = getCurrentTime()-t0;
+
+    std::cout << std::endl
+              << "#glyphs.kernelBench: super quadric solvers, " << samples.size()
+              << " rays that hit the proxy" << std::endl;
+    std::cout << std::setw(10) << "solver"
+              << std::setw(10) << "ns/ray"
+              << std::setw(10) << "missed%"
+              << std::setw(10) << "false%"
+              << std::setw(10) << "avg its"
+              << std::setw(12) << "avg |dt|"
+              << std::setw(12) << "max |dt|"
+              << "   % with iterations <=2 <=4 <=8 <=16 <=32 <=64 >64" << std::endl;
+    oldStats.print("old",oldTime);
+    newStats.print("bracketed",newTime);
+  }
+
+  // ------------------------------------------------------------------
+  // accumulation buffers: what raygen_program() does to memory per
+  // frame, with a trivial 'sample' so that memory traffic dominates
+  // ------------------------------------------------------------------
+
+  inline uint32_t toRGBA8(const vec4f &sum)
+  {
+    const vec4f c = sum / max(sum.w,1.f);
+    return
+      (uint32_t(min(255,max(0,int(c.x*256.f)))) << 0) +
+      (uint32_t(min(255,max(0,int(c.y*256.f)))) << 8) +
+      (uint32_t(min(255,max(0,int(c.z*256.f)))) << 16);
+  }
+
+  /*! expected value of accumSample() */
+  inline float accumMean(uint32_t pixel)
+  {
+    return .05f + (pixel % 251) / 251.f;
+  }
+
+  /*! noisy sample, +-50% around a per-pixel mean */
+  inline vec3f accumSample(uint32_t pixel, uint32_t frame)
+  {
+    const uint32_t h = hashCombine(hashInt(pixel),frame);
+    return vec3f(accumMean(pixel)*(.5f+toUnitFloat(h)));
+  }
+
+  void runAccumBenchmark()
+  {
+    const size_t numPixels = size_t(cmdline.accumSize.x)*cmdline.accumSize.y;
+    const int numFrames = 8;
+    std::vector<vec4f>             floatAccum(numPixels,vec4f(0.f));
+    std::vector<device::HalfAccum> halfAccum(numPixels,device::packAccum(vec4f(0.f)));
+    std::vector<uint32_t>          color(numPixels);
+    const size_t blockSize = 64*1024;
+
+    // float4 sums, colors written every frame (what raygen did so far)
+    double t0 = getCurrentTime();
+    for (int f=0;f<numFrames;f++)
+      owl::parallel_for_blocked(size_t(0),numPixels,blockSize,[&](size_t begin, size_t end) {
+          for (size_t i=begin;i<end;i++) {
+            const vec4f sum = floatAccum[i] + vec4f(accumSample(uint32_t(i),f),1.f);
+            floatAccum[i] = sum;
+            color[i] = toRGBA8(sum);
+          }
+        });
+    const double floatTime = (getCurrentTime()-t0)/numFrames;
+
+    // half accumulation only ...
+    t0 = getCurrentTime();
+    for (int f=0;f<numFrames;f++)
+      owl::parallel_for_blocked(size_t(0),numPixels,blockSize,[&](size_t begin, size_t end) {
+          for (size_t i=begin;i<end;i++) {
+            const vec4f sum
+              = device::unpackAccum(halfAccum[i]) + vec4f(accumSample(uint32_t(i),f),1.f);
+            halfAccum[i] = device::packAccum(sum);
+          }
+        });
+    const double halfTime = (getCurrentTime()-t0)/numFrames;
+
+    // ... plus a separate display pass whenever the display refreshes
+    t0 = getCurrentTime();
+    for (int f=0;f<numFrames;f++)
+      owl::parallel_for_blocked(size_t(0),numPixels,blockSize,[&](size_t begin, size_t end) {
+          for (size_t i=begin;i<end;i++)
+            color[i] = toRGBA8(device::unpackAccum(halfAccum[i]));
+        });
+    const double displayTime = (getCurrentTime()-t0)/numFrames;
+
+    // precision: one sample per frame up to the sample cap, on a
+    // few pixels; rounding error vs the noise of the estimate itself
+    const int numCheckPixels = 1<<14, numCheckFrames = HALF_ACCUM_MAX_COUNT;
+    double halfErr = 0., noiseErr = 0.;
+    for (int i=0;i<numCheckPixels;i++) {
+      vec4f floatSum(0.f);
+      device::HalfAccum half = device::packAccum(vec4f(0.f));
+      for (int f=0;f<numCheckFrames;f++) {
+        const vec4f sample(accumSample(uint32_t(i),f),1.f);
+        floatSum = floatSum + sample;
+        half = device::packAccum(device::unpackAccum(half) + sample);
+      }
+      const vec4f halfSum = device::unpackAccum(half);
+      const float floatMean = floatSum.x/floatSum.w, halfMean = halfSum.x/halfSum.w;
+      halfErr  += fabsf(halfMean-floatMean)/floatMean;
+      noiseErr += fabsf(floatMean-accumMean(i))/accumMean(i);
+    }
+
+    const double MB = 1024.*1024.;
+    std::cout << std::endl
+              << "#glyphs.kernelBench: accumulation buffers, "
+              << cmdline.accumSize.x << "x" << cmdline.accumSize.y << std::endl;
+    std::cout << std::setw(24) << "buffer"
+              << std::setw(12) << "MB"
+              << std::setw(14) << "MB/frame"
+              << std::setw(12) << "ms/frame" << std::endl;
+    // read+write of the accum buffer, plus the color write
+    std::cout << std::setw(24) << "float4, fused display"
+              << std::setw(12) << std::fixed << std::setprecision(1)
+              << (numPixels*sizeof(vec4f)/MB)
+              << std::setw(14) << (numPixels*(2*sizeof(vec4f)+sizeof(uint32_t))/MB)
+              << std::setw(12) << std::setprecision(2) << (1000.*floatTime) << std::endl;
+    std::cout << std::setw(24) << "half, accumulate"
+              << std::setw(12) << std::setprecision(1)
+              << (numPixels*sizeof(device::HalfAccum)/MB)
+              << std::setw(14) << (numPixels*2*sizeof(device::HalfAccum)/MB)
+              << std::setw(12) << std::setprecision(2) << (1000.*halfTime) << std::endl;
+    std::cout << std::setw(24) << "half, display pass"
+              << std::setw(12) << "-"
+              << std::setw(14) << std::setprecision(1)
+              << (numPixels*(sizeof(device::HalfAccum)+sizeof(uint32_t))/MB)
+              << std::setw(12) << std::setprecision(2) << (1000.*displayTime) << std::endl;
+    std::cout << "after " << numCheckFrames << " frames, mean rel. error of the pixel mean:"
+              << " half vs float " << std::scientific << std::setprecision(2)
+              << (halfErr/numCheckPixels)
+              << ", float vs expected value " << (noiseErr/numCheckPixels)
+              << std::fixed << std::endl;
+  }
+
+  extern "C" int main(int argc, char **argv)
+  {
+    for (int i=1;i<argc;i++) {
+      const std::string arg = argv[i];
+      if (arg == "--rays")
+        cmdline.numRays = std::atoi(argv[++i]);
+      else if (arg == "--check")
+        cmdline.numChecked = std::atoi(argv[++i]);
+      else if (arg == "--repeats")
+        cmdline.numRepeats = std::atoi(argv[++i]);
+      else if (arg == "--seed")
+        cmdline.seed = std::atoi(argv[++i]);
+      else if (arg == "--accum-size") {
+        cmdline.accumSize.x = std::atoi(argv[++i]);
+        cmdline.accumSize.y = std::atoi(argv[++i]);
+      }
+      else
+        usage("unknown cmdline arg '"+arg+"'");
+    }
+
+    std::mt19937 rng(cmdline.seed);
+    std::uniform_real_distribution<float> uniform(0.f,1.f);
+    auto randomPos = [&]() {
+      return 2.f*vec3f(uniform(rng),uniform(rng),uniform(rng))-1.f;
+    };
+    auto randomRange = [&](float lo, float hi) {
+      return lo + (hi-lo)*uniform(rng);
+    };
+
+    // few enough prims to stay in cache; we measure the intersector,
+    // not memory
+    const int numPrims = 1024;
+
+    std::vector<SpherePrim> spheres(numPrims);
+    for (auto &s : spheres) {
+      s.c = randomPos();
+      s.r = randomRange(.1f,.5f);
+    }
+    // the RTGem intersector assumes the sphere is at the origin (it's
+    // used in instance space)
+    std::vector<SpherePrim> instSpheres(numPrims);
+    for (auto &s : instSpheres) {
+      s.c = vec3f(0.f);
+      s.r = randomRange(.1f,1.f);
+    }
+    std::vector<CylinderPrim> cylinders(numPrims);
+    for (auto &c : cylinders) {
+      c.a = randomPos();
+      c.b = randomPos();
+      c.r = randomRange(.05f,.3f);
+    }
+    std::vector<RoundedConePrim> cones(numPrims);
+    for (auto &c : cones) {
+      c.a  = randomPos();
+      c.b  = randomPos();
+      c.ra = randomRange(.05f,.4f);
+      c.rb = randomRange(.001f,c.ra);
+    }
+
+    std::cout << "#glyphs.kernelBench: " << cmdline.numRays << " rays per primitive type, "
+              << cmdline.numChecked << " of them checked against reference" << std::endl;
+    std::cout << std::setw(18) << "primitive"
+              << std::setw(10) << "ns/test"
+              << std::setw(10) << "hit%"
+              << std::setw(10) << "agree%"
+              << std::setw(8)  << "fhit"
+              << std::setw(8)  << "miss"
+              << std::setw(12) << "avg rel(t)"
+              << std::setw(12) << "max rel(t)"
+              << std::setw(12) << "N err(deg)" << std::endl;
+
+    runBenchmark("sphere",spheres,
+                 [](const SpherePrim &s, const Ray &ray, float &t, vec3f &N) {
+                   return intersectSphere2(s.c,s.r,ray,t,N);
+                 },rng);
+    runBenchmark("instanceSphere",instSpheres,
+                 [](const SpherePrim &s, const Ray &ray, float &t, vec3f &N) {
+                   return intersectInstanceSphereRTGem(s.c,s.r,ray,t,N);
+                 },rng);
+    runBenchmark("cylinder",cylinders,
+                 [](const CylinderPrim &c, const Ray &ray, float &t, vec3f &N) {
+                   return intersectCylinder(c.a,c.b,c.r,ray,t,N);
+                 },rng);
+    runBenchmark("roundedCone",cones,
+                 [](const RoundedConePrim &c, const Ray &ray, float &t, vec3f &N) {
+                   return intersectRoundedCone(c.a,c.b,c.ra,c.rb,ray,t,N);
+                 },rng);
+
+    // ------------------------------------------------------------------
+    // 8-wide versions
+    // ------------------------------------------------------------------
+    std::vector<cpu::Spheres8>       sphere8s(numPrims/8);
+    std::vector<cpu::Cylinders8>     cylinder8s(numPrims/8);
+    std::vector<cpu::RoundedCones8>  cone8s(numPrims/8);
+    for (int i=0;i<numPrims;i++) {
+      sphere8s[i/8].set(i%8,spheres[i].c,spheres[i].r);
+      cylinder8s[i/8].set(i%8,cylinders[i].a,cylinders[i].b,cylinders[i].r);
+      cone8s[i/8].set(i%8,cones[i].a,cones[i].b,cones[i].ra,cones[i].rb);
+    }
+
+    std::cout << std::endl
+              << "#glyphs.kernelBench: 8-wide (" << cpu::simdISA()
+              << ") vs scalar, one ray against 8 prims" << std::endl;
+    std::cout << std::setw(18) << "primitive"
+              << std::setw(10) << "ns scalar"
+              << std::setw(10) << "ns simd"
+              << std::setw(10) << "speedup"
+              << std::setw(10) << "hit%"
+              << std::setw(12) << "mismatches"
+              << std::setw(14) << "max rel(t)" << std::endl;
+    int numMismatches = 0;
+    numMismatches += runSIMDBenchmark("sphere",spheres,sphere8s,
+                                      [](const SpherePrim &s, const Ray &ray, float &t, vec3f &N) {
+                                        return intersectSphere2(s.c,s.r,ray,t,N);
+                                      },
+                                      [](const cpu::Spheres8 &p, const Ray &ray, cpu::vfloat8 &t) {
+                                        return cpu::intersectSpheres8(p,ray,t);
+                                      },rng);
+    numMismatches += runSIMDBenchmark("cylinder",cylinders,cylinder8s,
+                                      [](const CylinderPrim &c, const Ray &ray, float &t, vec3f &N) {
+                                        return intersectCylinder(c.a,c.b,c.r,ray,t,N);
+                                      },
+                                      [](const cpu::Cylinders8 &p, const Ray &ray, cpu::vfloat8 &t) {
+                                        return cpu::intersectCylinders8(p,ray,t);
+                                      },rng);
+    numMismatches += runSIMDBenchmark("roundedCone",cones,cone8s,
+                                      [](const RoundedConePrim &c, const Ray &ray, float &t, vec3f &N) {
+                                        return intersectRoundedCone(c.a,c.b,c.ra,c.rb,ray,t,N);
+                                      },
+                                      [](const cpu::RoundedCones8 &p, const Ray &ray, cpu::vfloat8 &t) {
+                                        return cpu::intersectRoundedCones8(p,ray,t);
+                                      },rng);
+
+    runSuperBenchmark(rng);
+    runAccumBenchmark();
+
+    // the 8-wide intersectors are what the cpu back-end traces with,
+    // so any disagreement with the scalar ones is a bug
+    if (numMismatches) {
+      std::cout << "#glyphs.kernelBench: FAILED, " << numMismatches
+                << " 8-wide vs scalar mismatches" << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+}
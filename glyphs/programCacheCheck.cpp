@@ -0,0 +1,289 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! host check of ProgramCache, with a stand-in for owlBuildPrograms():
+    keys, hits and misses, what the manifest records, and that
+    concurrent rewrites of the manifest never leave half a file or
+    temporaries behind. Runs in (and empties) --dir; exits with the
+    number of failed checks. Does not need a GPU */
+
+#include "glyphs/ProgramCache.h"
+// std
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#if _WIN32
+# include <io.h>
+#else
+# include <dirent.h>
+#endif
+
+namespace glyphs {
+
+  struct {
+    /*! the cache directory; its manifest is removed first */
+    std::string dir = "programCacheCheck";
+  } cmdline;
+
+  void usage(const std::string &msg)
+  {
+    if (msg != "") std::cerr << "Error: " << msg << std::endl << std::endl;
+    std::cout << "Usage: ./owlGlyphsProgramCacheCheck [--dir <dir>]" << std::endl;
+    exit(msg != "");
+  }
+
+  int numFailed = 0;
+
+  void check(bool ok, const std::string &what)
+  {
+    std::cout << "#glyphs.programCacheCheck: " << what
+              << (ok ? " ... ok" : " ... FAILED") << std::endl;
+    numFailed += !ok;
+  }
+
+  /*! file names in 'dir', without '.' and '..' */
+  std::vector<std::string> listDir(const std::string &dir)
+  {
+    std::vector<std::string> names;
+#if _WIN32
+    _finddata_t data;
+    const intptr_t handle = _findfirst((dir+"\\*").c_str(),&data);
+    if (handle == -1) return names;
+    do names.push_back(data.name); while (_findnext(handle,&data) == 0);
+    _findclose(handle);
+#else
+    DIR *d = opendir(dir.c_str());
+    if (!d) return names;
+    while (dirent *e = readdir(d))
+      names.push_back(e->d_name);
+    closedir(d);
+#endif
+    std::vector<std::string> result;
+    for (auto &name : names)
+      if (name != "." && name != "..")
+        result.push_back(name);
+    return result;
+  }
+
+  std::vector<std::string> readLines(const std::string &fileName)
+  {
+    std::vector<std::string> lines;
+    std::ifstream in(fileName);
+    std::string line;
+    while (std::getline(in,line))
+      lines.push_back(line);
+    return lines;
+  }
+
+  /*! what ProgramCache writes: key, builds, cold and last seconds,
+      and a name */
+  bool isManifestLine(const std::string &line)
+  {
+    std::stringstream ss(line);
+    std::string key, name;
+    int numBuilds;
+    double cold, last;
+    return (ss >> key >> numBuilds >> cold >> last >> name)
+      && key.size() == 16 && numBuilds > 0;
+  }
+
+  /*! the stand-in: counts, and takes 'seconds' */
+  struct FakeBuild {
+    void operator()()
+    {
+      numCalls++;
+      std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    }
+    int    numCalls { 0 };
+    double seconds  { 0. };
+  };
+
+  void checkKeys()
+  {
+    const std::vector<std::string> ptx = { "// arrows ptx", "// spheres ptx" };
+    const std::string config = "driver 12020 devices 1 sm_86";
+    const uint64_t key = ProgramCache::key(ptx,config);
+    check(key == ProgramCache::key(ptx,config),
+          "same PTX and config, same key");
+    check(key != ProgramCache::key({ "// arrows ptx", "// spheres ptx 2" },config),
+          "changed PTX, new key");
+    check(key != ProgramCache::key(ptx,"driver 12030 devices 1 sm_86"),
+          "changed config, new key");
+    check(key != ProgramCache::key({ "// arrows ptx//", " spheres ptx" },config),
+          "PTX moved from one module to the next, new key");
+  }
+
+  void checkHitMiss(const std::string &dir)
+  {
+    const uint64_t key = ProgramCache::key({ "// ptx" },"config");
+    FakeBuild fake;
+    ProgramCache::Entry entry;
+    {
+      ProgramCache cache(dir);
+      check(!cache.lookup(key,entry),"empty cache, no entry");
+      fake.seconds = .05;
+      cache.build("programs",key,std::ref(fake));
+      check(fake.numCalls == 1 && cache.numMisses == 1 && cache.numHits == 0,
+            "first build is a miss");
+      check(cache.lookup(key,entry) && entry.numBuilds == 1
+            && entry.name == "programs" && entry.coldSeconds >= .05,
+            "miss is recorded with its build time");
+    }
+    // as the next run would see it
+    ProgramCache cache(dir);
+    fake.seconds = 0.;
+    cache.build("programs",key,std::ref(fake));
+    check(fake.numCalls == 2 && cache.numHits == 1 && cache.numMisses == 0,
+          "same key in the next run is a hit, and still builds");
+    check(cache.lookup(key,entry) && entry.numBuilds == 2
+          && entry.coldSeconds >= .05 && entry.lastSeconds < entry.coldSeconds,
+          "hit keeps the cold build time");
+
+    const uint64_t otherKey = ProgramCache::key({ "// changed ptx" },"config");
+    cache.build("programs",otherKey,std::ref(fake));
+    check(cache.numMisses == 1,"changed PTX is a miss");
+    check(cache.lookup(key,entry) && cache.lookup(otherKey,entry),
+          "both keys are in the manifest");
+
+    const std::vector<std::string> lines = readLines(dir+"/manifest.txt");
+    bool allParse = !lines.empty();
+    for (auto &line : lines)
+      allParse &= isManifestLine(line);
+    check(lines.size() == 2 && allParse,"manifest has one line per key");
+  }
+
+  void checkLimits(const std::string &dir)
+  {
+    ProgramCache cache(dir);
+    FakeBuild fake;
+    for (int i=0;i<ProgramCache::maxEntries+6;i++)
+      cache.build("programs",ProgramCache::key({ std::to_string(i) },""),std::ref(fake));
+    ProgramCache::Entry entry;
+    check(readLines(dir+"/manifest.txt").size() == (size_t)ProgramCache::maxEntries
+          && !cache.lookup(ProgramCache::key({ "0" },""),entry)
+          && cache.lookup(ProgramCache::key({ std::to_string(ProgramCache::maxEntries+5) },""),entry),
+          "manifest keeps the most recent keys");
+
+    {
+      std::ofstream out(dir+"/manifest.txt",std::ios::app);
+      out << "not a manifest line" << std::endl << "0123";
+    }
+    const uint64_t key = ProgramCache::key({ "// ptx" },"damaged");
+    cache.build("programs",key,std::ref(fake));
+    bool allParse = true;
+    for (auto &line : readLines(dir+"/manifest.txt"))
+      allParse &= isManifestLine(line);
+    check(cache.lookup(key,entry) && allParse,
+          "damaged manifest lines are dropped on the next rewrite");
+  }
+
+  /*! writers in threads, each with its own cache object as separate
+      runs would have, while a reader checks that every version of
+      the manifest it sees is complete */
+  void checkConcurrentRewrites(const std::string &dir)
+  {
+    const int numWriters = 4, numBuilds = 16;
+    std::atomic<int> numDone { 0 };
+    std::atomic<int> numBadReads { 0 };
+    std::vector<std::thread> writers;
+    for (int w=0;w<numWriters;w++)
+      writers.push_back(std::thread([&,w]() {
+            ProgramCache cache(dir);
+            FakeBuild fake;
+            for (int i=0;i<numBuilds;i++)
+              cache.build("writer"+std::to_string(w),
+                          ProgramCache::key({ std::to_string(w) },std::to_string(i)),
+                          std::ref(fake));
+            numDone++;
+          }));
+    std::thread reader([&]() {
+        while (numDone < numWriters) {
+          std::ifstream in(dir+"/manifest.txt");
+          std::stringstream ss;
+          ss << in.rdbuf();
+          const std::string text = ss.str();
+          // a complete manifest ends in a newline, and it always has
+          // lines in it after the first build
+          if (text.empty() || text.back() != '\n') {
+            numBadReads++;
+            continue;
+          }
+          std::string line;
+          while (std::getline(ss,line))
+            numBadReads += !isManifestLine(line);
+        }
+      });
+    for (auto &writer : writers) writer.join();
+    reader.join();
+    check(numBadReads == 0,"readers never see a partly written manifest");
+
+    bool leftovers = false;
+    for (auto &name : listDir(dir))
+      leftovers |= name.find(".tmp") != std::string::npos;
+    check(!leftovers,"no temporary manifests are left behind");
+  }
+
+  void checkDisabled()
+  {
+    ProgramCache cache("");
+    FakeBuild fake;
+    const uint64_t key = ProgramCache::key({ "// ptx" },"config");
+    cache.build("programs",key,std::ref(fake));
+    ProgramCache::Entry entry;
+    check(!cache.enabled() && fake.numCalls == 1 && !cache.lookup(key,entry)
+          && cache.numHits == 0 && cache.numMisses == 0
+          && cache.artifactDir("optix") == "",
+          "disabled cache still builds, and records nothing");
+  }
+
+  extern "C" int main(int argc, char **argv)
+  {
+    for (int i=1;i<argc;i++) {
+      const std::string arg = argv[i];
+      if (arg == "--dir")
+        cmdline.dir = argv[++i];
+      else if (arg == "-h" || arg == "--help")
+        usage("");
+      else
+        usage("unknown cmdline arg '"+arg+"'");
+    }
+
+    const std::string dir = cmdline.dir;
+    {
+      ProgramCache cache(dir);
+      check(cache.artifactDir("optix") == dir+"/optix",
+            "artifact directories are created");
+    }
+    for (auto &name : listDir(dir))
+      if (name != "optix")
+        remove((dir+"/"+name).c_str());
+
+    checkKeys();
+    checkHitMiss(dir);
+    checkLimits(dir);
+    checkConcurrentRewrites(dir);
+    checkDisabled();
+
+    std::cout << "#glyphs.programCacheCheck: " << numFailed << " check(s) failed"
+              << std::endl;
+    return numFailed;
+  }
+
+}
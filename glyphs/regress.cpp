@@ -0,0 +1,457 @@
+// ======================================================================== //
+// Copyright 2018-2020 The Contributors                                     //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+/*! image regression check: renders a fixed set of small scenes
+    (testdata.glyphs as each glyph type the host back-end has, and
+    with OBJ triangles) with a fixed seed on the cpu back-end, which
+    runs the same intersection and shading code as the device
+    programs, and compares them with stored reference images. A
+    single arrow checks that the closer of head and shaft wins. Super
+    glyphs have no host back-end, so their solver is checked directly:
+    rays through the triangle proxy SuperGlyphs traces, refined by
+    super::intersect(), against a double-precision reference. Exits
+    with the number of scenes (and checks) that are over their
+    tolerance; --update rewrites the references instead */
+
+#include "glyphs/Camera.h"
+#include "glyphs/SuperProxy.h"
+#include "glyphs/cpu/PathTracer.h"
+#include "glyphs/device/roundedCone.h"
+// std
+#include <algorithm>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+#define STB_IMAGE_IMPLEMENTATION 1
+#include "samples/common/3rdParty/stb/stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION 1
+#include "samples/common/3rdParty/stb/stb_image_write.h"
+
+namespace glyphs {
+
+  struct {
+    /*! where testdata.glyphs is */
+    std::string dataDir = ".";
+    std::string refDir  = "res/regression";
+    /*! rendered images, and diff images of failed scenes */
+    std::string outDir  = ".";
+    bool update = false;
+    /*! only these; all if empty */
+    std::vector<std::string> sceneNames;
+    /*! multiplies all tolerances */
+    float toleranceScale = 1.f;
+  } cmdline;
+
+  struct RegressionScene {
+    const char *name;
+    const char *method;
+    /*! adds res/regression/ground.obj */
+    bool triangles;
+    int  shadeMode;
+    int  pathDepth;
+    int  spp;
+    /*! path traced images differ pixel by pixel as soon as any
+        floating point result does; they are compared after a 4x4
+        box filter, which keeps what the eye sees but not the noise */
+    bool noisy;
+  };
+
+  const RegressionScene scenes[] = {
+    { "arrows_normals",     "arrows",     false, device::SHADE_NORMALS, 1, 4,  false },
+    { "arrows_depth",       "arrows",     false, device::SHADE_DEPTH,   1, 4,  false },
+    { "arrows_path",        "arrows",     false, device::SHADE_PATH,    3, 16, true  },
+    { "spheres_normals",    "spheres",    false, device::SHADE_NORMALS, 1, 4,  false },
+    { "spheres_path",       "spheres",    false, device::SHADE_PATH,    3, 16, true  },
+    { "motionblur_path",    "motionblur", false, device::SHADE_PATH,    3, 16, true  },
+    { "triangles_normals",  "arrows",     true,  device::SHADE_NORMALS, 1, 4,  false },
+    { "triangles_path",     "arrows",     true,  device::SHADE_PATH,    3, 16, true  },
+  };
+
+  const vec2i fbSize(128,96);
+  const uint32_t seed = 1;
+
+  /*! names of the checks that aren't images, for --scene */
+  const std::string arrowCheckName = "arrow_head";
+  const std::string superCheckName = "super_solver";
+
+  /*! RMSE over all channels in [0,1], of the images and after a 4x4
+      box filter; and the fraction of pixels where some channel
+      differs by more than 0.2 */
+  struct ImageDiff {
+    double rmse        { 0. };
+    double filteredRMSE { 0. };
+    double badPixels   { 0. };
+  };
+
+  void usage(const std::string &msg)
+  {
+    if (msg != "") std::cerr << "Error: " << msg << std::endl << std::endl;
+    std::cout << "Usage: ./owlGlyphsRegress [--data-dir <dir>] [--ref-dir <dir>]"
+              << " [--out-dir <dir>] [--scene <name>]* [--tolerance-scale <f>]"
+              << " [--update]" << std::endl
+              << "scenes:";
+    for (auto &scene : scenes)
+      std::cout << " " << scene.name;
+    std::cout << " " << arrowCheckName << " " << superCheckName << std::endl;
+    exit(msg != "");
+  }
+
+  /*! top row first, as the files store them */
+  std::vector<uint32_t> flip(const std::vector<uint32_t> &fb)
+  {
+    std::vector<uint32_t> pixels;
+    for (int y=0;y<fbSize.y;y++) {
+      const uint32_t *line = fb.data() + (fbSize.y-1-y)*fbSize.x;
+      for (int x=0;x<fbSize.x;x++)
+        pixels.push_back(line[x] | (0xff << 24));
+    }
+    return pixels;
+  }
+
+  void savePNG(const std::string &fileName, const std::vector<uint32_t> &pixels)
+  {
+    if (!stbi_write_png(fileName.c_str(),fbSize.x,fbSize.y,4,
+                        pixels.data(),fbSize.x*sizeof(uint32_t)))
+      throw std::runtime_error("could not write '"+fileName+"'");
+  }
+
+  /*! empty if there is no such file, or it has another size */
+  std::vector<uint32_t> loadPNG(const std::string &fileName)
+  {
+    int w = 0, h = 0, n = 0;
+    unsigned char *data = stbi_load(fileName.c_str(),&w,&h,&n,STBI_rgb_alpha);
+    std::vector<uint32_t> pixels;
+    if (data && w == fbSize.x && h == fbSize.y)
+      pixels.assign((const uint32_t *)data,(const uint32_t *)data+w*h);
+    if (data)
+      stbi_image_free(data);
+    return pixels;
+  }
+
+  inline float channel(uint32_t rgba, int c)
+  {
+    return ((rgba >> (8*c)) & 0xff)/255.f;
+  }
+
+  ImageDiff compare(const std::vector<uint32_t> &a,
+                    const std::vector<uint32_t> &b)
+  {
+    ImageDiff diff;
+    double sumSq = 0.;
+    size_t bad = 0;
+    for (size_t i=0;i<a.size();i++) {
+      float maxDiff = 0.f;
+      for (int c=0;c<3;c++) {
+        const float d = channel(a[i],c)-channel(b[i],c);
+        sumSq += d*d;
+        maxDiff = std::max(maxDiff,fabsf(d));
+      }
+      bad += maxDiff > .2f;
+    }
+    diff.rmse      = sqrt(sumSq/(3.*a.size()));
+    diff.badPixels = bad/double(a.size());
+
+    const int B = 4;
+    double filteredSumSq = 0.;
+    int numBlocks = 0;
+    for (int by=0;by+B<=fbSize.y;by+=B)
+      for (int bx=0;bx+B<=fbSize.x;bx+=B, numBlocks++)
+        for (int c=0;c<3;c++) {
+          float d = 0.f;
+          for (int y=by;y<by+B;y++)
+            for (int x=bx;x<bx+B;x++)
+              d += channel(a[x+fbSize.x*y],c)-channel(b[x+fbSize.x*y],c);
+          d /= B*B;
+          filteredSumSq += d*d;
+        }
+    diff.filteredRMSE = sqrt(filteredSumSq/(3.*std::max(numBlocks,1)));
+    return diff;
+  }
+
+  /*! absolute difference, times four so small ones show */
+  std::vector<uint32_t> diffImage(const std::vector<uint32_t> &a,
+                                  const std::vector<uint32_t> &b)
+  {
+    std::vector<uint32_t> result(a.size());
+    for (size_t i=0;i<a.size();i++) {
+      uint32_t rgba = 0xff000000u;
+      for (int c=0;c<3;c++) {
+        const float d = std::min(1.f,4.f*fabsf(channel(a[i],c)-channel(b[i],c)));
+        rgba |= uint32_t(d*255.f) << (8*c);
+      }
+      result[i] = rgba;
+    }
+    return result;
+  }
+
+  /*! one frame of 'scene.spp' samples, as the viewer would set it up */
+  std::vector<uint32_t> render(const RegressionScene &scene)
+  {
+    Glyphs::SP glyphs = Glyphs::load(std::vector<std::string>{
+        cmdline.dataDir+"/testdata.glyphs" });
+    Triangles::SP triangles
+      = scene.triangles
+      ? Triangles::load({ cmdline.dataDir+"/res/regression/ground.obj" },vec3f(.8f))
+      : nullptr;
+    cpu::Scene::SP cpuScene = cpu::Scene::create(scene.method,glyphs,triangles);
+    cpu::MegakernelPathTracer tracer(cpuScene);
+
+    device::FrameState fs;
+    fs.samplesPerPixel = scene.spp;
+    fs.shadeMode       = scene.shadeMode;
+    fs.pathDepth       = scene.pathDepth;
+    fs.seed            = seed;
+    const Camera camera = Camera::defaultFor(cpuScene->bounds);
+    camera.setup(fs,fbSize);
+    fs.aoRadius   = .05f*length(cpuScene->bounds.span());
+    fs.depthScale
+      = length(camera.from - cpuScene->bounds.center())
+      + .5f*length(cpuScene->bounds.span());
+
+    std::vector<vec4f>    accumBuffer(fbSize.x*fbSize.y);
+    std::vector<float>    varianceBuffer(fbSize.x*fbSize.y);
+    std::vector<uint32_t> colorBuffer(fbSize.x*fbSize.y);
+    tracer.render(fs,fbSize,accumBuffer.data(),varianceBuffer.data(),colorBuffer.data());
+    return flip(colorBuffer);
+  }
+
+  /*! one arrow along x, and a ray that enters its head and would
+      hit the shaft behind it; the scene has to report the head */
+  bool checkArrowHead(float &t, float &tHead, float &tShaft)
+  {
+    Glyphs::SP glyphs = std::make_shared<Glyphs>();
+    Link tail, tip;
+    tail.pos = vec3f(0.f);    tail.rad = .2f; tail.prev = -1;
+    tip.pos  = vec3f(2.f,0.f,0.f); tip.rad = .2f; tip.prev = 0;
+    glyphs->links = { tail, tip };
+    cpu::Scene::SP scene = cpu::Scene::create("arrows",glyphs,nullptr);
+
+    // what cpu::Scene makes of it: head from x=1.2 (radius .2) to
+    // the tip, shaft of radius .2/3 from 0 to 1.2
+    const vec3f pc(1.2f,0.f,0.f);
+    const cpu::Ray ray(vec3f(2.f,1.f,0.f),normalize(vec3f(-1.f,-1.f,0.f)),0.f,1e8f);
+    vec3f headNormal, shaftNormal;
+    tHead = tShaft = ray.tmax;
+    device::intersectRoundedCone(pc,tip.pos,.2f,.0001f,ray,tHead,headNormal);
+    device::intersectCylinder(pc,tail.pos,.2f/3.f,ray,tShaft,shaftNormal);
+
+    cpu::Ray sceneRay = ray;
+    cpu::Hit hit;
+    device::Random rnd(0,0,0,seed);
+    t = scene->intersect(sceneRay,hit,rnd) ? hit.t : -1.f;
+    return tHead < tShaft
+      && fabsf(t-tHead) < 1e-5f && sceneRay.tmax == hit.t
+      && length(normalize(hit.Ng)-normalize(headNormal)) < 1e-4f;
+  }
+
+  /*! distance along the ray to triangle (a,b,c), or -1 */
+  inline float intersectTriangle(const vec3f &ori, const vec3f &dir,
+                                 const vec3f &a, const vec3f &b, const vec3f &c)
+  {
+    const vec3f e1 = b-a, e2 = c-a;
+    const vec3f p = cross(dir,e2);
+    const float det = dot(e1,p);
+    if (det == 0.f) return -1.f;
+    const vec3f s = ori-a;
+    const float u = dot(s,p)/det;
+    const vec3f q = cross(s,e1);
+    const float v = dot(dir,q)/det;
+    if (u < 0.f || v < 0.f || u+v > 1.f) return -1.f;
+    return dot(e2,q)/det;
+  }
+
+  /*! what SuperGlyphs' proxy mode computes, for random rays at
+      random quadrics: every triangle of the proxy the ray hits starts
+      super::intersect() (as any-hit does), and the closest surface
+      point found wins. Checked against the reference for rays that
+      hit (or miss) the quadric but not the other way round, and for
+      the distance where both hit */
+  struct SuperCheck {
+    int    numRays      { 0 };
+    int    numMissed    { 0 };
+    int    numFalseHits { 0 };
+    double maxErr       { 0. };
+  };
+
+  SuperCheck checkSuperSolver()
+  {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(0.f,1.f);
+    SuperCheck check;
+    for (int shape=0;shape<16;shape++) {
+      // the shapes mapToSuperQuadric() makes, and the tessellation
+      // addTessellation() makes of them
+      const super::Quadric q = {
+        1.f+2.f*uniform(rng), 1.f+2.f*uniform(rng), 1.f+2.f*uniform(rng), 1.f, 1.f, 1.f
+      };
+      std::vector<vec3f> vertices, colors;
+      std::vector<vec3i> indices;
+      tessellate(q,-M_PI,M_PI,.8f,-M_PI/2.f,M_PI/2.f,.8f,
+                 vertices,indices,colors,affine3f());
+
+      for (int i=0;i<1024;i++) {
+        vec3f dir;
+        do {
+          dir = 2.f*vec3f(uniform(rng),uniform(rng),uniform(rng))-1.f;
+        } while (dot(dir,dir) > 1.f || dot(dir,dir) < 1e-3f);
+        const vec3f ori = 4.f*normalize(dir);
+        const vec3f target = 2.4f*(vec3f(uniform(rng),uniform(rng),uniform(rng))-.5f);
+        dir = normalize(target-ori);
+
+        bool  found = false;
+        float t = 1e20f;
+        for (auto &tri : indices) {
+          const float tEnter = intersectTriangle(ori,dir,vertices[tri.x],
+                                                 vertices[tri.y],vertices[tri.z]);
+          super::Hit hit;
+          if (tEnter >= 0.f && super::intersect(q,ori,dir,tEnter,1e20f,hit)) {
+            found = true;
+            t = std::min(t,hit.t);
+          }
+        }
+        double tRef;
+        const bool refHit = referenceSuper(q,ori,dir,0.,8.,tRef);
+        check.numRays++;
+        check.numMissed    += refHit && !found;
+        check.numFalseHits += found && !refHit;
+        if (found && refHit)
+          check.maxErr = std::max(check.maxErr,fabs(t-tRef));
+      }
+    }
+    return check;
+  }
+
+  extern "C" int main(int argc, char **argv)
+  {
+    for (int i=1;i<argc;i++) {
+      const std::string arg = argv[i];
+      if (arg == "--data-dir")
+        cmdline.dataDir = argv[++i];
+      else if (arg == "--ref-dir")
+        cmdline.refDir = argv[++i];
+      else if (arg == "--out-dir")
+        cmdline.outDir = argv[++i];
+      else if (arg == "--scene")
+        cmdline.sceneNames.push_back(argv[++i]);
+      else if (arg == "--tolerance-scale")
+        cmdline.toleranceScale = std::atof(argv[++i]);
+      else if (arg == "--update")
+        cmdline.update = true;
+      else if (arg == "-h" || arg == "--help")
+        usage("");
+      else
+        usage("unknown cmdline arg '"+arg+"'");
+    }
+    for (auto &name : cmdline.sceneNames) {
+      bool known = name == arrowCheckName || name == superCheckName;
+      for (auto &scene : scenes)
+        known |= name == scene.name;
+      if (!known)
+        usage("unknown scene '"+name+"'");
+    }
+
+    std::stringstream table;
+    table << std::left << std::setw(20) << "scene" << std::right
+          << std::setw(10) << "rmse"
+          << std::setw(10) << "filtered"
+          << std::setw(10) << "bad %"
+          << "  result" << std::endl;
+    int numFailed = 0;
+    for (auto &scene : scenes) {
+      if (!cmdline.sceneNames.empty()
+          && std::find(cmdline.sceneNames.begin(),cmdline.sceneNames.end(),
+                       scene.name) == cmdline.sceneNames.end())
+        continue;
+      const std::vector<uint32_t> image = render(scene);
+      const std::string refFileName = cmdline.refDir+"/"+scene.name+".png";
+      if (cmdline.update) {
+        savePNG(refFileName,image);
+        std::cout << "#glyphs.regress: wrote '" << refFileName << "'" << std::endl;
+        continue;
+      }
+      savePNG(cmdline.outDir+"/"+scene.name+".png",image);
+
+      table << std::left << std::setw(20) << scene.name << std::right;
+      const std::vector<uint32_t> reference = loadPNG(refFileName);
+      if (reference.empty()) {
+        table << std::setw(30) << ""
+              << "  FAILED: no reference '" << refFileName
+              << "' (see --update)" << std::endl;
+        numFailed++;
+        continue;
+      }
+      const ImageDiff diff = compare(image,reference);
+      const float s = cmdline.toleranceScale;
+      // another seed stays well within these: about half of them
+      // for clean images, and a third for noisy ones
+      const bool failed
+        = scene.noisy
+        ? (diff.filteredRMSE > .012*s || diff.rmse > .08*s)
+        : (diff.filteredRMSE > .008*s || diff.rmse > .025*s || diff.badPixels > .01*s);
+      table << std::fixed << std::setprecision(4)
+            << std::setw(10) << diff.rmse
+            << std::setw(10) << diff.filteredRMSE
+            << std::setw(10) << std::setprecision(2) << 100.*diff.badPixels
+            << "  " << (failed ? "FAILED" : "ok") << std::endl;
+      if (failed) {
+        savePNG(cmdline.outDir+"/"+scene.name+"_diff.png",diffImage(image,reference));
+        numFailed++;
+      }
+    }
+    auto selected = [](const std::string &name) {
+      return cmdline.sceneNames.empty()
+      || std::find(cmdline.sceneNames.begin(),cmdline.sceneNames.end(),
+                   name) != cmdline.sceneNames.end();
+    };
+    if (!cmdline.update && selected(arrowCheckName)) {
+      float t, tHead, tShaft;
+      const bool ok = checkArrowHead(t,tHead,tShaft);
+      table << std::left << std::setw(20) << arrowCheckName << std::right
+            << std::fixed << std::setprecision(4)
+            << "  t " << t << ", head at " << tHead << ", shaft at " << tShaft
+            << "  " << (ok ? "ok" : "FAILED") << std::endl;
+      numFailed += !ok;
+    }
+    if (!cmdline.update && selected(superCheckName)) {
+      const SuperCheck check = checkSuperSolver();
+      const float s = cmdline.toleranceScale;
+      const double missed    = check.numMissed/double(check.numRays);
+      const double falseHits = check.numFalseHits/double(check.numRays);
+      // the reference and the solver disagree only on grazing rays,
+      // and by about the solver's tolerance
+      const bool failed
+        = missed > .001*s || falseHits > .001*s || check.maxErr > 5e-4*s;
+      table << std::left << std::setw(20) << superCheckName << std::right
+            << "  " << check.numRays << " rays: "
+            << std::fixed << std::setprecision(3)
+            << 100.*missed << "% missed, " << 100.*falseHits << "% false hits, "
+            << std::scientific << std::setprecision(2)
+            << "max |dt| " << check.maxErr << std::defaultfloat
+            << "  " << (failed ? "FAILED" : "ok") << std::endl;
+      numFailed += failed;
+    }
+    if (!cmdline.update) {
+      std::cout << table.str();
+      std::cout << "#glyphs.regress: " << numFailed << " check(s) failed";
+      if (numFailed)
+        std::cout << "; images and diffs are in '" << cmdline.outDir << "'";
+      std::cout << std::endl;
+    }
+    return numFailed;
+  }
+
+}
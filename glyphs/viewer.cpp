@@ -20,6 +20,10 @@
 #include "MotionSpheres.h"
 #include "SphereGlyphs.h"
 #include "SuperGlyphs.h"
+#include "Timings.h"
+#include "BenchStats.h"
+#include "CameraPath.h"
+#include <cuda_runtime.h>
 #include <math.h>
 // std
 #include <queue>
@@ -52,6 +56,70 @@ namespace glyphs {
     } camera;
     vec2i windowSize = vec2i(800,800);
     bool measure = false;
+    /*! with --measure: run until the mean per-pixel relative error
+        estimate drops below this, and report the time it took */
+    float targetError = 0.f;
+    float adaptiveThreshold = 0.f;
+    int adaptiveMinSamples = 16;
+    int samplerType = device::SAMPLER_SOBOL;
+    int sunSampling = device::SUN_SAMPLING_MIS;
+    int rouletteDepth = 3;
+    int shading = device::SHADING_DISNEY;
+    /*! super glyph modes; with --measure, each is measured in turn */
+    std::vector<int> superModes;
+    int aoSamples = 4;
+    /*! 0: 5% of the scene diagonal */
+    float aoRadius = 0.f;
+    /*! print rays per frame, by kind, once a second */
+    bool rayStats = false;
+    /*! print the per-pixel work counters once a second (needs
+        GLYPHS_STATS) */
+    bool pixelStats = false;
+    /*! heat map shows this PixelCounter rather than clock cycles */
+    int heatMapCounter = -1;
+    float rebuildThreshold = 1.5f;
+    /*! motion frames while the camera moves, aiming for this frame
+        time; 0 turns them off */
+    float motionTargetMs = 33.f;
+    /*! temporal reprojection of the accumulation across camera moves */
+    bool reproject = false;
+    int reprojectMaxSpp = 64;
+    /*! half precision accumulation buffer */
+    bool halfAccum = false;
+    /*! if > 0, update the displayed image at most this often (the
+        first frame of an accumulation always shows) */
+    float displayIntervalMs = 0.f;
+    /*! print the startup phase timings before opening the window */
+    bool timings = false;
+    /*! ... and/or write them to this file as JSON */
+    std::string timingsJSON;
+    /*! print memory per subsystem after the first frame */
+    bool memoryReport = false;
+    /*! device memory budget in MB; 0 is none */
+    float memoryBudgetMB = 0.f;
+    /*! deterministic benchmark: this many untimed warmup frames,
+        then benchFrames frames (of a fresh accumulation) timed one
+        by one, reported as JSON (see BenchStats.h) */
+    bool bench = false;
+    int benchWarmup = 16;
+    int benchFrames = 64;
+    /*! if > 0, overrides benchFrames: as many frames as it takes to
+        get this many samples per pixel */
+    int benchSpp = 0;
+    /*! where the JSON goes; stdout if empty */
+    std::string benchJSON;
+    /*! see FrameState::seed */
+    uint32_t seed = 0;
+    /*! see datasetName() */
+    std::string dataset;
+    /*! append the camera to this file whenever it moved, at most
+        every recordIntervalMs (see CameraPath.h) */
+    std::string recordPath;
+    float recordIntervalMs = 100.f;
+    /*! benchmark (as --bench) a playback of this camera path, with
+        framesPerKey frames from each key to the next */
+    std::string playPath;
+    int framesPerKey = 8;
     DisneyMaterial material;
 
     std::vector<std::string> objFileNames;
@@ -79,7 +147,35 @@ namespace glyphs {
     std::vector<std::string> args;
 
     std::vector<Glyphs::SP> glyphs;
+    int timestep = 0;
     Triangles::SP triangles;
+    /*! rays traced since start, for --measure */
+    double measureRays = 0.;
+    /*! with --measure, index into cmdline.superModes */
+    size_t measuredSuperModes = 0;
+    /*! with --bench: warmup frames done so far, and the timed ones */
+    int benchWarmupDone = 0;
+    BenchRun benchRun;
+    /*! --play-path */
+    CameraPath cameraPath;
+    /*! --record-path: where keys go, and the last one written */
+    std::ofstream recordFile;
+    std::string lastRecordedKey;
+    double lastRecordTime = -1.;
+    /*! for scaling the SHADE_DEPTH preview */
+    box3f sceneBounds;
+    /*! picks the motion frame block size */
+    device::MotionScaleController motionScale;
+    /*! time of the last cameraChanged(); we render motion frames
+        until the camera has been still for a little while */
+    double lastCameraChange = -1.;
+    /*! temporal reprojection: whether the current half of the
+        buffers holds history that can be reprojected, and the frame
+        state (camera) it was accumulated with */
+    bool historyValid = false;
+    device::FrameState historyView;
+    /*! with FrameState::deferDisplay: when the display pass last ran */
+    double lastDisplay = -1.;
     
     GlyphsViewer(Renderer &renderer)
       : OWLViewer("owlGlyps"),
@@ -88,6 +184,16 @@ namespace glyphs {
       owl = static_cast<OWLGlyphs *>(&renderer);
     }
 
+    /*! the viewer's camera as from/at/up */
+    Camera currentCamera() const
+    {
+      Camera c;
+      c.from = camera.position;
+      c.at   = camera.getPOI();
+      c.up   = camera.upVector;
+      return c;
+    }
+
     std::string printCamera(std::ostream &os) const {
 
       const auto &fc = camera;
@@ -96,27 +202,47 @@ namespace glyphs {
       os << "- poi  :" << fc.getPOI() << std::endl;
       os << "- upVec:" << fc.upVector << std::endl;
       os << "- frame:" << fc.frame << std::endl;
-      std::stringstream str;
-      str.precision(10);
-      str << "--camera "
-          << fc.position.x << " "
-          << fc.position.y << " "
-          << fc.position.z << " "
-          << fc.getPOI().x << " "
-          << fc.getPOI().y << " "
-          << fc.getPOI().z << " "
-          << fc.upVector.x << " "
-          << fc.upVector.y << " "
-          << fc.upVector.z;
-      std::cout << "cmdline: " << str.str() << std::endl;
-      return str.str();
+      const std::string str = currentCamera().cmdline();
+      std::cout << "cmdline: " << str << std::endl;
+      return str;
+    }
+
+    /*! --record-path: append the camera as a key if it moved, at
+        most every recordIntervalMs */
+    void recordCameraKey()
+    {
+      const double now = getCurrentTime();
+      if (now - lastRecordTime < 1e-3*cmdline.recordIntervalMs)
+        return;
+      const std::string key = CameraPath::keyLine(currentCamera());
+      if (key == lastRecordedKey)
+        return;
+      recordFile << key << std::endl;
+      lastRecordedKey = key;
+      lastRecordTime  = now;
+    }
+
+    /*! --play-path: put the camera where the path is at the next
+        timed frame (at the first key during warmup); every frame is
+        a fresh accumulation, as while navigating */
+    void playCameraPath()
+    {
+      const int frame
+        = benchWarmupDone < cmdline.benchWarmup
+        ? 0
+        : int(benchRun.numFrames());
+      const Camera c = cameraPath.at(frame,cmdline.framesPerKey);
+      setCameraOrientation(c.from,c.at,c.up,c.fovy);
     }
     
     void screenShot()
     {
       std::string method = cmdline.method;
+      SuperGlyphs *superGlyphs = dynamic_cast<SuperGlyphs *>(owl);
+      if (superGlyphs)
+        method += std::string("_")+SuperGlyphs::modeName(superGlyphs->mode);
       const std::string fileName
-        = cmdline.measure
+        = ((cmdline.measure || cmdline.bench) && cmdline.superModes.size() < 2)
         ? screenShotFileName
         : (method+"_"+screenShotFileName);
 
@@ -144,15 +270,107 @@ namespace glyphs {
       // }
       // stbi_write_png(fileName.c_str(),fbSize.x,fbSize.y,4,
       //                pixels.data(),fbSize.x*sizeof(uint32_t));
+      if (frameState.deferDisplay && frameState.motionScale == 0)
+        owl->display();
       inherited::screenShot(fileName);
       std::cout << "screenshot saved in '" << fileName << "'" << std::endl;
     }
     
+    /*! --bench is done: write the JSON, a one-line summary, and the
+        screenshot */
+    void finishBench()
+    {
+      std::string method = cmdline.method;
+      SuperGlyphs *superGlyphs = dynamic_cast<SuperGlyphs *>(owl);
+      if (superGlyphs)
+        method += std::string("_")+SuperGlyphs::modeName(superGlyphs->mode);
+      std::string argString;
+      for (const auto &a : args)
+        argString += (argString.empty() ? "" : " ")+a;
+      benchRun.warmupFrames    = cmdline.benchWarmup;
+      benchRun.samplesPerPixel = int(benchRun.numFrames())*frameState.samplesPerPixel;
+      benchRun.seed            = frameState.seed;
+      BenchRun::Config config = {
+        { "tool",    "owlGlyphsViewer" },
+        { "method",  method },
+        { "dataset", cmdline.dataset },
+        { "size",    std::to_string(fbSize.x)+"x"+std::to_string(fbSize.y) },
+        { "spp",     std::to_string(frameState.samplesPerPixel) },
+        { "depth",   std::to_string(frameState.pathDepth) },
+        { "sampler", frameState.samplerType == device::SAMPLER_SOBOL ? "sobol" : "random" },
+        { "args",    argString }
+      };
+      if (!cameraPath.keys.empty()) {
+        config.push_back({ "path", cmdline.playPath });
+        config.push_back({ "framesPerKey", std::to_string(cmdline.framesPerKey) });
+      }
+      if (cmdline.benchJSON.empty()) {
+        benchRun.printJSON(std::cout,config);
+        std::cout << std::endl;
+      }
+      else {
+        std::ofstream out(cmdline.benchJSON);
+        if (!out)
+          throw std::runtime_error("could not open '"+cmdline.benchJSON+"'");
+        benchRun.printJSON(out,config);
+        out << std::endl;
+        std::cout << "bench results saved in '" << cmdline.benchJSON << "'" << std::endl;
+      }
+      std::cout << "BENCH_FRAME_MS median " << 1000.*benchRun.percentile(50.)
+                << " p95 " << 1000.*benchRun.percentile(95.)
+                << " p99 " << 1000.*benchRun.percentile(99.)
+                << " MRAYS_PER_SECOND " << benchRun.mraysPerSecond() << std::endl;
+      screenShot();
+    }
+
     void updateFrameState()
     {
       owl->updateFrameState(frameState);
     }
 
+    /*! restart accumulation for anything but a camera change (new
+        shading, timestep, ...), where the history accumulated so far
+        can't be reprojected */
+    void restartAccumulation()
+    {
+      frameState.accumID = 0;
+      historyValid = false;
+      updateFrameState();
+    }
+
+    /*! with temporal reprojection, at the start of each accumulation
+        (that isn't a motion frame): have raygen reproject the last
+        accumulation's history if it is still valid, into the other
+        half of the buffers (see device/Reprojection.h) */
+    void startHistory()
+    {
+      if (!frameState.historyEnabled
+          || frameState.accumID != 0
+          || frameState.motionScale != 0)
+        return;
+      frameState.reproject = historyValid;
+      if (historyValid) {
+        frameState.historyIndex ^= 1;
+        frameState.prev_camera_screen_00   = historyView.camera_screen_00;
+        frameState.prev_camera_screen_du   = historyView.camera_screen_du;
+        frameState.prev_camera_screen_dv   = historyView.camera_screen_dv;
+        frameState.prev_camera_lens_center = historyView.camera_lens_center;
+      }
+      historyView  = frameState;
+      historyValid = true;
+      updateFrameState();
+    }
+
+    /*! step to the next/previous timestep, if there's more than one */
+    void stepTimestep(int delta)
+    {
+      if (glyphs.size() < 2) return;
+      timestep = (timestep + delta + (int)glyphs.size()) % (int)glyphs.size();
+      std::cout << "#glyphs.viewer: timestep " << timestep << std::endl;
+      owl->setTimestep(glyphs[timestep]);
+      restartAccumulation();
+    }
+
 
     // /*! this function gets called whenever the viewer widget changes camera settings */
     virtual void cameraChanged() override 
@@ -169,6 +387,29 @@ namespace glyphs {
       frameState.camera_lens_center = camera.lens.center;
       frameState.camera_lens_du = camera.lens.du;
       frameState.camera_lens_dv = camera.lens.dv;
+      frameState.depthScale
+        = length(camera.lens.center - sceneBounds.center())
+        + .5f*length(sceneBounds.span());
+      frameState.accumID = 0;
+      lastCameraChange = getCurrentTime();
+      updateFrameState();
+    }
+
+    /*! switches between motion and regular frames: motion frames
+        while the camera moved within the last few target frame
+        times, then regular ones, restarting accumulation */
+    void updateMotionScale()
+    {
+      if (motionScale.targetFrameTime <= 0.)
+        return;
+      const double settleTime = std::max(.1,4.*motionScale.targetFrameTime);
+      const bool moving
+        = lastCameraChange >= 0.
+        && getCurrentTime() - lastCameraChange < settleTime;
+      const int scale = moving ? motionScale.scale : 0;
+      if (scale == frameState.motionScale)
+        return;
+      frameState.motionScale = scale;
       frameState.accumID = 0;
       updateFrameState();
     }
@@ -185,6 +426,8 @@ namespace glyphs {
       // update camera as well, since resize changed both aspect and
       // u/v pixel delta vectors ...
       updateCamera();
+      // buffers got resized, history is gone
+      historyValid = false;
       owlBuildSBT(owl->context);
     }
     
@@ -192,7 +435,26 @@ namespace glyphs {
     virtual void render() override
     {
       static double t_last = -1;
+      if (recordFile.is_open())
+        recordCameraKey();
+      if (!cameraPath.keys.empty())
+        playCameraPath();
+      updateMotionScale();
+      startHistory();
+      const double t_begin = getCurrentTime();
       owl->render();
+      if (frameState.motionScale > 0)
+        motionScale.update(getCurrentTime()-t_begin);
+      else if (frameState.deferDisplay
+               && (frameState.accumID == 0
+                   || getCurrentTime() - lastDisplay >= 1e-3*cmdline.displayIntervalMs)) {
+        owl->display();
+        lastDisplay = getCurrentTime();
+      }
+      if (cmdline.bench)
+        // launches are asynchronous; time the frame, not the launch
+        cudaDeviceSynchronize();
+      const double frameTime = getCurrentTime()-t_begin;
       
       double t_now = getCurrentTime();
       static double avg_t = 0.;
@@ -206,15 +468,120 @@ namespace glyphs {
         this->setTitle(title);
       }
       t_last = t_now;
+
+      if (frameState.rayStatsEnabled) {
+        static double stats_begin = t_now;
+        static int statsFrames = 0;
+        static device::RayStats stats;
+        stats += owl->getRayStats();
+        statsFrames++;
+        if (cmdline.rayStats && t_now - stats_begin > 1.f) {
+          std::cout << "#glyphs.viewer: rays/frame "
+                    << prettyNumber(stats.total()/statsFrames)
+                    << " (primary " << prettyNumber(stats.primary/statsFrames)
+                    << ", bounce " << prettyNumber(stats.bounce/statsFrames)
+                    << ", shadow " << prettyNumber(stats.shadow/statsFrames)
+                    << "), paths ended by roulette "
+                    << prettyNumber(stats.roulette/statsFrames) << std::endl;
+          stats_begin = t_now;
+          statsFrames = 0;
+          stats = device::RayStats();
+        }
+        measureRays += owl->getRayStats().total();
+      }
+
+      if (cmdline.memoryReport) {
+        static bool reported = false;
+        if (!reported) {
+          std::cout << "#glyphs.viewer: memory after the first frame:" << std::endl;
+          owl->memory.printReport(std::cout);
+          reported = true;
+        }
+      }
+
+      if (cmdline.pixelStats && frameState.motionScale == 0) {
+        static double stats_begin = t_now;
+        if (t_now - stats_begin > 1.f) {
+          std::cout << "#glyphs.viewer: counters of the last frame:" << std::endl;
+          owl->getPixelStats().print(std::cout);
+          stats_begin = t_now;
+        }
+      }
       
-      if (cmdline.measure) {
+      if (cmdline.bench) {
+        if (benchWarmupDone < cmdline.benchWarmup) {
+          if (++benchWarmupDone == cmdline.benchWarmup) {
+            // the timed frames start their own accumulation, so the
+            // final image has exactly benchFrames*spp samples
+            restartAccumulation();
+            return;
+          }
+        }
+        else {
+          benchRun.addFrame(frameTime,owl->getRayStats().total());
+          if (benchRun.numFrames() >= size_t(cmdline.benchFrames)) {
+            finishBench();
+            exit(0);
+          }
+        }
+      }
+
+      if (cmdline.measure && cmdline.targetError > 0.f) {
+        static double measure_begin = t_now;
+        static int numFrames = 0;
+        static double numSamples = 0.;
+        numFrames++;
+
+        const device::ErrorStats stats = owl->getErrorStats();
+        numSamples += stats.samplesPerPixel;
+        if (stats.meanRelativeError <= cmdline.targetError) {
+          std::cout << "MEASURE_TIME_TO_ERROR " << (t_now-measure_begin)
+                    << " frames " << numFrames
+                    << " spp " << numSamples
+                    << " error " << stats.meanRelativeError << std::endl;
+          std::cout << "MEASURE_RAYS_PER_FRAME " << (measureRays/numFrames) << std::endl;
+          screenShot();
+          exit(0);
+        }
+        if (t_now - measure_begin > 600.f) {
+          std::cout << "MEASURE_TIME_TO_ERROR not reached after "
+                    << (t_now-measure_begin) << "s, error is still "
+                    << stats.meanRelativeError << std::endl;
+          exit(1);
+        }
+      }
+      else if (cmdline.measure) {
         static double measure_begin = t_now;
         static int numFrames = 0;
         
         if (t_now - measure_begin > 10.f) {
-          std::cout << "MEASURE_FPS " << (numFrames/(t_now-measure_begin)) << std::endl;
+          SuperGlyphs *superGlyphs = dynamic_cast<SuperGlyphs *>(owl);
+          std::cout << "MEASURE_FPS " << (numFrames/(t_now-measure_begin));
+          if (superGlyphs)
+            std::cout << " super-mode " << SuperGlyphs::modeName(superGlyphs->mode);
+          std::cout << std::endl;
+          std::cout << "MEASURE_RAYS_PER_FRAME " << (measureRays/std::max(numFrames,1)) << std::endl;
+          std::cout << "MEASURE_PEAK_MEMORY device "
+                    << owl->memory.peakTotal(false)/(1024.*1024.)
+                    << " host " << owl->memory.peakTotal(true)/(1024.*1024.)
+                    << std::endl;
+#if GLYPHS_STATS
+          const device::PixelStatsSummary pixelStats = owl->getPixelStats();
+          std::cout << "MEASURE_PIXEL_STATS";
+          for (int i=0;i<device::NUM_PIXEL_COUNTERS;i++)
+            std::cout << " " << device::pixelCounterName(i) << " " << pixelStats.perPixel(i);
+          std::cout << std::endl;
+#endif
           screenShot();
-          exit(0);
+          if (!superGlyphs || ++measuredSuperModes >= cmdline.superModes.size())
+            exit(0);
+          // next super glyph mode, on the same data
+          superGlyphs->setMode(cmdline.superModes[measuredSuperModes],glyphs[timestep],triangles);
+          measure_begin = getCurrentTime();
+          numFrames = 0;
+          measureRays = 0.;
+          restartAccumulation();
+          return;
         }
         numFrames++;
       }
@@ -233,31 +600,42 @@ namespace glyphs {
         break;
       case '<':
         frameState.heatMapScale *= 1.5f;
-        frameState.accumID = 0;
-        updateFrameState();
+        restartAccumulation();
         break;
       case '>':
         frameState.heatMapScale /= 1.5f;
-        frameState.accumID = 0;
-        updateFrameState();
+        restartAccumulation();
         break;
 
       case '^':
         frameState.dbgPixel = where;
-        frameState.accumID = 0;
-        updateFrameState();
+        restartAccumulation();
         break;
         
       case 'h':
       case 'H':
         frameState.heatMapEnabled ^= 1;
         PRINT((int)frameState.heatMapEnabled);
-        frameState.accumID = 0;
-        updateFrameState();
+        restartAccumulation();
+        break;
+      case 'l':
+      case 'L':
+        frameState.shading
+          = frameState.shading == device::SHADING_FAST
+          ? device::SHADING_DISNEY
+          : device::SHADING_FAST;
+        PRINT(frameState.shading);
+        restartAccumulation();
         break;
       case 'V':
         displayFPS = !displayFPS;
         break;
+      case ']':
+        stepTimestep(+1);
+        break;
+      case '[':
+        stepTimestep(-1);
+        break;
       case 'C':
         printCamera(std::cout);
         break;
@@ -271,10 +649,13 @@ namespace glyphs {
       case '7':
       case '8':
       case '9':
+        if (key - '0' >= device::NUM_SHADE_MODES) {
+          std::cout << "#glyphs.viewer: no shade mode " << key << std::endl;
+          break;
+        }
         frameState.shadeMode = (key - '0');
         PRINT(frameState.shadeMode);
-        frameState.accumID = 0;
-        updateFrameState();
+        restartAccumulation();
         break;
       case 'q':
 #ifndef WIN32
@@ -347,6 +728,16 @@ namespace glyphs {
       else if (arg == "--super" || arg == "-spr") {
         cmdline.method = "super";
       }
+      else if (arg == "--super-mode") {
+        const std::string mode = argv[++i];
+        args.emplace_back(argv[i]);
+        cmdline.method = "super";
+        if (mode == "all")
+          for (int m=0;m<super::NUM_MODES;m++)
+            cmdline.superModes.push_back(m);
+        else
+          cmdline.superModes.push_back(SuperGlyphs::modeFromName(mode));
+      }
       else if (arg == "--motionblur" || arg == "-mb") {
         cmdline.method = "motionblur";
       }
@@ -356,6 +747,16 @@ namespace glyphs {
       else if (arg == "-sm" || arg == "--shade-mode") {
         cmdline.shadeMode = std::atoi(argv[++i]);
         args.emplace_back(argv[i]);
+        if (cmdline.shadeMode < 0 || cmdline.shadeMode >= device::NUM_SHADE_MODES)
+          usage("unknown shade mode '"+std::string(argv[i])+"'");
+      }
+      else if (arg == "--ao-samples") {
+        cmdline.aoSamples = std::atoi(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--ao-radius") {
+        cmdline.aoRadius = std::atof(argv[++i]);
+        args.emplace_back(argv[i]);
       }
       else if (arg == "--rec-depth" || arg == "-rd") {
         cmdline.pathDepth = std::atoi(argv[++i]);
@@ -364,6 +765,146 @@ namespace glyphs {
       else if (arg == "-measure" || arg == "--measure") {
         cmdline.measure = true;
       }
+      else if (arg == "--bench") {
+        cmdline.bench = true;
+      }
+      else if (arg == "--warmup") {
+        cmdline.benchWarmup = std::atoi(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--bench-frames") {
+        cmdline.benchFrames = std::atoi(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--bench-spp") {
+        cmdline.benchSpp = std::atoi(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--bench-json") {
+        cmdline.benchJSON = argv[++i];
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--seed") {
+        cmdline.seed = uint32_t(std::stoul(argv[++i]));
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--program-cache") {
+        const std::string dir = argv[++i];
+        args.emplace_back(argv[i]);
+        OWLGlyphs::programCacheDir = dir == "off" ? "" : dir;
+      }
+      else if (arg == "--record-path") {
+        cmdline.recordPath = argv[++i];
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--record-interval") {
+        cmdline.recordIntervalMs = std::atof(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--play-path") {
+        cmdline.playPath = argv[++i];
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--frames-per-key") {
+        cmdline.framesPerKey = std::atoi(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--target-error") {
+        cmdline.targetError = std::atof(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--adaptive") {
+        cmdline.adaptiveThreshold = std::atof(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--adaptive-min-spp") {
+        cmdline.adaptiveMinSamples = std::atoi(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--sun-sampling") {
+        const std::string strategy = argv[++i];
+        args.emplace_back(argv[i]);
+        if (strategy == "bsdf")
+          cmdline.sunSampling = device::SUN_SAMPLING_BSDF;
+        else if (strategy == "nee")
+          cmdline.sunSampling = device::SUN_SAMPLING_NEE;
+        else if (strategy == "mis")
+          cmdline.sunSampling = device::SUN_SAMPLING_MIS;
+        else
+          usage("unknown sun sampling strategy '"+strategy+"'");
+      }
+      else if (arg == "--roulette-depth") {
+        cmdline.rouletteDepth = std::atoi(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--fast-shading") {
+        cmdline.shading = device::SHADING_FAST;
+      }
+      else if (arg == "--ray-stats") {
+        cmdline.rayStats = true;
+      }
+      else if (arg == "--pixel-stats") {
+        if (!GLYPHS_STATS)
+          usage("--pixel-stats needs a build with GLYPHS_STATS");
+        cmdline.pixelStats = true;
+      }
+      else if (arg == "--heat-map-counter") {
+        const std::string counter = argv[++i];
+        args.emplace_back(argv[i]);
+        if (!GLYPHS_STATS)
+          usage("--heat-map-counter needs a build with GLYPHS_STATS");
+        for (int c=0;c<device::NUM_PIXEL_COUNTERS;c++)
+          if (counter == device::pixelCounterName(c))
+            cmdline.heatMapCounter = c;
+        if (cmdline.heatMapCounter < 0)
+          usage("unknown counter '"+counter+"'");
+      }
+      else if (arg == "--sampler") {
+        const std::string sampler = argv[++i];
+        args.emplace_back(argv[i]);
+        if (sampler == "random")
+          cmdline.samplerType = device::SAMPLER_RANDOM;
+        else if (sampler == "sobol")
+          cmdline.samplerType = device::SAMPLER_SOBOL;
+        else
+          usage("unknown sampler '"+sampler+"'");
+      }
+      else if (arg == "--motion-target-ms") {
+        cmdline.motionTargetMs = std::atof(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--reproject") {
+        cmdline.reproject = true;
+      }
+      else if (arg == "--reproject-max-spp") {
+        cmdline.reprojectMaxSpp = std::atoi(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--half-accum") {
+        cmdline.halfAccum = true;
+      }
+      else if (arg == "--display-interval") {
+        cmdline.displayIntervalMs = std::atof(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--timings") {
+        cmdline.timings = true;
+      }
+      else if (arg == "--timings-json") {
+        cmdline.timingsJSON = argv[++i];
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--memory") {
+        cmdline.memoryReport = true;
+      }
+      else if (arg == "--memory-budget") {
+        cmdline.memoryBudgetMB = std::atof(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
+      else if (arg == "--rebuild-threshold") {
+        cmdline.rebuildThreshold = std::atof(argv[++i]);
+        args.emplace_back(argv[i]);
+      }
       else if (arg == "-triobj" ||
                arg == "-obj" ||
                arg == "-quadobj"
@@ -377,16 +918,35 @@ namespace glyphs {
 
     if (fileNames.empty())
       usage("No glyph file name provided. See testdata.glyphs in project root directory.");
+    cmdline.dataset = datasetName(fileNames);
+    CameraPath cameraPath;
+    if (!cmdline.playPath.empty()) {
+      if (cmdline.framesPerKey < 1)
+        usage("--frames-per-key needs at least one frame");
+      cameraPath = CameraPath::load(cmdline.playPath);
+      cmdline.bench = true;
+    }
+    if (cmdline.bench && cmdline.measure)
+      usage("--bench and --measure don't go together");
+    if (!cameraPath.keys.empty())
+      cmdline.benchFrames = cameraPath.numFrames(cmdline.framesPerKey);
+    else if (cmdline.benchSpp > 0)
+      cmdline.benchFrames = (cmdline.benchSpp+cmdline.spp-1)/cmdline.spp;
+    if (cmdline.bench && cmdline.benchFrames < 1)
+      usage("--bench needs at least one frame");
 
     // ------------------------------------------------------------------
     // load input data
     // ------------------------------------------------------------------
     std::vector<Glyphs::SP> glyphs;
-    for (Glyphs::SP curGlyphs = Glyphs::load(fileNames);
-         curGlyphs;
-         curGlyphs = curGlyphs->nextTimestep) {
+    {
+      ScopedTimer timer("load glyphs");
+      for (Glyphs::SP curGlyphs = Glyphs::load(fileNames);
+           curGlyphs;
+           curGlyphs = curGlyphs->nextTimestep) {
 
-      glyphs.push_back(curGlyphs);
+        glyphs.push_back(curGlyphs);
+      }
     }
     if (glyphs.empty()) {
       std::cout << "did not load any glyphs" << std::endl;
@@ -394,6 +954,7 @@ namespace glyphs {
 
     Triangles::SP triangles = nullptr;
     if (cmdline.objFileNames.size() > 0) {
+      ScopedTimer timer("load obj");
       triangles = Triangles::load(cmdline.objFileNames,vec3f(.8f));
     }
 
@@ -403,23 +964,45 @@ namespace glyphs {
     std::cout << "#glyphs.viewer: creating back-end ..." << std::endl;
     OWLGlyphs *owlGlyphs = nullptr;
     Renderer *rend = nullptr;
-   
-    if (cmdline.method == "arrows") {
-      owlGlyphs = new ArrowGlyphs;
-    }
-    else if (cmdline.method == "spheres") {
-      owlGlyphs = new SphereGlyphs;
-    }
-    else if (cmdline.method == "super") {
-      owlGlyphs = new SuperGlyphs;
+
+    {
+      ScopedTimer timer("create renderer");
+      if (cmdline.method == "arrows") {
+        owlGlyphs = new ArrowGlyphs;
+      }
+      else if (cmdline.method == "spheres") {
+        owlGlyphs = new SphereGlyphs;
+      }
+      else if (cmdline.method == "super") {
+        owlGlyphs
+          = new SuperGlyphs(cmdline.superModes.empty()
+                            ? super::MODE_PROXY
+                            : cmdline.superModes[0]);
+      }
+      else if (cmdline.method == "motionblur") {
+        owlGlyphs = new MotionSpheres;
+      }
+      else
+        throw std::runtime_error("unknown glyphs method '"+cmdline.method+"'");
     }
-    else if (cmdline.method == "motionblur") {
-      owlGlyphs = new MotionSpheres;
+    owlGlyphs->rebuildThreshold = cmdline.rebuildThreshold;
+    owlGlyphs->temporalReprojection = cmdline.reproject;
+    owlGlyphs->halfAccum = cmdline.halfAccum;
+    owlGlyphs->memory.budget = size_t(cmdline.memoryBudgetMB*1024.*1024.);
+    {
+      ScopedTimer timer("set model");
+      owlGlyphs->setModel(glyphs[0],triangles);
     }
-    else
-      throw std::runtime_error("unknown glyphs method '"+cmdline.method+"'");
-    owlGlyphs->setModel(glyphs[0],triangles);
     rend = owlGlyphs;
+
+    if (cmdline.timings)
+      Timings::printText(std::cout);
+    if (!cmdline.timingsJSON.empty()) {
+      std::ofstream out(cmdline.timingsJSON);
+      if (!out)
+        throw std::runtime_error("could not open '"+cmdline.timingsJSON+"'");
+      Timings::printJSON(out);
+    }
            
     // ------------------------------------------------------------------
     // create viewer
@@ -427,14 +1010,47 @@ namespace glyphs {
     GlyphsViewer widget(*rend);
     widget.glyphs = glyphs;
     widget.args = args;
+    widget.cameraPath = cameraPath;
+    if (!cmdline.recordPath.empty()) {
+      widget.recordFile.open(cmdline.recordPath);
+      if (!widget.recordFile)
+        throw std::runtime_error("could not open '"+cmdline.recordPath+"'");
+      widget.recordFile << "# camera path, one key per line; "
+                        << "replay with --play-path" << std::endl;
+    }
     widget.triangles = triangles;
     widget.frameState.samplesPerPixel = cmdline.spp;
     widget.frameState.shadeMode = cmdline.shadeMode;
     widget.frameState.pathDepth = cmdline.pathDepth;
+    widget.frameState.shading = cmdline.shading;
     widget.frameState.material = cmdline.material;
+    widget.frameState.adaptiveThreshold = cmdline.adaptiveThreshold;
+    widget.frameState.adaptiveMinSamples = cmdline.adaptiveMinSamples;
+    widget.frameState.samplerType = cmdline.samplerType;
+    widget.frameState.sunSampling = cmdline.sunSampling;
+    widget.frameState.errorStatsEnabled = cmdline.measure && cmdline.targetError > 0.f;
+    widget.frameState.rouletteDepth = cmdline.rouletteDepth;
+    widget.frameState.rayStatsEnabled = cmdline.measure || cmdline.bench || cmdline.rayStats;
+    widget.frameState.seed = cmdline.seed;
+    widget.frameState.heatMapCounter = cmdline.heatMapCounter;
+    widget.frameState.historyEnabled = cmdline.reproject;
+    widget.frameState.reprojectMaxSamples = cmdline.reprojectMaxSpp;
+    widget.frameState.halfAccum = cmdline.halfAccum;
+    widget.frameState.deferDisplay
+      = cmdline.halfAccum || cmdline.displayIntervalMs > 0.f;
+    // --measure and --bench don't move the camera, but don't let the
+    // initial camera setup cause motion frames either
+    widget.motionScale.targetFrameTime
+      = (cmdline.measure || cmdline.bench) ? 0. : 1e-3*cmdline.motionTargetMs;
     box3f sceneBounds = glyphs[0]->getBounds();
     if (triangles)
       sceneBounds.extend(triangles->bounds);
+    widget.sceneBounds = sceneBounds;
+    widget.frameState.aoSamples = cmdline.aoSamples;
+    widget.frameState.aoRadius
+      = cmdline.aoRadius > 0.f
+      ? cmdline.aoRadius
+      : .05f*length(sceneBounds.span());
 
     widget.enableInspectMode(owl::viewer::OWLViewer::Arcball,
                              /* valid range of poi*/sceneBounds,